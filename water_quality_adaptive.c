@@ -0,0 +1,119 @@
+/**
+ * Adaptive Sampling
+ *
+ * A watched channel is judged against the band its count is in: inside
+ * Good the worse side is either Good boundary, inside Alert only the
+ * Alert boundary on its own side (the other one leads back to Good).
+ * The interval doubles rather than grows linearly, so it reaches the
+ * maximum within a few minutes of calm and a watch cuts it back at once.
+ */
+
+ #include "water_quality_adaptive.h"
+ 
+ #define ADAPTIVE_NEAR_COUNT(id, key, name, unit, pin, period_ms, good_min, good_max, alert_min, \
+                             alert_max, hysteresis, near, full_scale, ...) \
+     [PARAM_##id] = ADC_COUNT_AT_MOST(near, full_scale),
+ 
+ const int16_t adaptive_near_counts[NUM_PARAMS] = {
+     WATER_QUALITY_CHANNELS(ADAPTIVE_NEAR_COUNT)
+ };
+ 
+ void adaptive_config_init_default(adaptive_config *config) {
+     config->min_interval_s = ADAPTIVE_MIN_INTERVAL_S;
+     config->base_interval_s = READING_INTERVAL;
+     config->max_interval_s = ADAPTIVE_MAX_INTERVAL_S;
+     config->stable_readings = ADAPTIVE_STABLE_READINGS;
+     config->horizon_readings = ADAPTIVE_HORIZON_READINGS;
+ }
+ 
+ void adaptive_init(adaptive_schedule *schedule, const adaptive_config *config) {
+     schedule->interval_s = config->base_interval_s;
+     schedule->calm = 0;
+     schedule->primed = 0;
+     schedule->watched = 0;
+     for (uint8_t p = 0; p < NUM_PARAMS; p++) {
+         schedule->previous[p] = 0;
+         schedule->slope[p] = 0;
+     }
+ }
+ 
+ uint8_t adaptive_channel_watch(const adc_bounds *bounds, int16_t near, uint8_t horizon,
+                                uint16_t count, int16_t slope) {
+     int16_t value = (int16_t)count;
+     int16_t low;                    // Worse level below this count (0: none)
+     int16_t high;                   // Worse level above this count (ADC_MAX: none)
+     uint8_t watch = 0;
+ 
+     if (value >= bounds->good_min && value <= bounds->good_max) {
+         low = bounds->good_min;
+         high = bounds->good_max;
+     } else if (value >= bounds->alert_min && value < bounds->good_min) {
+         low = bounds->alert_min;
+         high = ADC_MAX;
+     } else if (value > bounds->good_max && value <= bounds->alert_max) {
+         low = 0;
+         high = bounds->alert_max;
+     } else {
+         return 0;                   // Critical: nothing worse to approach
+     }
+ 
+     // Distances and projections in 32 bits and the slope's fixed point
+     int32_t projected = (int32_t)slope * horizon;
+     int32_t near_scaled = (int32_t)near * ADAPTIVE_SLOPE_SCALE;
+ 
+     if (low > 0) {
+         int32_t distance = ((int32_t)value - low) * ADAPTIVE_SLOPE_SCALE;
+         if (distance <= near_scaled) watch |= ADAPTIVE_NEAR;
+         if (projected < 0 && -projected >= distance) watch |= ADAPTIVE_TRENDING;
+     }
+     if (high < ADC_MAX) {
+         int32_t distance = ((int32_t)high - value) * ADAPTIVE_SLOPE_SCALE;
+         if (distance <= near_scaled) watch |= ADAPTIVE_NEAR;
+         if (projected > 0 && projected >= distance) watch |= ADAPTIVE_TRENDING;
+     }
+     return watch;
+ }
+ 
+ uint16_t adaptive_update(adaptive_schedule *schedule, const adaptive_config *config,
+                          const uint16_t counts[NUM_PARAMS], const uint8_t levels[NUM_PARAMS]) {
+     uint8_t all_good = 1;
+ 
+     schedule->watched = 0;
+     for (uint8_t p = 0; p < NUM_PARAMS; p++) {
+         // Exponential smoothing keeps sensor noise from looking like a trend
+         if (schedule->primed) {
+             // The difference of step and slope needs 17 bits; the result lies
+             // between the two and fits again
+             int16_t step = (int16_t)(counts[p] - schedule->previous[p]) * ADAPTIVE_SLOPE_SCALE;
+             int16_t slope = schedule->slope[p];
+             schedule->slope[p] = (int16_t)(slope + ((int32_t)step - slope) / (1 << ADAPTIVE_SLOPE_SHIFT));
+         }
+ 
+         // A level change is pending (see level_filter_update())
+         uint8_t raw = adc_classify(&adc_normal_bounds[p], counts[p]);
+         uint8_t strict = adc_classify(&adc_strict_bounds[p], counts[p]);
+ 
+         if (raw > levels[p] || strict < levels[p] ||
+             adaptive_channel_watch(&adc_normal_bounds[p], adaptive_near_counts[p],
+                                    config->horizon_readings, counts[p], schedule->slope[p])) {
+             schedule->watched |= (uint32_t)1 << p;
+         }
+         if (levels[p] != QUALITY_GOOD) all_good = 0;
+         schedule->previous[p] = counts[p];
+     }
+     schedule->primed = 1;
+ 
+     if (schedule->watched) {
+         schedule->interval_s = config->min_interval_s;
+         schedule->calm = 0;
+     } else if (!all_good || schedule->interval_s < config->base_interval_s) {
+         schedule->interval_s = config->base_interval_s;
+         schedule->calm = 0;
+     } else if (++schedule->calm >= config->stable_readings) {
+         // Doubling saturates at the maximum
+         schedule->interval_s = schedule->interval_s > config->max_interval_s / 2 ?
+                                config->max_interval_s : (uint16_t)(schedule->interval_s * 2);
+         schedule->calm = 0;
+     }
+     return schedule->interval_s;
+ }
\ No newline at end of file
@@ -0,0 +1,67 @@
+/**
+ * Adaptive Sampling
+ *
+ * Chooses the wait before the next reading from the last one: long while
+ * the water is stably Good, the normal interval while something is Alert
+ * or Critical but steady, and short while a value is close to a worse
+ * level or heading there. Works on ADC counts and the adc_bounds tables
+ * with integer arithmetic only; plain C99 with no host dependencies, so
+ * the firmware and the host benchmarks share it.
+ */
+
+ #ifndef WATER_QUALITY_ADAPTIVE_H
+ #define WATER_QUALITY_ADAPTIVE_H
+ 
+ #include <stdint.h>
+ #include "water_quality_config.h"
+ #include "water_quality_adc.h"
+ 
+ // Why a channel needs closer watching (bits)
+ #define ADAPTIVE_NEAR     0x01      // Within its near distance of a worse level
+ #define ADAPTIVE_TRENDING 0x02      // Would reach a worse level within the horizon
+ 
+ // Fixed-point scale of the smoothed slope (a full-scale step still fits
+ // in 16 bits), and its smoothing (each reading moves it
+ // 1/2^ADAPTIVE_SLOPE_SHIFT of the way)
+ #define ADAPTIVE_SLOPE_SCALE 8
+ #define ADAPTIVE_SLOPE_SHIFT 2
+ 
+ typedef struct {
+     uint16_t min_interval_s;        // While a channel is watched
+     uint16_t base_interval_s;       // While not all Good, and after a watch ends
+     uint16_t max_interval_s;
+     uint8_t stable_readings;        // Calm all-Good readings before each doubling
+     uint8_t horizon_readings;       // Readings ahead a trend is projected
+ } adaptive_config;
+ 
+ typedef struct {
+     uint16_t interval_s;            // Wait before the next reading
+     uint8_t calm;                   // Calm all-Good readings since the last change
+     uint8_t primed;                 // previous holds a reading
+     uint32_t watched;               // Bit p set while parameter p is watched
+     uint16_t previous[NUM_PARAMS];
+     int16_t slope[NUM_PARAMS];      // Smoothed change per reading, in 1/ADAPTIVE_SLOPE_SCALE counts
+ } adaptive_schedule;
+ 
+ // Near distance of each parameter in counts (*_NEAR)
+ extern const int16_t adaptive_near_counts[NUM_PARAMS];
+ 
+ // ADAPTIVE_* and READING_INTERVAL from water_quality_config.h
+ void adaptive_config_init_default(adaptive_config *config);
+ 
+ void adaptive_init(adaptive_schedule *schedule, const adaptive_config *config);
+ 
+ // ADAPTIVE_NEAR / ADAPTIVE_TRENDING bits of one channel; slope is the
+ // smoothed change per reading in 1/ADAPTIVE_SLOPE_SCALE counts. Only the boundaries to a worse level
+ // count, and open sides (0 and ADC_MAX) are not boundaries.
+ uint8_t adaptive_channel_watch(const adc_bounds *bounds, int16_t near, uint8_t horizon,
+                                uint16_t count, int16_t slope);
+ 
+ // Feeds one reading (counts and debounced levels) and returns the seconds
+ // to wait before the next one. A channel whose debounced level is about
+ // to change (raw level worse, or strict level better) is watched too, so
+ // the debounce confirms or rejects the change quickly.
+ uint16_t adaptive_update(adaptive_schedule *schedule, const adaptive_config *config,
+                          const uint16_t counts[NUM_PARAMS], const uint8_t levels[NUM_PARAMS]);
+ 
+ #endif /* WATER_QUALITY_ADAPTIVE_H */
\ No newline at end of file
@@ -0,0 +1,68 @@
+/**
+ * Integer ADC Pipeline
+ *
+ * The strict bands move every closed side inwards by the margin, like
+ * classify_with_margin(), so feeding adc_classify() with both tables into
+ * level_filter_update() debounces exactly as the float version did.
+ */
+
+ #include <math.h>
+ #include "water_quality_adc.h"
+ 
+ // Band sides in counts; open sides (+/-INFINITY) become 0 and ADC_MAX
+ #define ADC_LOWER(x, full_scale) ((x) == -INFINITY ? 0 : ADC_COUNT_AT_LEAST(x, full_scale))
+ #define ADC_UPPER(x, full_scale) ((x) == INFINITY ? ADC_MAX : ADC_COUNT_AT_MOST(x, full_scale))
+ 
+ #define ADC_BOUNDS(good_min, good_max, alert_min, alert_max, full_scale) { \
+     ADC_LOWER(good_min, full_scale), ADC_UPPER(good_max, full_scale), \
+     ADC_LOWER(alert_min, full_scale), ADC_UPPER(alert_max, full_scale) }
+ 
+ // Open sides stay open: INFINITY minus a margin is still INFINITY
+ #define ADC_NORMAL_BOUNDS(id, key, name, unit, pin, period_ms, good_min, good_max, alert_min, \
+                           alert_max, hysteresis, near, full_scale, ...) \
+     [PARAM_##id] = ADC_BOUNDS(good_min, good_max, alert_min, alert_max, full_scale),
+ #define ADC_STRICT_BOUNDS(id, key, name, unit, pin, period_ms, good_min, good_max, alert_min, \
+                           alert_max, hysteresis, near, full_scale, ...) \
+     [PARAM_##id] = ADC_BOUNDS((good_min) + (hysteresis), (good_max) - (hysteresis), \
+                               (alert_min) + (hysteresis), (alert_max) - (hysteresis), full_scale),
+ 
+ const adc_bounds adc_normal_bounds[NUM_PARAMS] = {
+     WATER_QUALITY_CHANNELS(ADC_NORMAL_BOUNDS)
+ };
+ 
+ const adc_bounds adc_strict_bounds[NUM_PARAMS] = {
+     WATER_QUALITY_CHANNELS(ADC_STRICT_BOUNDS)
+ };
+ 
+ // Hundredths per count, split into a whole part and a Q26 fraction
+ #define CENTI_WHOLE(id, key, name, unit, pin, period_ms, good_min, good_max, alert_min, \
+                     alert_max, hysteresis, near, full_scale, ...) \
+     [PARAM_##id] = (uint32_t)((full_scale) * 100) / ADC_MAX,
+ #define CENTI_FRACTION(id, key, name, unit, pin, period_ms, good_min, good_max, alert_min, \
+                        alert_max, hysteresis, near, full_scale, ...) \
+     [PARAM_##id] = (uint32_t)(((uint32_t)((full_scale) * 100) % ADC_MAX) * \
+                               (double)(1UL << ADC_CENTI_SHIFT) / ADC_MAX + 0.5),
+ 
+ static const uint16_t centi_whole[NUM_PARAMS] = {
+     WATER_QUALITY_CHANNELS(CENTI_WHOLE)
+ };
+ 
+ // The whole part must fit centi_whole
+ #define CENTI_WHOLE_FITS(id, key, name, unit, pin, period_ms, good_min, good_max, alert_min, \
+                          alert_max, hysteresis, near, full_scale, ...) \
+     _Static_assert((uint32_t)((full_scale) * 100) / ADC_MAX <= UINT16_MAX, #id " full scale too large for the display");
+ WATER_QUALITY_CHANNELS(CENTI_WHOLE_FITS)
+ 
+ static const uint32_t centi_fraction[NUM_PARAMS] = {
+     WATER_QUALITY_CHANNELS(CENTI_FRACTION)
+ };
+ 
+ uint32_t adc_to_centi(uint8_t param, uint16_t count) {
+     uint32_t high = centi_fraction[param] >> 16;
+     uint32_t low = centi_fraction[param] & 0xFFFF;
+ 
+     // (count * fraction + half) >> shift, without the 64-bit product
+     uint32_t scaled = count * high + (1UL << (ADC_CENTI_SHIFT - 17)) + ((count * low) >> 16);
+ 
+     return (uint32_t)count * centi_whole[param] + (scaled >> (ADC_CENTI_SHIFT - 16));
+ }
\ No newline at end of file
@@ -0,0 +1,60 @@
+/**
+ * Integer ADC Pipeline
+ *
+ * Quality thresholds converted at compile time from sensor units into raw
+ * 10-bit ADC counts, so the firmware classifies a reading with integer
+ * comparisons and never converts it to float. Readings are only turned
+ * into units for display, as exact fixed-point hundredths. Plain C99
+ * with no host dependencies, so the firmware and the host benchmarks
+ * share it.
+ */
+
+ #ifndef WATER_QUALITY_ADC_H
+ #define WATER_QUALITY_ADC_H
+ 
+ #include <stdint.h>
+ #include "water_quality_config.h"
+ 
+ // Readings are oversampled by 4^ADC_OVERSAMPLE_BITS and decimated, which
+ // adds ADC_OVERSAMPLE_BITS bits to the 10-bit converter
+ #define ADC_OVERSAMPLE_BITS 2
+ #define ADC_MAX (1023 << ADC_OVERSAMPLE_BITS)
+ 
+ // Lowest count whose value is at least x, highest count whose value is
+ // at most x. Constant expressions: the compiler folds them.
+ #define ADC_CEIL(x)  ((int16_t)(x) + ((x) > (int16_t)(x)))
+ #define ADC_FLOOR(x) ((int16_t)(x) - ((x) < (int16_t)(x)))
+ #define ADC_COUNT_AT_LEAST(x, full_scale) ADC_CEIL((x) * ADC_MAX / (full_scale))
+ #define ADC_COUNT_AT_MOST(x, full_scale)  ADC_FLOOR((x) * ADC_MAX / (full_scale))
+ 
+ // Fractional bits of the display scale factors. Rounding is exact for
+ // every count while 2^ADC_CENTI_SHIFT > ADC_MAX^2.
+ #define ADC_CENTI_SHIFT 26
+ 
+ // Good and alert bands of one parameter in counts; open sides are 0 and
+ // ADC_MAX
+ typedef struct {
+     int16_t good_min;
+     int16_t good_max;
+     int16_t alert_min;
+     int16_t alert_max;
+ } adc_bounds;
+ 
+ // Bands at the normal thresholds, and narrowed by the *_HYSTERESIS margin
+ extern const adc_bounds adc_normal_bounds[NUM_PARAMS];
+ extern const adc_bounds adc_strict_bounds[NUM_PARAMS];
+ 
+ static inline uint8_t adc_classify(const adc_bounds *bounds, uint16_t count) {
+     int16_t value = (int16_t)count;
+ 
+     if (value >= bounds->good_min && value <= bounds->good_max) return QUALITY_GOOD;
+     if (value >= bounds->alert_min && value <= bounds->alert_max) return QUALITY_ALERT;
+     return QUALITY_CRITICAL;
+ }
+ 
+ // Value of a count in hundredths of the parameter's unit, rounded to
+ // nearest: the whole part of full_scale / ADC_MAX plus the fraction in
+ // Q26, multiplied in 16-bit halves so nothing wider than 32 bits is needed
+ uint32_t adc_to_centi(uint8_t param, uint16_t count);
+ 
+ #endif /* WATER_QUALITY_ADC_H */
\ No newline at end of file
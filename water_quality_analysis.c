@@ -0,0 +1,160 @@
+/**
+ * Water Quality Analysis
+ *
+ * Structured analysis of readings plus the text reports built from it.
+ */
+
+ #define _POSIX_C_SOURCE 200809L
+ 
+ #include <stdio.h>
+ #include <time.h>
+ #include "water_quality_analysis.h"
+ 
+ #define CHANNEL_KEY(id, key, ...) [PARAM_##id] = key,
+ #define CHANNEL_NAME(id, key, name, ...) [PARAM_##id] = name,
+ #define CHANNEL_UNIT(id, key, name, unit, ...) [PARAM_##id] = unit,
+ #define CHANNEL_HYSTERESIS(id, key, name, unit, pin, period_ms, good_min, good_max, alert_min, \
+                            alert_max, hysteresis, ...) \
+     [PARAM_##id] = hysteresis,
+ 
+ static const char *const parameter_keys[NUM_PARAMS] = { WATER_QUALITY_CHANNELS(CHANNEL_KEY) };
+ static const char *const parameter_names[NUM_PARAMS] = { WATER_QUALITY_CHANNELS(CHANNEL_NAME) };
+ static const char *const parameter_units[NUM_PARAMS] = { WATER_QUALITY_CHANNELS(CHANNEL_UNIT) };
+ static const float hysteresis_margins[NUM_PARAMS] = { WATER_QUALITY_CHANNELS(CHANNEL_HYSTERESIS) };
+ 
+ void analyze_water_quality(const quality_table *thresholds, const float values[NUM_PARAMS],
+                            uint64_t timestamp_ms, quality_result *result) {
+     result->timestamp_ms = timestamp_ms;
+ 
+     // Classify every parameter and determine overall water quality (worst case)
+     result->overall = classify_reading(thresholds, values, result->level);
+ }
+ 
+ void quality_stabilizer_init(quality_stabilizer *stabilizer) {
+     level_filter_config_init_default(&stabilizer->config);
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         stabilizer->margin[p] = hysteresis_margins[p];
+         level_filter_init(&stabilizer->filter[p]);
+     }
+ }
+ 
+ uint8_t classify_with_margin(float value, float good_min, float good_max,
+                              float alert_min, float alert_max, float margin) {
+     if (value >= good_min + margin && value <= good_max - margin) return QUALITY_GOOD;
+     if (value >= alert_min + margin && value <= alert_max - margin) return QUALITY_ALERT;
+ 
+     // NaN fails both checks, like classify_value()
+     return QUALITY_CRITICAL;
+ }
+ 
+ void stabilize_water_quality(quality_stabilizer *stabilizer, const quality_table *thresholds,
+                              const float values[NUM_PARAMS], uint32_t mask,
+                              quality_result *result) {
+     uint8_t overall = QUALITY_GOOD;
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         level_filter *filter = &stabilizer->filter[p];
+ 
+         if (mask & (1u << p) || filter->level == LEVEL_FILTER_UNSET) {
+             const quality_bounds *bounds = &thresholds->param[p];
+             uint8_t strict = classify_with_margin(values[p], bounds->good_min, bounds->good_max,
+                                                   bounds->alert_min, bounds->alert_max,
+                                                   stabilizer->margin[p]);
+             level_filter_update(filter, &stabilizer->config, result->level[p], strict);
+         }
+ 
+         result->level[p] = filter->level;
+         if (filter->level > overall) overall = filter->level;
+     }
+ 
+     result->overall = overall;
+ }
+ 
+ void display_sensor_readings(const float values[NUM_PARAMS]) {
+     printf("Current Sensor Readings:\n");
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         const char *unit = parameter_units[p];
+         printf("%s: %.2f%s%s\n", parameter_names[p], values[p], *unit ? " " : "", unit);
+     }
+     printf("\n");
+ }
+ 
+ static void print_alert_message(int overall_quality) {
+     if (overall_quality == QUALITY_ALERT) {
+         printf("⚠️ ALERT: Water quality requires attention!\n");
+     } else if (overall_quality == QUALITY_CRITICAL) {
+         printf("🚨 CRITICAL: Immediate action required! Water quality is unsafe!\n");
+     }
+ }
+ 
+ void report_water_quality(const quality_result *result) {
+     printf("Water Quality Analysis:\n");
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         printf("%s: %s\n", get_parameter_name(p), get_quality_category(result->level[p]));
+     }
+ 
+     printf("\nOVERALL WATER QUALITY: %s\n", get_quality_category(result->overall));
+ 
+     // Trigger alert if necessary
+     print_alert_message(result->overall);
+ }
+ 
+ static void format_timestamp(uint64_t timestamp_ms, char *buf, size_t size) {
+     time_t seconds = (time_t)(timestamp_ms / 1000);
+     struct tm tm;
+ 
+     localtime_r(&seconds, &tm);
+     strftime(buf, size, "%Y-%m-%d %H:%M:%S", &tm);
+ }
+ 
+ int report_quality_changes(const quality_result *previous, const quality_result *current,
+                            const float values[NUM_PARAMS]) {
+     char when[32];
+     int changes = 0;
+ 
+     format_timestamp(current->timestamp_ms, when, sizeof(when));
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         if (previous && previous->level[p] == current->level[p]) continue;
+ 
+         const char *unit = get_parameter_unit(p);
+         printf("%s %s: %s -> %s (%.2f%s%s)\n", when, get_parameter_name(p),
+                previous ? get_quality_category(previous->level[p]) : "-",
+                get_quality_category(current->level[p]), values[p], *unit ? " " : "", unit);
+         changes++;
+     }
+ 
+     if (!previous || previous->overall != current->overall) {
+         printf("%s OVERALL WATER QUALITY: %s\n", when, get_quality_category(current->overall));
+         print_alert_message(current->overall);
+     }
+ 
+     if (changes > 0) fflush(stdout);
+ 
+     return changes;
+ }
+ 
+ const char* get_quality_category(int quality_level) {
+     switch (quality_level) {
+         case QUALITY_GOOD:
+             return "Good";
+         case QUALITY_ALERT:
+             return "Alert";
+         case QUALITY_CRITICAL:
+             return "Critical";
+         default:
+             return "Unknown";
+     }
+ }
+ 
+ const char* get_parameter_name(int param) {
+     return param >= 0 && param < NUM_PARAMS ? parameter_names[param] : "Unknown";
+ }
+ 
+ const char* get_parameter_unit(int param) {
+     return param >= 0 && param < NUM_PARAMS ? parameter_units[param] : "";
+ }
+ 
+ const char* get_parameter_key(int param) {
+     return param >= 0 && param < NUM_PARAMS ? parameter_keys[param] : "unknown";
+ }
\ No newline at end of file
@@ -0,0 +1,67 @@
+/**
+ * Water Quality Analysis
+ *
+ * Turns sensor readings into a structured quality result and renders
+ * results as text. Analysis never prints, so callers decide whether to
+ * show every sample or only quality level changes.
+ */
+
+ #ifndef WATER_QUALITY_ANALYSIS_H
+ #define WATER_QUALITY_ANALYSIS_H
+ 
+ #include <stdint.h>
+ #include "water_quality_config.h"
+ #include "water_quality_classify.h"
+ #include "water_quality_hysteresis.h"
+ 
+ // Outcome of analyzing one reading
+ typedef struct {
+     uint64_t timestamp_ms;          // Wall-clock time of the reading (ms since epoch)
+     uint8_t level[NUM_PARAMS];      // Quality level per parameter, indexed by PARAM_*
+     uint8_t overall;                // Worst level across all parameters
+ } quality_result;
+ 
+ // Classifies a reading against the thresholds and fills result
+ void analyze_water_quality(const quality_table *thresholds, const float values[NUM_PARAMS],
+                            uint64_t timestamp_ms, quality_result *result);
+ 
+ // Hysteresis/debounce state of every parameter of one station
+ typedef struct {
+     float margin[NUM_PARAMS];       // Hysteresis band per parameter
+     level_filter_config config;
+     level_filter filter[NUM_PARAMS];
+ } quality_stabilizer;
+ 
+ // *_HYSTERESIS bands and dwell counts from water_quality_config.h
+ void quality_stabilizer_init(quality_stabilizer *stabilizer);
+ 
+ // Level of value when the good and alert bands are narrowed by margin on
+ // each side (margin 0 gives the normal level). Open sides are +/-INFINITY.
+ uint8_t classify_with_margin(float value, float good_min, float good_max,
+                              float alert_min, float alert_max, float margin);
+ 
+ // Replaces the levels of an analyzed reading with the debounced ones.
+ // Only parameters whose bit is set in mask were sampled and advance their
+ // filter; the others keep their debounced level.
+ void stabilize_water_quality(quality_stabilizer *stabilizer, const quality_table *thresholds,
+                              const float values[NUM_PARAMS], uint32_t mask,
+                              quality_result *result);
+ 
+ // Full per-sample report: readings block and analysis block
+ void display_sensor_readings(const float values[NUM_PARAMS]);
+ void report_water_quality(const quality_result *result);
+ 
+ // Event report: one line per parameter whose level differs from previous
+ // (every parameter when previous is NULL). Returns the number of changes.
+ int report_quality_changes(const quality_result *previous, const quality_result *current,
+                            const float values[NUM_PARAMS]);
+ 
+ const char* get_quality_category(int quality_level);
+ const char* get_parameter_name(int param);
+ const char* get_parameter_unit(int param);
+ 
+ // Lowercase identifier of a parameter ("dissolved_oxygen"): profile keys,
+ // column and CSV header names
+ const char* get_parameter_key(int param);
+ 
+ #endif /* WATER_QUALITY_ANALYSIS_H */
\ No newline at end of file
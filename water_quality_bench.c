@@ -0,0 +1,2072 @@
+/**
+ * Water Quality Benchmarks
+ *
+ * Measures the host-side building blocks on simulated sensor data and
+ * prints the results as one JSON document, so runs can be stored and
+ * compared between releases. Every result has a name, a value and a unit.
+ */
+
+ #define _POSIX_C_SOURCE 200809L
+ 
+ #include <ctype.h>
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <math.h>
+ #include <pthread.h>
+ #include <sched.h>
+ #include <sys/epoll.h>
+ #include <sys/resource.h>
+ #include <sys/socket.h>
+ #include <sys/stat.h>
+ #include <sys/un.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <time.h>
+ #include <unistd.h>
+ #include "water_quality_config.h"
+ #include "water_quality_classify.h"
+ #include "water_quality_analysis.h"
+ #include "water_quality_sensors.h"
+ #include "water_quality_gorilla.h"
+ #include "water_quality_ring.h"
+ #include "water_quality_latency.h"
+ #include "water_quality_output.h"
+ #include "water_quality_prng.h"
+ #include "water_quality_window.h"
+ #include "water_quality_trend.h"
+ #include "water_quality_profile.h"
+ #include "water_quality_rcu.h"
+ #include "water_quality_hysteresis.h"
+ #include "water_quality_adc.h"
+ #include "water_quality_sampler.h"
+ #include "water_quality_registers.h"
+ #include "water_quality_uart.h"
+ #include "water_quality_telemetry.h"
+ #include "water_quality_adaptive.h"
+ #include "water_quality_history.h"
+ #include "water_quality_server.h"
+ #include "water_quality_checkpoint.h"
+ 
+ #define BENCH_SAMPLES 1000000
+ #define BENCH_START_MS 1700000000000ULL
+ #define BENCH_RING_RECORDS 10000000
+ #define BENCH_REPORT_SAMPLES 200000     // Readings formatted by the text benchmarks
+ #define BENCH_REPEATS 5                 // Short benchmarks keep their fastest run
+ #define BENCH_MAX_RESULTS 96
+ #define BENCH_WINDOW_STATIONS 1000     // Stations sharing the sliding window benchmark
+ #define BENCH_HYSTERESIS_DAYS 30       // Simulated days of level changes, raw and debounced
+ #define BENCH_FORMAT_VALUES 1000000     // Random floats compared against printf
+ #define BENCH_COMPARE_SAMPLES 20000     // Readings whose reports are compared against printf
+ #define BENCH_PROFILE_RELOADS 200       // Profile swaps while a reader classifies
+ #define BENCH_ADC_PASSES 200            // Sweeps over every ADC count of every channel
+ #define BENCH_SAMPLER_CONVERSIONS 2000000   // Emulated ADC conversions through the sampler interrupt
+ #define BENCH_SAMPLER_NOISE 0.7f        // Sensor noise in 10-bit LSB (standard deviation)
+ #define BENCH_UART_REPORTS 10000        // Reports queued and drained through the UART emulation
+ #define BENCH_TELEMETRY_READINGS 1000000    // Readings encoded into one telemetry stream
+ #define BENCH_TELEMETRY_CHUNK 4093      // Bytes per decode call when checking streaming
+ #define BENCH_TELEMETRY_CORRUPT 100     // One frame in this many gets a flipped bit
+ #define BENCH_ADAPTIVE_STATIONS 20      // Stations simulated second by second for adaptive sampling
+ #define BENCH_ADAPTIVE_DAYS 2           // Simulated days per station
+ #define BENCH_ADAPTIVE_SUSTAINED_S 180  // Escalations lasting this long must be detected
+ #define BENCH_SERVER_CLIENTS 2000       // Concurrent local subscribers of the telemetry server
+ #define BENCH_SERVER_READINGS 100       // Readings fanned out to all of them
+ #define BENCH_SERVER_FAST_CLIENTS 4     // Subscribers reading next to one that never does
+ #define BENCH_SERVER_BURST_READINGS 40000   // Readings published past the stalled subscriber
+ #define BENCH_SERVER_BURST 200          // Readings per burst, 1 ms apart
+ #define BENCH_SERVER_HISTORY_ROWS 200000    // Rows of the history store queried through the server
+ #define BENCH_SERVER_HISTORY_FLUSH 100      // Rows appended between flushes while filling it
+ #define BENCH_CHECKPOINT_READINGS 86400     // Readings (one day at 1 s) before the checkpoint
+ #define BENCH_CHECKPOINT_RESUMED 3600       // Readings compared after resuming from it
+ 
+ typedef struct {
+     char name[48];
+     double value;
+     const char *unit;
+ } bench_result;
+ 
+ static bench_result results[BENCH_MAX_RESULTS];
+ static int result_count;
+ 
+ static double now_seconds(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+ }
+ 
+ static void add_result(const char *name, double value, const char *unit) {
+     if (result_count == BENCH_MAX_RESULTS) return;
+ 
+     snprintf(results[result_count].name, sizeof(results[result_count].name), "%s", name);
+     results[result_count].value = value;
+     results[result_count].unit = unit;
+     result_count++;
+ }
+ 
+ // Result name for a parameter, e.g. "gorilla.dissolved_oxygen.ratio"
+ static void parameter_result_name(char *name, size_t size, const char *prefix, int param,
+                                   const char *suffix) {
+     int n = snprintf(name, size, "%s.%s.%s", prefix, get_parameter_name(param), suffix);
+ 
+     for (int i = (int)strlen(prefix) + 1; i < n && (size_t)i < size; i++) {
+         name[i] = name[i] == ' ' ? '_' : (char)tolower((unsigned char)name[i]);
+     }
+ }
+ 
+ // Readings from one seeded station, one column per parameter
+ static void simulate_columns(float *values[NUM_PARAMS], size_t count, uint32_t period_ms) {
+     sensor_station station;
+     sensor_station_init(&station, 42);
+     sensor_station_read_batch(&station, BENCH_START_MS, period_ms, count, values);
+ }
+ 
+ // Points stdout at fd and returns the previous stdout, or -1
+ static int redirect_stdout(int fd) {
+     int saved;
+ 
+     fflush(stdout);
+     saved = dup(STDOUT_FILENO);
+     if (saved < 0) return -1;
+ 
+     dup2(fd, STDOUT_FILENO);
+     return saved;
+ }
+ 
+ static void restore_stdout(int saved) {
+     fflush(stdout);
+     dup2(saved, STDOUT_FILENO);
+     close(saved);
+ }
+ 
+ // Text output goes to /dev/null while formatting is timed
+ static int silence_stdout(void) {
+     int null_fd = open("/dev/null", O_WRONLY);
+     int saved;
+ 
+     if (null_fd < 0) return -1;
+     saved = redirect_stdout(null_fd);
+     close(null_fd);
+     return saved;
+ }
+ 
+ // ns per reading for the single-reading path and every batch kernel
+ static int bench_classify(void) {
+     float *columns[NUM_PARAMS];
+     uint8_t *levels[NUM_PARAMS];
+     uint8_t *overall = malloc(BENCH_SAMPLES);
+     float (*rows)[NUM_PARAMS] = malloc(BENCH_SAMPLES * sizeof(*rows));
+     quality_table table;
+     sensor_batch in;
+     quality_batch out;
+     unsigned reference = 0;
+     int errors = 0;
+     double best;
+ 
+     quality_table_init_default(&table);
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         columns[p] = malloc(BENCH_SAMPLES * sizeof(float));
+         levels[p] = malloc(BENCH_SAMPLES);
+         in.values[p] = columns[p];
+         out.level[p] = levels[p];
+     }
+     out.overall = overall;
+ 
+     simulate_columns(columns, BENCH_SAMPLES, 1000);
+     for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+         for (int p = 0; p < NUM_PARAMS; p++) rows[i][p] = columns[p][i];
+     }
+ 
+     best = 1e9;
+     for (int r = 0; r < BENCH_REPEATS; r++) {
+         unsigned sum = 0;
+         double start = now_seconds();
+         for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+             quality_result result;
+             analyze_water_quality(&table, rows[i], BENCH_START_MS + i, &result);
+             sum += result.overall;
+         }
+         double seconds = now_seconds() - start;
+         if (seconds < best) best = seconds;
+         reference = sum;
+     }
+     add_result("classify.single", best * 1e9 / BENCH_SAMPLES, "ns/reading");
+ 
+     for (int k = CLASSIFY_SCALAR; k <= CLASSIFY_AVX2; k++) {
+         unsigned checksum = 0;
+         char name[48];
+ 
+         if (!classify_kernel_available((classify_kernel)k)) continue;
+ 
+         best = 1e9;
+         for (int r = 0; r < BENCH_REPEATS; r++) {
+             double start = now_seconds();
+             classify_batch_kernel((classify_kernel)k, &table, &in, &out, BENCH_SAMPLES);
+             double seconds = now_seconds() - start;
+             if (seconds < best) best = seconds;
+         }
+ 
+         // Every kernel must agree with the single-reading path
+         for (size_t i = 0; i < BENCH_SAMPLES; i++) checksum += overall[i];
+         if (checksum != reference) errors++;
+ 
+         snprintf(name, sizeof(name), "classify.batch.%s", classify_kernel_name((classify_kernel)k));
+         add_result(name, best * 1e9 / BENCH_SAMPLES, "ns/reading");
+     }
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         free(columns[p]);
+         free(levels[p]);
+     }
+     free(overall);
+     free(rows);
+ 
+     return errors;
+ }
+ 
+ // Formatting throughput of the per-reading text report
+ static int bench_display(void) {
+     float *columns[NUM_PARAMS];
+     float reading[NUM_PARAMS];
+     FILE *sample = tmpfile();
+     double start;
+     double seconds;
+     long bytes;
+     int saved;
+ 
+     if (!sample) return 1;
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         columns[p] = malloc(BENCH_REPORT_SAMPLES * sizeof(float));
+     }
+     simulate_columns(columns, BENCH_REPORT_SAMPLES, 1000);
+ 
+     // Size of one formatted reading
+     for (int p = 0; p < NUM_PARAMS; p++) reading[p] = columns[p][0];
+     saved = redirect_stdout(fileno(sample));
+     if (saved < 0) return 1;
+     display_sensor_readings(reading);
+     restore_stdout(saved);
+     bytes = lseek(fileno(sample), 0, SEEK_END);
+     fclose(sample);
+ 
+     saved = silence_stdout();
+     if (saved < 0) return 1;
+ 
+     start = now_seconds();
+     for (size_t i = 0; i < BENCH_REPORT_SAMPLES; i++) {
+         for (int p = 0; p < NUM_PARAMS; p++) reading[p] = columns[p][i];
+         display_sensor_readings(reading);
+     }
+     fflush(stdout);
+     seconds = now_seconds() - start;
+ 
+     add_result("display.readings", BENCH_REPORT_SAMPLES / seconds, "readings/s");
+     add_result("display.bytes", (double)bytes * BENCH_REPORT_SAMPLES / seconds / 1e6, "MB/s");
+ 
+     // Same text through the preallocated output buffer and writev()
+     output_stream output;
+     if (output_init(&output, STDOUT_FILENO) < 0) return 1;
+ 
+     start = now_seconds();
+     for (size_t i = 0; i < BENCH_REPORT_SAMPLES; i++) {
+         for (int p = 0; p < NUM_PARAMS; p++) reading[p] = columns[p][i];
+         output_record_end(&output, format_sensor_readings(output_record_begin(&output), reading));
+     }
+     output_flush(&output);
+     seconds = now_seconds() - start;
+ 
+     output_destroy(&output);
+     restore_stdout(saved);
+ 
+     add_result("output.readings", BENCH_REPORT_SAMPLES / seconds, "readings/s");
+     add_result("output.bytes", (double)bytes * BENCH_REPORT_SAMPLES / seconds / 1e6, "MB/s");
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         free(columns[p]);
+     }
+ 
+     return 0;
+ }
+ 
+ // Simulated readings through analysis and output as fast as possible:
+ // the live loop without waiting for sampling deadlines
+ static int bench_end_to_end(void) {
+     quality_table table;
+     sensor_station station;
+     quality_result previous;
+     quality_result current;
+     double start;
+     int saved;
+ 
+     quality_table_init_default(&table);
+ 
+     saved = silence_stdout();
+     if (saved < 0) return 1;
+ 
+     sensor_station_init(&station, 42);
+     start = now_seconds();
+     for (size_t i = 0; i < BENCH_REPORT_SAMPLES; i++) {
+         float values[NUM_PARAMS];
+         uint64_t timestamp_ms = BENCH_START_MS + i * READING_INTERVAL * 1000ULL;
+ 
+         sensor_station_read(&station, timestamp_ms, values);
+         analyze_water_quality(&table, values, timestamp_ms, &current);
+         display_sensor_readings(values);
+         report_water_quality(&current);
+     }
+     fflush(stdout);
+     add_result("end_to_end.report", BENCH_REPORT_SAMPLES / (now_seconds() - start), "readings/s");
+ 
+     sensor_station_init(&station, 42);
+     start = now_seconds();
+     for (size_t i = 0; i < BENCH_REPORT_SAMPLES; i++) {
+         float values[NUM_PARAMS];
+         uint64_t timestamp_ms = BENCH_START_MS + i * READING_INTERVAL * 1000ULL;
+ 
+         sensor_station_read(&station, timestamp_ms, values);
+         analyze_water_quality(&table, values, timestamp_ms, &current);
+         report_quality_changes(i > 0 ? &previous : NULL, &current, values);
+         previous = current;
+     }
+     fflush(stdout);
+     add_result("end_to_end.event", BENCH_REPORT_SAMPLES / (now_seconds() - start), "readings/s");
+ 
+     // The live loop's output path: one record per reading, batched writev()
+     output_stream output;
+     if (output_init(&output, STDOUT_FILENO) < 0) return 1;
+ 
+     sensor_station_init(&station, 42);
+     start = now_seconds();
+     for (size_t i = 0; i < BENCH_REPORT_SAMPLES; i++) {
+         float values[NUM_PARAMS];
+         uint64_t timestamp_ms = BENCH_START_MS + i * READING_INTERVAL * 1000ULL;
+ 
+         sensor_station_read(&station, timestamp_ms, values);
+         analyze_water_quality(&table, values, timestamp_ms, &current);
+         char *text = format_sensor_readings(output_record_begin(&output), values);
+         output_record_end(&output, format_water_quality(text, &current));
+     }
+     output_flush(&output);
+     add_result("end_to_end.report_buffered", BENCH_REPORT_SAMPLES / (now_seconds() - start),
+                "readings/s");
+ 
+     sensor_station_init(&station, 42);
+     start = now_seconds();
+     for (size_t i = 0; i < BENCH_REPORT_SAMPLES; i++) {
+         float values[NUM_PARAMS];
+         uint64_t timestamp_ms = BENCH_START_MS + i * READING_INTERVAL * 1000ULL;
+         int changes;
+ 
+         sensor_station_read(&station, timestamp_ms, values);
+         analyze_water_quality(&table, values, timestamp_ms, &current);
+         output_record_end(&output, format_quality_changes(output_record_begin(&output),
+                                                           output_time(&output, timestamp_ms),
+                                                           i > 0 ? &previous : NULL, &current,
+                                                           values, &changes));
+         previous = current;
+     }
+     output_flush(&output);
+     add_result("end_to_end.event_buffered", BENCH_REPORT_SAMPLES / (now_seconds() - start),
+                "readings/s");
+ 
+     output_destroy(&output);
+     restore_stdout(saved);
+     return 0;
+ }
+ 
+ // Reads everything written to a temporary file so far
+ static char* read_back(FILE *file, long *size) {
+     fflush(file);
+     *size = lseek(fileno(file), 0, SEEK_END);
+ 
+     char *text = malloc((size_t)*size + 1);
+     if (text && pread(fileno(file), text, (size_t)*size, 0) != *size) {
+         free(text);
+         return NULL;
+     }
+     return text;
+ }
+ 
+ // The buffered output must print exactly what the printf reports print
+ static int bench_output_exact(void) {
+     sensor_station station;
+     quality_table table;
+     quality_result previous;
+     quality_result current;
+     prng_state rng;
+     FILE *expected_file = tmpfile();
+     FILE *actual_file = tmpfile();
+     output_stream output;
+     int errors = 0;
+     int saved;
+ 
+     if (!expected_file || !actual_file) return 1;
+ 
+     // Random bit patterns cover every exponent; printf is the reference
+     prng_seed(&rng, 42);
+     for (size_t i = 0; i < BENCH_FORMAT_VALUES; i++) {
+         uint32_t bits = prng_next(&rng);
+         int decimals = (int)(i % 10);
+         float value;
+         char expected[64];
+         char actual[64];
+ 
+         memcpy(&value, &bits, sizeof(value));
+         snprintf(expected, sizeof(expected), "%.*f", decimals, value);
+         *format_fixed(actual, value, decimals) = '\0';
+         if (strcmp(expected, actual) != 0) errors = 1;
+     }
+ 
+     quality_table_init_default(&table);
+     if (output_init(&output, fileno(actual_file)) < 0) return 1;
+     saved = redirect_stdout(fileno(expected_file));
+     if (saved < 0) return 1;
+ 
+     sensor_station_init(&station, 42);
+     for (size_t i = 0; i < BENCH_COMPARE_SAMPLES; i++) {
+         float values[NUM_PARAMS];
+         uint64_t timestamp_ms = BENCH_START_MS + i * READING_INTERVAL * 1000ULL;
+         int changes;
+ 
+         sensor_station_read(&station, timestamp_ms, values);
+         analyze_water_quality(&table, values, timestamp_ms, &current);
+ 
+         display_sensor_readings(values);
+         report_water_quality(&current);
+         report_quality_changes(i > 0 ? &previous : NULL, &current, values);
+ 
+         char *text = format_sensor_readings(output_record_begin(&output), values);
+         text = format_water_quality(text, &current);
+         text = format_quality_changes(text, output_time(&output, timestamp_ms),
+                                       i > 0 ? &previous : NULL, &current, values, &changes);
+         output_record_end(&output, text);
+         previous = current;
+     }
+ 
+     restore_stdout(saved);
+     output_destroy(&output);
+ 
+     long expected_size;
+     long actual_size;
+     char *expected = read_back(expected_file, &expected_size);
+     char *actual = read_back(actual_file, &actual_size);
+ 
+     if (!expected || !actual || expected_size != actual_size ||
+         memcmp(expected, actual, (size_t)expected_size) != 0) {
+         errors = 1;
+     }
+ 
+     free(expected);
+     free(actual);
+     fclose(expected_file);
+     fclose(actual_file);
+     return errors;
+ }
+ 
+ // Compression ratio and encode/decode speed of one stream per channel
+ static int bench_gorilla(void) {
+     uint64_t *timestamps = malloc(BENCH_SAMPLES * sizeof(uint64_t));
+     float *values[NUM_PARAMS];
+     uint8_t *streams[NUM_PARAMS];
+     size_t stream_bytes[NUM_PARAMS];
+     size_t capacity = GORILLA_BUFFER_SIZE(BENCH_SAMPLES);
+     size_t raw_bytes = BENCH_SAMPLES * (sizeof(uint64_t) + sizeof(float));
+     int errors = 0;
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         values[p] = malloc(BENCH_SAMPLES * sizeof(float));
+         streams[p] = malloc(capacity);
+     }
+ 
+     // Simulated readings every READING_INTERVAL seconds from one seeded station
+     simulate_columns(values, BENCH_SAMPLES, READING_INTERVAL * 1000);
+     for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+         timestamps[i] = BENCH_START_MS + i * READING_INTERVAL * 1000ULL;
+     }
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         gorilla_encoder encoder;
+         gorilla_decoder decoder;
+         double start;
+         double encode_seconds;
+         double decode_seconds;
+         char name[48];
+ 
+         start = now_seconds();
+         gorilla_encoder_init(&encoder, streams[p], capacity);
+         for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+             gorilla_encode(&encoder, timestamps[i], values[p][i]);
+         }
+         stream_bytes[p] = gorilla_encoder_finish(&encoder);
+         encode_seconds = now_seconds() - start;
+ 
+         start = now_seconds();
+         gorilla_decoder_init(&decoder, streams[p], stream_bytes[p], BENCH_SAMPLES);
+         for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+             uint64_t timestamp;
+             float value;
+             if (gorilla_decode(&decoder, &timestamp, &value) < 0 ||
+                 timestamp != timestamps[i] || memcmp(&value, &values[p][i], sizeof(value)) != 0) {
+                 errors++;
+                 break;
+             }
+         }
+         decode_seconds = now_seconds() - start;
+ 
+         parameter_result_name(name, sizeof(name), "gorilla", p, "ratio");
+         add_result(name, (double)raw_bytes / stream_bytes[p], "x");
+         parameter_result_name(name, sizeof(name), "gorilla", p, "encode");
+         add_result(name, raw_bytes / encode_seconds / 1e6, "MB/s");
+         parameter_result_name(name, sizeof(name), "gorilla", p, "decode");
+         add_result(name, raw_bytes / decode_seconds / 1e6, "MB/s");
+     }
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         free(values[p]);
+         free(streams[p]);
+     }
+     free(timestamps);
+ 
+     return errors;
+ }
+ 
+ // Sensor model throughput, per reading and in batches
+ static int bench_sensors(void) {
+     float *values[NUM_PARAMS];
+     float *noise = malloc(BENCH_SAMPLES * sizeof(float));
+     sensor_station station;
+     prng_lanes lanes;
+     double start;
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         values[p] = malloc(BENCH_SAMPLES * sizeof(float));
+     }
+ 
+     sensor_station_init(&station, 42);
+     start = now_seconds();
+     for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+         float reading[NUM_PARAMS];
+         sensor_station_read(&station, BENCH_START_MS + i * 1000ULL, reading);
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             values[p][i] = reading[p];
+         }
+     }
+     add_result("sensors.single", BENCH_SAMPLES / (now_seconds() - start), "readings/s");
+ 
+     sensor_station_init(&station, 42);
+     start = now_seconds();
+     sensor_station_read_batch(&station, BENCH_START_MS, 1000, BENCH_SAMPLES, values);
+     add_result("sensors.batch", BENCH_SAMPLES / (now_seconds() - start), "readings/s");
+ 
+     prng_lanes_seed(&lanes, 42);
+     start = now_seconds();
+     prng_fill_normal(&lanes, noise, BENCH_SAMPLES);
+     add_result("prng.normal_fill", BENCH_SAMPLES / (now_seconds() - start), "values/s");
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         free(values[p]);
+     }
+     free(noise);
+ 
+     return 0;
+ }
+ 
+ static void* ring_producer(void *arg) {
+     reading_ring *ring = arg;
+     reading_record record = { 0 };
+ 
+     for (uint64_t i = 0; i < BENCH_RING_RECORDS; i++) {
+         record.sequence = i;
+         // Retry instead of dropping so every record is timed end to end
+         while (reading_ring_push(ring, &record) < 0) {
+             sched_yield();
+         }
+     }
+ 
+     return NULL;
+ }
+ 
+ // Records per second through the acquisition/output queue
+ static int bench_ring(void) {
+     reading_ring ring;
+     reading_record record;
+     pthread_t producer;
+     uint64_t expected = 0;
+     int errors = 0;
+     double start;
+ 
+     if (reading_ring_init(&ring, 1024) < 0) return 1;
+ 
+     start = now_seconds();
+     pthread_create(&producer, NULL, ring_producer, &ring);
+     while (expected < BENCH_RING_RECORDS) {
+         if (!reading_ring_pop(&ring, &record)) {
+             sched_yield();
+             continue;
+         }
+         if (record.sequence != expected) errors = 1;
+         expected++;
+     }
+     pthread_join(producer, NULL);
+     add_result("ring.spsc", BENCH_RING_RECORDS / (now_seconds() - start), "records/s");
+ 
+     reading_ring_destroy(&ring);
+     return errors;
+ }
+ 
+ // Cost of timing one stage of the monitoring loop (clock read + histogram update)
+ static int bench_latency(void) {
+     static latency_histogram hist;
+     int errors = 0;
+     double start;
+ 
+     // Every bucket must map back to itself from its lowest value
+     for (int b = 0; b < LATENCY_BUCKETS; b++) {
+         if (latency_bucket(latency_bucket_low(b)) != b) errors = 1;
+     }
+ 
+     start = now_seconds();
+     for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+         uint64_t stage_start = latency_now_ns();
+         latency_record(&hist, latency_now_ns() - stage_start);
+     }
+     add_result("latency.stage_overhead", (now_seconds() - start) * 1e9 / BENCH_SAMPLES, "ns/stage");
+ 
+     if (hist.count != BENCH_SAMPLES) errors = 1;
+ 
+     // Prometheus buckets count values <= le: 63 ns is in the first one,
+     // 64 ns (a power of two) only in the next
+     static latency_histogram edge;
+     const char *edge_name = "edge";
+     char path[] = "/tmp/wq_latency_XXXXXX";
+     char text[4096];
+     int fd = mkstemp(path);
+     if (fd < 0) return 1;
+     close(fd);
+     latency_record(&edge, 63);
+     latency_record(&edge, 64);
+     if (latency_write_prometheus(path, "bench", &edge, &edge_name, 1) < 0) return 1;
+ 
+     // The export replaced the file, so read it under its name
+     fd = open(path, O_RDONLY);
+     ssize_t length = fd < 0 ? -1 : read(fd, text, sizeof(text) - 1);
+     close(fd);
+     unlink(path);
+     text[length > 0 ? length : 0] = '\0';
+     if (!strstr(text, "le=\"0.000000063\"} 1\n") || !strstr(text, "le=\"0.000000127\"} 2\n")) {
+         errors = 1;
+     }
+     return errors;
+ }
+ 
+ // Sliding window updates and queries spread over many stations
+ static int bench_windows(void) {
+     station_windows *windows = malloc(BENCH_WINDOW_STATIONS * sizeof(station_windows));
+     float *columns[NUM_PARAMS];
+     double start;
+ 
+     if (!windows) return 1;
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         columns[p] = malloc(BENCH_SAMPLES * sizeof(float));
+     }
+     simulate_columns(columns, BENCH_SAMPLES, 1000);
+ 
+     for (size_t s = 0; s < BENCH_WINDOW_STATIONS; s++) {
+         station_windows_init(&windows[s]);
+     }
+ 
+     // Every station reads once per simulated second
+     start = now_seconds();
+     for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+         float reading[NUM_PARAMS];
+         uint64_t timestamp_ms = BENCH_START_MS + (i / BENCH_WINDOW_STATIONS) * 1000ULL;
+ 
+         for (int p = 0; p < NUM_PARAMS; p++) reading[p] = columns[p][i];
+         station_windows_add(&windows[i % BENCH_WINDOW_STATIONS], timestamp_ms, reading, ~0u);
+     }
+     add_result("window.add", (now_seconds() - start) * 1e9 / BENCH_SAMPLES, "ns/reading");
+ 
+     uint64_t now_ms = BENCH_START_MS + (BENCH_SAMPLES / BENCH_WINDOW_STATIONS) * 1000ULL;
+     uint32_t counted = 0;
+     start = now_seconds();
+     for (size_t s = 0; s < BENCH_WINDOW_STATIONS; s++) {
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             for (int w = 0; w < NUM_WINDOWS; w++) {
+                 window_stats stats;
+                 sliding_window_stats(&windows[s].window[p][w], now_ms, &stats);
+                 if (w == WINDOW_1DAY) counted += stats.count;
+             }
+         }
+     }
+     add_result("window.stats", (now_seconds() - start) * 1e9 / BENCH_WINDOW_STATIONS, "ns/station");
+     add_result("window.memory", sizeof(station_windows), "bytes/station");
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         free(columns[p]);
+     }
+     free(windows);
+ 
+     // Every reading is still inside the 24 h windows
+     return counted == BENCH_SAMPLES * NUM_PARAMS ? 0 : 1;
+ }
+ 
+ // Level changes per day (each one an alert line and LED change) with and
+ // without hysteresis, and the cost of debouncing a reading
+ static int bench_hysteresis(void) {
+     size_t count = BENCH_HYSTERESIS_DAYS * 86400 / READING_INTERVAL;
+     float *columns[NUM_PARAMS];
+     quality_result *results = malloc(count * sizeof(quality_result));
+     quality_table table;
+     quality_stabilizer stabilizer;
+     uint64_t raw_changes = 0;
+     uint64_t stable_changes = 0;
+     double start;
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         columns[p] = malloc(count * sizeof(float));
+     }
+     simulate_columns(columns, count, READING_INTERVAL * 1000);
+ 
+     quality_table_init_default(&table);
+     quality_stabilizer_init(&stabilizer);
+ 
+     for (size_t i = 0; i < count; i++) {
+         float reading[NUM_PARAMS];
+ 
+         for (int p = 0; p < NUM_PARAMS; p++) reading[p] = columns[p][i];
+         analyze_water_quality(&table, reading, BENCH_START_MS, &results[i]);
+         for (int p = 0; i > 0 && p < NUM_PARAMS; p++) {
+             raw_changes += results[i].level[p] != results[i - 1].level[p];
+         }
+     }
+ 
+     // Debounces the raw results in place
+     start = now_seconds();
+     for (size_t i = 0; i < count; i++) {
+         float reading[NUM_PARAMS];
+ 
+         for (int p = 0; p < NUM_PARAMS; p++) reading[p] = columns[p][i];
+         stabilize_water_quality(&stabilizer, &table, reading, ~0u, &results[i]);
+     }
+     add_result("hysteresis.update", (now_seconds() - start) * 1e9 / count, "ns/reading");
+ 
+     for (size_t i = 1; i < count; i++) {
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             stable_changes += results[i].level[p] != results[i - 1].level[p];
+         }
+     }
+ 
+     add_result("hysteresis.changes_raw", (double)raw_changes / BENCH_HYSTERESIS_DAYS, "changes/day");
+     add_result("hysteresis.changes_stable", (double)stable_changes / BENCH_HYSTERESIS_DAYS,
+                "changes/day");
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         free(columns[p]);
+     }
+     free(results);
+ 
+     return stable_changes > raw_changes;
+ }
+ 
+ // Firmware thresholds as the float pipeline passed them to classify_with_margin()
+ typedef struct {
+     double full_scale;
+     float good_min;
+     float good_max;
+     float alert_min;
+     float alert_max;
+     float margin;
+ } firmware_channel;
+ 
+ #define FIRMWARE_CHANNEL(id, key, name, unit, pin, period_ms, good_min, good_max, alert_min, \
+                          alert_max, hysteresis, near, full_scale, ...) \
+     [PARAM_##id] = { full_scale, good_min, good_max, alert_min, alert_max, hysteresis },
+ 
+ static const firmware_channel firmware_channels[NUM_PARAMS] = {
+     WATER_QUALITY_CHANNELS(FIRMWARE_CHANNEL)
+ };
+ 
+ // Reading as the float firmware converted it
+ static float firmware_value(int param, uint16_t count) {
+     return (float)((double)count * firmware_channels[param].full_scale / ADC_MAX);
+ }
+ 
+ static uint8_t firmware_level(int param, float value, float margin) {
+     const firmware_channel *c = &firmware_channels[param];
+     return classify_with_margin(value, c->good_min, c->good_max, c->alert_min, c->alert_max, margin);
+ }
+ 
+ // The integer firmware pipeline against the float one it replaced, over
+ // every ADC count: classification must match at the normal and the
+ // hysteresis thresholds and the display must be the exactly rounded
+ // value. Host timings only hint at the AVR gap (soft-float there), see
+ // make avr-compare for flash.
+ static int bench_adc(void) {
+     int errors = 0;
+     uint32_t sink = 0;
+     double start;
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         uint64_t full_scale_centi = (uint64_t)(firmware_channels[p].full_scale * 100);
+ 
+         for (uint16_t count = 0; count <= ADC_MAX; count++) {
+             float value = firmware_value(p, count);
+ 
+             if (adc_classify(&adc_normal_bounds[p], count) != firmware_level(p, value, 0.0f)) errors = 1;
+             if (adc_classify(&adc_strict_bounds[p], count) !=
+                 firmware_level(p, value, firmware_channels[p].margin)) errors = 1;
+             if (adc_to_centi((uint8_t)p, count) != (count * full_scale_centi * 2 + ADC_MAX) / (2 * ADC_MAX)) {
+                 errors = 1;
+             }
+         }
+     }
+ 
+     // Float: convert, classify twice, then the digits uart_print_float() sent
+     start = now_seconds();
+     for (int pass = 0; pass < BENCH_ADC_PASSES; pass++) {
+         for (uint16_t count = 0; count <= ADC_MAX; count++) {
+             for (int p = 0; p < NUM_PARAMS; p++) {
+                 float value = firmware_value(p, count);
+                 int32_t whole = (int32_t)value;
+                 float fraction = value - whole;
+ 
+                 sink += firmware_level(p, value, 0.0f) + firmware_level(p, value, firmware_channels[p].margin);
+                 sink += (uint32_t)whole + (uint32_t)(fraction * 100);
+             }
+         }
+     }
+     add_result("adc.float_pipeline", (now_seconds() - start) * 1e9 / (BENCH_ADC_PASSES * (ADC_MAX + 1)),
+                "ns/reading");
+ 
+     start = now_seconds();
+     for (int pass = 0; pass < BENCH_ADC_PASSES; pass++) {
+         for (uint16_t count = 0; count <= ADC_MAX; count++) {
+             for (int p = 0; p < NUM_PARAMS; p++) {
+                 uint32_t centi = adc_to_centi((uint8_t)p, count);
+ 
+                 sink += adc_classify(&adc_normal_bounds[p], count) + adc_classify(&adc_strict_bounds[p], count);
+                 sink += centi / 100 + centi % 100;
+             }
+         }
+     }
+     add_result("adc.integer_pipeline", (now_seconds() - start) * 1e9 / (BENCH_ADC_PASSES * (ADC_MAX + 1)),
+                "ns/reading");
+ 
+     // Keeps the loops from being optimized away
+     if (sink == 0) errors = 1;
+     return errors;
+ }
+ 
+ // Emulated sensors: a fixed level per mux channel plus noise
+ typedef struct {
+     prng_state rng;
+     float level[16];                // 10-bit LSB, indexed by mux channel
+     double raw_error2;              // Squared error of every conversion
+     uint64_t raw_count;
+ } sampler_signal;
+ 
+ static uint16_t sampler_signal_read(uint8_t channel, void *context) {
+     sampler_signal *signal = context;
+     float value = signal->level[channel] + BENCH_SAMPLER_NOISE * prng_normal(&signal->rng);
+     long count = lrintf(value);
+ 
+     if (count < 0) count = 0;
+     if (count > 1023) count = 1023;
+ 
+     signal->raw_error2 += ((double)count - signal->level[channel]) * ((double)count - signal->level[channel]);
+     signal->raw_count++;
+     return (uint16_t)count;
+ }
+ 
+ // The firmware's ADC interrupt driven by the host register emulation:
+ // every decimated value must belong to its own channel despite the
+ // free-running mux pipeline, and oversampling must reduce the noise.
+ // Reports the handler cost and the effective bits gained.
+ static int bench_sampler(void) {
+     static const uint8_t pins[NUM_PARAMS] = { 5, 1, 2, 3, 0 };
+     static adc_sampler sampler;
+     sampler_signal signal;
+     uint8_t heads[NUM_PARAMS] = { 0 };
+     uint32_t full_after = 0;
+     double decimated_error2 = 0.0;
+     uint64_t decimated_count = 0;
+     int errors = 0;
+     double start;
+ 
+     memset(&signal, 0, sizeof(signal));
+     prng_seed(&signal.rng, 1);
+ 
+     // Levels far apart, with fractional parts only oversampling can resolve
+     for (int p = 0; p < NUM_PARAMS; p++) signal.level[pins[p]] = 100.3f + 180.0f * p;
+ 
+     host_registers_reset();
+     adc_sampler_start(&sampler, pins);
+ 
+     for (uint32_t i = 0; i < BENCH_SAMPLER_CONVERSIONS; i++) {
+         if (!host_adc_convert(sampler_signal_read, &signal)) {
+             errors = 1;
+             break;
+         }
+         adc_sampler_isr(&sampler);
+         if (full_after == 0 && adc_sampler_full(&sampler)) full_after = i + 1;
+ 
+         for (uint8_t p = 0; p < NUM_PARAMS; p++) {
+             if (sampler.ring[p].head == heads[p]) continue;
+             heads[p] = sampler.ring[p].head;
+ 
+             double error = adc_sampler_latest(&sampler, p) / (double)(1 << ADC_OVERSAMPLE_BITS)
+                            - signal.level[pins[p]];
+             if (error > 2.0 || error < -2.0) errors = 1;
+             decimated_error2 += error * error;
+             decimated_count++;
+         }
+     }
+ 
+     double raw_rms = sqrt(signal.raw_error2 / signal.raw_count);
+     double decimated_rms = decimated_count ? sqrt(decimated_error2 / decimated_count) : raw_rms;
+     add_result("sampler.noise_raw", raw_rms, "lsb_rms");
+     add_result("sampler.noise_decimated", decimated_rms, "lsb_rms");
+     add_result("sampler.bits_gained", log2(raw_rms / decimated_rms), "bits");
+     if (!adc_sampler_ready(&sampler) || decimated_rms >= raw_rms) errors = 1;
+ 
+     // What read_sensors() waits for after every wakeup: 13 ADC clocks of
+     // 8 us per conversion
+     add_result("sampler.fill_time", full_after * 13 * 8e-3, "ms");
+     if (full_after < NUM_PARAMS * SAMPLER_RING_SIZE * SAMPLER_OVERSAMPLES) errors = 1;
+ 
+     // Handler alone, on a constant input
+     start = now_seconds();
+     for (uint32_t i = 0; i < BENCH_SAMPLER_CONVERSIONS; i++) {
+         ADC = (uint16_t)(i & 0x3FF);
+         adc_sampler_isr(&sampler);
+     }
+     add_result("sampler.isr", (now_seconds() - start) * 1e9 / BENCH_SAMPLER_CONVERSIONS, "ns/conversion");
+ 
+     return errors;
+ }
+ 
+ // Bytes the emulated USART put on the wire
+ typedef struct {
+     uint8_t *data;
+     size_t size;
+     size_t capacity;
+ } uart_wire;
+ 
+ static void uart_wire_append(uint8_t byte, void *context) {
+     uart_wire *wire = context;
+     if (wire->size < wire->capacity) wire->data[wire->size] = byte;
+     wire->size++;
+ }
+ 
+ // Runs the transmitter until the queue is empty, as the interrupt would
+ static void uart_drain(uart_tx_queue *queue, uart_wire *wire) {
+     for (;;) {
+         if (host_uart_udre_pending()) {
+             uart_tx_isr(queue);
+         } else if (!host_uart_shift(uart_wire_append, wire)) {
+             break;
+         }
+     }
+ }
+ 
+ // Overflows a queue that is not draining and checks which bytes survive
+ static int uart_overflow(uart_overflow_policy policy) {
+     static uint8_t sent[2 * UART_TX_BUFFER_SIZE];
+     static uint8_t received[2 * UART_TX_BUFFER_SIZE];
+     uart_tx_queue queue;
+     uart_wire wire = { received, 0, sizeof(received) };
+     size_t kept = UART_TX_BUFFER_SIZE - 1;
+ 
+     host_registers_reset();
+     uart_tx_init(&queue, policy);
+ 
+     // Interrupts are off for the burst, so nothing drains
+     for (size_t i = 0; i < sizeof(sent); i++) {
+         sent[i] = (uint8_t)(i * 7);
+         uart_tx_enqueue(&queue, sent[i]);
+     }
+     uart_drain(&queue, &wire);
+ 
+     const uint8_t *expected = policy == UART_DROP_NEWEST ? sent : sent + sizeof(sent) - kept;
+     if (wire.size != kept || memcmp(received, expected, kept) != 0) return 1;
+     return uart_tx_dropped(&queue) != sizeof(sent) - kept;
+ }
+ 
+ // Time the main loop spends handing one report to the UART: queued for
+ // the interrupt on the emulated USART, against waiting for the line at
+ // UART_BAUD (10 bits per byte) as the polling uart_transmit() did
+ static int bench_uart(void) {
+     static char report[OUTPUT_RECORD_SIZE];
+     static uint8_t received[OUTPUT_RECORD_SIZE];
+     float reading[NUM_PARAMS] = { 7.1f, 22.4f, 3.2f, 280.0f, 7.9f };
+     quality_table table;
+     quality_result result;
+     uart_tx_queue queue;
+     int errors = 0;
+     double queued_s = 0.0;
+ 
+     quality_table_init_default(&table);
+     analyze_water_quality(&table, reading, BENCH_START_MS, &result);
+ 
+     char *end = format_sensor_readings(report, reading);
+     end = format_water_quality(end, &result);
+     end = format_text(end, "\nWaiting for next reading...\n"
+                            "------------------------------------------------------\n\n");
+     size_t length = (size_t)(end - report);
+ 
+     if (length >= UART_TX_BUFFER_SIZE) return 1;
+ 
+     host_registers_reset();
+     uart_tx_init(&queue, UART_DROP_NEWEST);
+ 
+     for (int r = 0; r < BENCH_UART_REPORTS; r++) {
+         uart_wire wire = { received, 0, sizeof(received) };
+         double start = now_seconds();
+ 
+         for (size_t i = 0; i < length; i++) uart_tx_enqueue(&queue, (uint8_t)report[i]);
+         queued_s += now_seconds() - start;
+ 
+         uart_drain(&queue, &wire);
+         if (wire.size != length || memcmp(received, report, length) != 0) errors = 1;
+     }
+     if (uart_tx_dropped(&queue) != 0) errors = 1;
+ 
+     add_result("uart.report_bytes", (double)length, "bytes");
+     add_result("uart.report_polling", length * 10.0 * 1e3 / UART_BAUD, "ms/report");
+     add_result("uart.report_queued", queued_s * 1e6 / BENCH_UART_REPORTS, "us/report");
+ 
+     errors |= uart_overflow(UART_DROP_NEWEST);
+     errors |= uart_overflow(UART_DROP_OLDEST);
+     return errors;
+ }
+ 
+ // Matches decoded readings against the encoded ones by sequence number
+ typedef struct {
+     const int32_t *values;          // NUM_PARAMS per reading
+     const uint8_t *levels;
+     size_t readings;
+     size_t next;                    // First reading the next frame can be
+     uint64_t matched;
+     uint64_t mismatched;
+ } telemetry_check;
+ 
+ static void telemetry_check_reading(const telemetry_reading *reading, void *context) {
+     telemetry_check *check = context;
+     size_t i = check->next;
+ 
+     // Fewer than 256 frames are ever lost in a row here
+     while (i < check->readings && (uint8_t)i != reading->sequence) i++;
+     if (i == check->readings ||
+         memcmp(reading->values, check->values + i * NUM_PARAMS, sizeof(reading->values)) != 0 ||
+         memcmp(reading->levels, check->levels + i * NUM_PARAMS, sizeof(reading->levels)) != 0) {
+         check->mismatched++;
+     } else {
+         check->matched++;
+     }
+     check->next = i + 1;
+ }
+ 
+ static void telemetry_sum_reading(const telemetry_reading *reading, void *context) {
+     *(int64_t *)context += reading->values[PARAM_TDS];
+ }
+ 
+ // Decodes stream in chunk-byte calls (0: all at once), as a reader of a
+ // pipe would, and returns the readings that matched
+ static uint64_t telemetry_check_stream(const uint8_t *stream, size_t size, size_t chunk,
+                                        telemetry_check *check) {
+     telemetry_decoder decoder;
+     size_t position = 0;
+ 
+     telemetry_decoder_init(&decoder);
+     check->next = 0;
+     check->matched = 0;
+     check->mismatched = 0;
+ 
+     // Unconsumed bytes are passed again with the next chunk
+     while (position < size) {
+         size_t end = chunk == 0 || size - position < chunk ? size : position + chunk;
+         position += telemetry_decode(&decoder, stream + position, end - position, end == size,
+                                      telemetry_check_reading, check);
+     }
+     return check->mismatched ? 0 : check->matched;
+ }
+ 
+ // Binary frames of simulated readings: size against the text report,
+ // encode and decode speed, and recovery from corrupted frames
+ static int bench_telemetry(void) {
+     const size_t n = BENCH_TELEMETRY_READINGS;
+     float *columns[NUM_PARAMS];
+     int32_t *values = malloc(n * NUM_PARAMS * sizeof(*values));
+     uint8_t *levels = malloc(n * NUM_PARAMS);
+     uint8_t *stream = malloc(n * TELEMETRY_MAX_FRAME);
+     size_t *offsets = malloc(n * sizeof(*offsets));
+     quality_table table;
+     int errors = 0;
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         columns[p] = malloc(n * sizeof(float));
+         if (!columns[p]) return 1;
+     }
+     if (!values || !levels || !stream || !offsets) return 1;
+ 
+     simulate_columns(columns, n, 5000);
+     quality_table_init_default(&table);
+     for (size_t i = 0; i < n; i++) {
+         float reading[NUM_PARAMS];
+ 
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             reading[p] = columns[p][i];
+             values[i * NUM_PARAMS + p] = (int32_t)lrintf(reading[p] * 100.0f);
+         }
+         classify_reading(&table, reading, levels + i * NUM_PARAMS);
+     }
+ 
+     telemetry_encoder encoder;
+     size_t size = 0;
+     double start = now_seconds();
+ 
+     telemetry_encoder_init(&encoder);
+     for (size_t i = 0; i < n; i++) {
+         offsets[i] = size;
+         size += telemetry_encode(&encoder, values + i * NUM_PARAMS, levels + i * NUM_PARAMS,
+                                  stream + size);
+     }
+     double encode_s = now_seconds() - start;
+ 
+     double decode_s = INFINITY;
+     int64_t sum = 0;
+     for (int r = 0; r < BENCH_REPEATS; r++) {
+         telemetry_decoder decoder;
+ 
+         telemetry_decoder_init(&decoder);
+         start = now_seconds();
+         telemetry_decode(&decoder, stream, size, 1, telemetry_sum_reading, &sum);
+         decode_s = fmin(decode_s, now_seconds() - start);
+         if (decoder.stats.readings != n) errors = 1;
+     }
+     if (sum == 0) errors = 1;
+ 
+     // A clean stream decodes exactly, whole or in pieces
+     telemetry_check check = { values, levels, n, 0, 0, 0 };
+     if (telemetry_check_stream(stream, size, 0, &check) != n) errors = 1;
+     if (telemetry_check_stream(stream, size, BENCH_TELEMETRY_CHUNK, &check) != n) errors = 1;
+ 
+     // Corrupted frames are dropped (with the delta frames after them up to
+     // the next keyframe), never delivered with wrong values
+     prng_state rng;
+     prng_seed(&rng, 7);
+     for (size_t i = 0; i < n; i += BENCH_TELEMETRY_CORRUPT) {
+         size_t frame_size = (i + 1 < n ? offsets[i + 1] : size) - offsets[i];
+         uint32_t bit = prng_next(&rng) % (uint32_t)(frame_size * 8);
+         stream[offsets[i] + bit / 8] ^= (uint8_t)(1u << (bit % 8));
+     }
+     uint64_t delivered = telemetry_check_stream(stream, size, BENCH_TELEMETRY_CHUNK, &check);
+     if (delivered == 0 || delivered >= n) errors = 1;
+ 
+     add_result("telemetry.frame_bytes", (double)size / n, "bytes");
+     add_result("telemetry.encode", encode_s * 1e9 / n, "ns/frame");
+     add_result("telemetry.decode", size / decode_s / 1e6, "MB/s");
+     add_result("telemetry.corrupt_delivered", delivered * 100.0 / n, "%");
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) free(columns[p]);
+     free(values);
+     free(levels);
+     free(stream);
+     free(offsets);
+     return errors;
+ }
+ 
+ // One firmware sampling policy run over a station's second-by-second
+ // counts: when each reading was taken and its debounced overall level
+ typedef struct {
+     uint32_t *time_s;
+     uint8_t *overall;
+     size_t readings;
+ } sampling_run;
+ 
+ static void run_sampling(const uint16_t *counts, size_t seconds, int adaptive, sampling_run *run) {
+     level_filter filters[NUM_PARAMS];
+     level_filter_config filter_config;
+     adaptive_schedule schedule;
+     adaptive_config config;
+ 
+     level_filter_config_init_default(&filter_config);
+     for (int p = 0; p < NUM_PARAMS; p++) level_filter_init(&filters[p]);
+     adaptive_config_init_default(&config);
+     adaptive_init(&schedule, &config);
+ 
+     run->readings = 0;
+     for (size_t t = 0; t < seconds;) {
+         const uint16_t *reading = counts + t * NUM_PARAMS;
+         uint8_t levels[NUM_PARAMS];
+         uint8_t overall = QUALITY_GOOD;
+ 
+         // stable_quality() of the firmware
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             levels[p] = level_filter_update(&filters[p], &filter_config,
+                                             adc_classify(&adc_normal_bounds[p], reading[p]),
+                                             adc_classify(&adc_strict_bounds[p], reading[p]));
+             if (levels[p] > overall) overall = levels[p];
+         }
+ 
+         run->time_s[run->readings] = (uint32_t)t;
+         run->overall[run->readings] = overall;
+         run->readings++;
+ 
+         t += adaptive ? adaptive_update(&schedule, &config, reading, levels) : READING_INTERVAL;
+     }
+ }
+ 
+ // Seconds from each sustained escalation to the first reading whose
+ // debounced level shows it; -1 when a run never does
+ static int detection_latencies(const sampling_run *run, const uint32_t *events,
+                                const uint8_t *event_levels, size_t event_count, double *latency) {
+     size_t r = 0;
+ 
+     for (size_t e = 0; e < event_count; e++) {
+         while (r < run->readings && run->time_s[r] < events[e]) r++;
+ 
+         size_t seen = r;
+         while (seen < run->readings && run->overall[seen] < event_levels[e]) seen++;
+         if (seen == run->readings) return -1;
+ 
+         latency[e] = run->time_s[seen] - events[e];
+     }
+     return 0;
+ }
+ 
+ static double mean_of(const double *values, size_t count) {
+     double sum = 0.0;
+     for (size_t i = 0; i < count; i++) sum += values[i];
+     return count ? sum / count : 0.0;
+ }
+ 
+ static double max_of(const double *values, size_t count) {
+     double max = 0.0;
+     for (size_t i = 0; i < count; i++) max = fmax(max, values[i]);
+     return max;
+ }
+ 
+ // A full-scale glitch and its recovery: the smoothed slope has to follow
+ // the recovery step, not wrap around in 16 bits
+ static int adaptive_spike_recovers(void) {
+     static const uint16_t rest[2] = { ADC_MAX, 0 };
+     adaptive_config config;
+     adaptive_schedule schedule;
+     uint8_t levels[NUM_PARAMS];
+ 
+     adaptive_config_init_default(&config);
+     memset(levels, QUALITY_GOOD, sizeof(levels));
+     for (int r = 0; r < 2; r++) {
+         uint16_t steady[NUM_PARAMS];
+         uint16_t spike[NUM_PARAMS];
+ 
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             steady[p] = rest[r];
+             spike[p] = ADC_MAX - rest[r];
+         }
+         adaptive_init(&schedule, &config);
+         adaptive_update(&schedule, &config, steady, levels);
+         adaptive_update(&schedule, &config, spike, levels);
+         adaptive_update(&schedule, &config, steady, levels);
+ 
+         // The recovery moves the slope a quarter of the way from the glitch
+         // step to the recovery step: -8184 + (32736 + 8184) / 4 = 2046
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             int32_t step = ((int32_t)rest[r] - spike[p]) * ADAPTIVE_SLOPE_SCALE;
+             int32_t glitch = -step / (1 << ADAPTIVE_SLOPE_SHIFT);
+             if (schedule.slope[p] != glitch + (step - glitch) / (1 << ADAPTIVE_SLOPE_SHIFT)) {
+                 return 0;
+             }
+         }
+     }
+     return 1;
+ }
+ 
+ // The firmware's adaptive sampling against the fixed READING_INTERVAL on
+ // simulated stations, with the exact firmware pipeline (ADC counts,
+ // hysteresis, debounce): readings taken, and how long each sustained
+ // escalation of the second-by-second level takes to show up
+ static int bench_adaptive(void) {
+     const size_t seconds = BENCH_ADAPTIVE_DAYS * 86400;
+     float *columns[NUM_PARAMS];
+     uint16_t *counts = malloc(seconds * NUM_PARAMS * sizeof(*counts));
+     uint8_t *level = malloc(seconds);
+     uint32_t *events = malloc(seconds * sizeof(*events));
+     uint8_t *event_levels = malloc(seconds);
+     double *fixed_latency = malloc(seconds * sizeof(double));
+     double *adaptive_latency = malloc(seconds * sizeof(double));
+     sampling_run fixed = { malloc(seconds * sizeof(uint32_t)), malloc(seconds), 0 };
+     sampling_run adaptive = { malloc(seconds * sizeof(uint32_t)), malloc(seconds), 0 };
+     size_t fixed_readings = 0;
+     size_t adaptive_readings = 0;
+     size_t event_total = 0;
+     double fixed_sum = 0.0;
+     double adaptive_sum = 0.0;
+     double fixed_max = 0.0;
+     double adaptive_max = 0.0;
+     int errors = 0;
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         columns[p] = malloc(seconds * sizeof(float));
+         if (!columns[p]) return 1;
+     }
+     if (!counts || !level || !events || !event_levels || !fixed_latency || !adaptive_latency ||
+         !fixed.time_s || !fixed.overall || !adaptive.time_s || !adaptive.overall) return 1;
+ 
+     for (int s = 0; s < BENCH_ADAPTIVE_STATIONS; s++) {
+         sensor_station station;
+ 
+         sensor_station_init(&station, 1000 + s);
+         sensor_station_read_batch(&station, BENCH_START_MS, 1000, seconds, columns);
+ 
+         // What the firmware would read each second, and its undebounced level
+         for (size_t t = 0; t < seconds; t++) {
+             uint8_t overall = QUALITY_GOOD;
+ 
+             for (int p = 0; p < NUM_PARAMS; p++) {
+                 long count = lrintf(columns[p][t] * ADC_MAX / firmware_channels[p].full_scale);
+                 if (count < 0) count = 0;
+                 if (count > ADC_MAX) count = ADC_MAX;
+ 
+                 counts[t * NUM_PARAMS + p] = (uint16_t)count;
+                 uint8_t raw = adc_classify(&adc_normal_bounds[p], (uint16_t)count);
+                 if (raw > overall) overall = raw;
+             }
+             level[t] = overall;
+         }
+ 
+         // Escalations that hold for BENCH_ADAPTIVE_SUSTAINED_S
+         size_t event_count = 0;
+         size_t held = 0;            // Seconds from t on at or above level[t]
+         for (size_t t = seconds - 1; t > 0; t--) {
+             held = t + 1 < seconds && level[t + 1] >= level[t] ? held + 1 : 1;
+             if (level[t] > level[t - 1] && held >= BENCH_ADAPTIVE_SUSTAINED_S) {
+                 events[event_count] = (uint32_t)t;
+                 event_levels[event_count] = level[t];
+                 event_count++;
+             }
+         }
+         // Found backwards; detection_latencies() walks forwards
+         for (size_t e = 0; e < event_count / 2; e++) {
+             uint32_t time = events[e];
+             uint8_t event_level = event_levels[e];
+ 
+             events[e] = events[event_count - 1 - e];
+             event_levels[e] = event_levels[event_count - 1 - e];
+             events[event_count - 1 - e] = time;
+             event_levels[event_count - 1 - e] = event_level;
+         }
+ 
+         run_sampling(counts, seconds, 0, &fixed);
+         run_sampling(counts, seconds, 1, &adaptive);
+         fixed_readings += fixed.readings;
+         adaptive_readings += adaptive.readings;
+ 
+         if (detection_latencies(&fixed, events, event_levels, event_count, fixed_latency) < 0 ||
+             detection_latencies(&adaptive, events, event_levels, event_count, adaptive_latency) < 0) {
+             errors = 1;
+             continue;
+         }
+         event_total += event_count;
+         fixed_sum += mean_of(fixed_latency, event_count) * event_count;
+         adaptive_sum += mean_of(adaptive_latency, event_count) * event_count;
+         fixed_max = fmax(fixed_max, max_of(fixed_latency, event_count));
+         adaptive_max = fmax(adaptive_max, max_of(adaptive_latency, event_count));
+     }
+ 
+     // Adaptive sampling has to save readings to be worth it
+     double station_days = (double)BENCH_ADAPTIVE_STATIONS * BENCH_ADAPTIVE_DAYS;
+     if (event_total == 0 || adaptive_readings >= fixed_readings) errors = 1;
+     if (!adaptive_spike_recovers()) errors = 1;
+ 
+     add_result("adaptive.readings_fixed", fixed_readings / station_days, "readings/day");
+     add_result("adaptive.readings_adaptive", adaptive_readings / station_days, "readings/day");
+     add_result("adaptive.escalations", event_total / station_days, "events/day");
+     add_result("adaptive.latency_fixed_mean", event_total ? fixed_sum / event_total : 0.0, "s");
+     add_result("adaptive.latency_adaptive_mean", event_total ? adaptive_sum / event_total : 0.0, "s");
+     add_result("adaptive.latency_fixed_max", fixed_max, "s");
+     add_result("adaptive.latency_adaptive_max", adaptive_max, "s");
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) free(columns[p]);
+     free(counts);
+     free(level);
+     free(events);
+     free(event_levels);
+     free(fixed_latency);
+     free(adaptive_latency);
+     free(fixed.time_s);
+     free(fixed.overall);
+     free(adaptive.time_s);
+     free(adaptive.overall);
+     return errors;
+ }
+ 
+ // Classification loop reading its thresholds through the RCU pointer
+ typedef struct {
+     rcu_domain *rcu;
+     rcu_reader *reader;
+     threshold_profile **live;
+     const float *const *columns;
+     int stop;
+     uint64_t readings;
+     uint64_t freed_seen;            // Readings that found a freed (poisoned) table
+     uint64_t overall_sum;
+ } profile_reader_state;
+ 
+ static void* profile_reader(void *arg) {
+     profile_reader_state *state = arg;
+     rcu_reader *reader = state->reader;
+     size_t i = 0;
+ 
+     while (!__atomic_load_n(&state->stop, __ATOMIC_RELAXED)) {
+         const quality_table *table = &__atomic_load_n(state->live, __ATOMIC_ACQUIRE)->table;
+         float reading[NUM_PARAMS];
+         uint8_t levels[NUM_PARAMS];
+ 
+         for (int p = 0; p < NUM_PARAMS; p++) reading[p] = state->columns[p][i];
+         state->overall_sum += classify_reading(table, reading, levels);
+         if (isnan(table->param[PARAM_PH].good_min)) state->freed_seen++;
+ 
+         rcu_quiescent(state->rcu, reader);
+         state->readings++;
+         i = (i + 1) % BENCH_SAMPLES;
+     }
+ 
+     rcu_offline(reader);
+     return NULL;
+ }
+ 
+ // Cost of reading the thresholds through the reloadable profile pointer,
+ // and of reloads while a reader keeps classifying. Retired tables are
+ // poisoned instead of freed, so a reader using one is detected.
+ static int bench_profiles(void) {
+     threshold_profile *profiles[BENCH_PROFILE_RELOADS + 1];
+     threshold_profile *live;
+     rcu_domain rcu;
+     profile_reader_state state;
+     float *columns[NUM_PARAMS];
+     int line;
+     int errors = 0;
+     double start;
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         columns[p] = malloc(BENCH_SAMPLES * sizeof(float));
+     }
+     simulate_columns(columns, BENCH_SAMPLES, 1000);
+ 
+     for (int r = 0; r <= BENCH_PROFILE_RELOADS; r++) {
+         profiles[r] = profile_create(NULL, NULL, &line);
+         if (!profiles[r]) return 1;
+     }
+     live = profiles[0];
+     rcu_init(&rcu);
+ 
+     // Single thread: direct table against pointer load + quiescent state
+     rcu_reader *reader = rcu_register(&rcu);
+     uint64_t sums[2] = { 0, 0 };
+     double best[2] = { 1e9, 1e9 };
+     for (int repeat = 0; repeat < BENCH_REPEATS; repeat++) {
+         for (int variant = 0; variant < 2; variant++) {
+             start = now_seconds();
+             for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+                 const quality_table *table = variant ? &__atomic_load_n(&live, __ATOMIC_ACQUIRE)->table
+                                                      : &profiles[0]->table;
+                 float reading[NUM_PARAMS];
+                 uint8_t levels[NUM_PARAMS];
+ 
+                 for (int p = 0; p < NUM_PARAMS; p++) reading[p] = columns[p][i];
+                 sums[variant] += classify_reading(table, reading, levels);
+                 if (variant) rcu_quiescent(&rcu, reader);
+             }
+             double elapsed = now_seconds() - start;
+             if (elapsed < best[variant]) best[variant] = elapsed;
+         }
+     }
+     rcu_offline(reader);
+     add_result("profile.classify_direct", best[0] * 1e9 / BENCH_SAMPLES, "ns/reading");
+     add_result("profile.classify_rcu", best[1] * 1e9 / BENCH_SAMPLES, "ns/reading");
+     if (sums[0] != sums[1]) errors = 1;
+ 
+     // Reloads against a reader that never stops classifying
+     state.rcu = &rcu;
+     state.reader = rcu_register(&rcu);     // Online already, so reloads wait for the thread
+     state.live = &live;
+     state.columns = (const float *const *)columns;
+     state.stop = 0;
+     state.readings = 0;
+     state.freed_seen = 0;
+     state.overall_sum = 0;
+ 
+     pthread_t thread;
+     pthread_create(&thread, NULL, profile_reader, &state);
+ 
+     start = now_seconds();
+     for (int r = 1; r <= BENCH_PROFILE_RELOADS; r++) {
+         threshold_profile *old = __atomic_exchange_n(&live, profiles[r], __ATOMIC_ACQ_REL);
+         rcu_synchronize(&rcu);
+         old->table.param[PARAM_PH].good_min = NAN;
+     }
+     add_result("profile.reload", (now_seconds() - start) * 1e3 / BENCH_PROFILE_RELOADS, "ms/reload");
+ 
+     __atomic_store_n(&state.stop, 1, __ATOMIC_RELAXED);
+     pthread_join(thread, NULL);
+     add_result("profile.reader_readings", (double)state.readings, "readings");
+     if (state.freed_seen > 0 || state.readings == 0) errors = 1;
+ 
+     rcu_destroy(&rcu);
+     for (int r = 0; r <= BENCH_PROFILE_RELOADS; r++) {
+         free(profiles[r]);
+     }
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         free(columns[p]);
+     }
+ 
+     return errors;
+ }
+ 
+ // Trend updates and forecasts for every reading of many stations
+ static int bench_trends(void) {
+     station_trends *trends = malloc(BENCH_WINDOW_STATIONS * sizeof(station_trends));
+     float *columns[NUM_PARAMS];
+     quality_table table;
+     trend_config config;
+     double start;
+ 
+     if (!trends) return 1;
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         columns[p] = malloc(BENCH_SAMPLES * sizeof(float));
+     }
+     simulate_columns(columns, BENCH_SAMPLES, 1000);
+ 
+     quality_table_init_default(&table);
+     trend_config_init_default(&config);
+     for (size_t s = 0; s < BENCH_WINDOW_STATIONS; s++) {
+         station_trends_init(&trends[s]);
+     }
+ 
+     start = now_seconds();
+     for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+         float reading[NUM_PARAMS];
+         uint64_t timestamp_ms = BENCH_START_MS + (i / BENCH_WINDOW_STATIONS) * 1000ULL;
+ 
+         for (int p = 0; p < NUM_PARAMS; p++) reading[p] = columns[p][i];
+         station_trends_update(&trends[i % BENCH_WINDOW_STATIONS], &config, &table,
+                               timestamp_ms, reading, ~0u);
+     }
+     add_result("trend.update", (now_seconds() - start) * 1e9 / BENCH_SAMPLES, "ns/reading");
+     add_result("trend.memory", sizeof(station_trends), "bytes/station");
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         free(columns[p]);
+     }
+     free(trends);
+ 
+     return 0;
+ }
+ 
+ // Client side of the server load test: one subscriber socket and the R
+ // lines it has received
+ typedef struct {
+     int fd;
+     char line[SERVER_MESSAGE_MAX + 64];
+     size_t length;
+     uint64_t readings;
+     uint64_t next_sequence;
+     int header_seen;
+     int errors;
+ } server_subscriber;
+ 
+ static int server_connect(const char *path, const char *command) {
+     struct sockaddr_un address;
+     int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+ 
+     if (fd < 0) return -1;
+ 
+     memset(&address, 0, sizeof(address));
+     address.sun_family = AF_UNIX;
+     snprintf(address.sun_path, sizeof(address.sun_path), "%s", path);
+     if (connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+         write(fd, command, strlen(command)) != (ssize_t)strlen(command)) {
+         close(fd);
+         return -1;
+     }
+     return fd;
+ }
+ 
+ // Splits what arrived into lines; R line sequence numbers must increase
+ static void server_subscriber_take(server_subscriber *s, const char *data, size_t size) {
+     for (size_t i = 0; i < size; i++) {
+         if (data[i] != '\n') {
+             if (s->length < sizeof(s->line) - 1) s->line[s->length++] = data[i];
+             continue;
+         }
+ 
+         s->line[s->length] = '\0';
+         if (s->line[0] == '#') {
+             s->header_seen = 1;
+         } else if (s->line[0] == 'R') {
+             uint64_t sequence = strtoull(s->line + 2, NULL, 10);
+             if (!s->header_seen || (s->readings > 0 && sequence < s->next_sequence)) s->errors++;
+             s->next_sequence = sequence + 1;
+             s->readings++;
+         } else if (s->line[0] != 'C') {
+             s->errors++;
+         }
+         s->length = 0;
+     }
+ }
+ 
+ // Reads whatever is waiting; 0 when the server closed the connection
+ static int server_subscriber_read(server_subscriber *s) {
+     char buffer[65536];
+ 
+     for (;;) {
+         ssize_t got = recv(s->fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+         if (got > 0) {
+             server_subscriber_take(s, buffer, (size_t)got);
+             continue;
+         }
+         return got == 0 ? 0 : 1;
+     }
+ }
+ 
+ // Blocks until the subscriber has its header line, i.e. is subscribed
+ static int server_subscriber_wait_header(server_subscriber *s) {
+     while (!s->header_seen) {
+         char c;
+         if (read(s->fd, &c, 1) != 1) return -1;
+         server_subscriber_take(s, &c, 1);
+     }
+     return 0;
+ }
+ 
+ static void server_publish_reading(telemetry_server *server, const quality_table *table,
+                                    float *const columns[NUM_PARAMS], size_t i) {
+     float values[NUM_PARAMS];
+     quality_result result;
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) values[p] = columns[p][i % BENCH_SERVER_HISTORY_ROWS];
+     analyze_water_quality(table, values, BENCH_START_MS + i * 1000, &result);
+     server_publish(server, i, values, &result);
+ }
+ 
+ // Thousands of local subscribers, one that stops reading, and a history
+ // query sent with sendfile
+ static int bench_server(void) {
+     char dir[] = "/tmp/water_quality_bench_XXXXXX";
+     char socket_path[64];
+     const char *addresses[1] = { socket_path };
+     float *columns[NUM_PARAMS];
+     quality_table table;
+     server_stats stats;
+     struct rlimit limit;
+     size_t clients = BENCH_SERVER_CLIENTS;
+     int errors = 0;
+ 
+     if (!mkdtemp(dir)) return 1;
+     snprintf(socket_path, sizeof(socket_path), "%s/server.sock", dir);
+ 
+     // Both ends of every connection live in this process
+     if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+         if (limit.rlim_cur < limit.rlim_max) {
+             limit.rlim_cur = limit.rlim_max;
+             setrlimit(RLIMIT_NOFILE, &limit);
+         }
+         if (limit.rlim_cur != RLIM_INFINITY && clients * 2 + 64 > limit.rlim_cur) {
+             clients = (limit.rlim_cur - 64) / 2;
+         }
+     }
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         columns[p] = malloc(BENCH_SERVER_HISTORY_ROWS * sizeof(float));
+         if (!columns[p]) return 1;
+     }
+     simulate_columns(columns, BENCH_SERVER_HISTORY_ROWS, 1000);
+     quality_table_init_default(&table);
+ 
+     history_store *store = history_open(dir);
+     if (!store) return 1;
+     for (size_t i = 0; i < BENCH_SERVER_HISTORY_ROWS; i++) {
+         float values[NUM_PARAMS];
+         for (int p = 0; p < NUM_PARAMS; p++) values[p] = columns[p][i];
+         history_append(store, BENCH_START_MS + i * 1000, values);
+         if (i % BENCH_SERVER_HISTORY_FLUSH == 0) history_flush(store);
+     }
+     if (history_close(store) != 0) errors = 1;
+ 
+     telemetry_server *server = server_start(addresses, 1, dir);
+     server_subscriber *subscribers = calloc(clients, sizeof(*subscribers));
+     if (!server || !subscribers) return 1;
+ 
+     // Fan-out: every subscriber gets every reading
+     double start = now_seconds();
+     for (size_t c = 0; c < clients; c++) {
+         subscribers[c].fd = server_connect(socket_path, "live\n");
+         if (subscribers[c].fd < 0 || server_subscriber_wait_header(&subscribers[c]) < 0) return 1;
+     }
+     double connect_s = now_seconds() - start;
+ 
+     int epoll_fd = epoll_create1(0);
+     for (size_t c = 0; c < clients; c++) {
+         struct epoll_event event = { .events = EPOLLIN, .data.ptr = &subscribers[c] };
+         epoll_ctl(epoll_fd, EPOLL_CTL_ADD, subscribers[c].fd, &event);
+     }
+ 
+     start = now_seconds();
+     for (size_t i = 0; i < BENCH_SERVER_READINGS; i++) server_publish_reading(server, &table, columns, i);
+ 
+     size_t complete = 0;
+     while (complete < clients && now_seconds() - start < 30.0) {
+         struct epoll_event events[256];
+         int count = epoll_wait(epoll_fd, events, 256, 100);
+ 
+         for (int e = 0; e < count; e++) {
+             server_subscriber *s = events[e].data.ptr;
+             uint64_t before = s->readings;
+             server_subscriber_read(s);
+             if (before < BENCH_SERVER_READINGS && s->readings >= BENCH_SERVER_READINGS) complete++;
+         }
+     }
+     double fanout_s = now_seconds() - start;
+     close(epoll_fd);
+ 
+     server_get_stats(server, &stats);
+     for (size_t c = 0; c < clients; c++) {
+         if (subscribers[c].readings != BENCH_SERVER_READINGS || subscribers[c].errors) errors = 1;
+         close(subscribers[c].fd);
+     }
+     if (stats.peak_clients < clients || stats.dropped > 0) errors = 1;
+ 
+     add_result("server.clients", (double)clients, "clients");
+     add_result("server.connect", connect_s * 1e6 / clients, "us/client");
+     add_result("server.fanout", (double)clients * BENCH_SERVER_READINGS / fanout_s / 1e6, "M lines/s");
+     add_result("server.fanout_latency", fanout_s * 1e3, "ms");
+ 
+     // Backpressure: a subscriber that stops reading falls behind and skips
+     // ahead once it reads again, while the others keep up and publishing
+     // never waits
+     server_subscriber fast[BENCH_SERVER_FAST_CLIENTS];
+     server_subscriber stalled;
+     memset(fast, 0, sizeof(fast));
+     memset(&stalled, 0, sizeof(stalled));
+     stalled.fd = server_connect(socket_path, "live\n");
+     if (stalled.fd < 0 || server_subscriber_wait_header(&stalled) < 0) return 1;
+     for (int c = 0; c < BENCH_SERVER_FAST_CLIENTS; c++) {
+         fast[c].fd = server_connect(socket_path, "live\n");
+         if (fast[c].fd < 0 || server_subscriber_wait_header(&fast[c]) < 0) return 1;
+     }
+ 
+     server_stats before;
+     server_get_stats(server, &before);
+     double publish_s = 0.0;
+     for (size_t i = 0; i < BENCH_SERVER_BURST_READINGS; i += BENCH_SERVER_BURST) {
+         struct timespec pause = { 0, 1000000 };
+ 
+         start = now_seconds();
+         for (size_t j = i; j < i + BENCH_SERVER_BURST; j++) {
+             server_publish_reading(server, &table, columns, BENCH_SERVER_READINGS + j);
+         }
+         publish_s += now_seconds() - start;
+ 
+         nanosleep(&pause, NULL);
+         for (int c = 0; c < BENCH_SERVER_FAST_CLIENTS; c++) server_subscriber_read(&fast[c]);
+     }
+ 
+     // Let the server finish the last burst; the stalled subscriber reads
+     // again and ends up at the last reading without having seen them all
+     uint64_t last = BENCH_SERVER_READINGS + BENCH_SERVER_BURST_READINGS - 1;
+     start = now_seconds();
+     do {
+         struct timespec pause = { 0, 1000000 };
+         nanosleep(&pause, NULL);
+         for (int c = 0; c < BENCH_SERVER_FAST_CLIENTS; c++) server_subscriber_read(&fast[c]);
+         server_subscriber_read(&stalled);
+         server_get_stats(server, &stats);
+     } while ((fast[0].readings < stats.readings - before.readings || stalled.next_sequence <= last) &&
+              now_seconds() - start < 10.0);
+ 
+     for (int c = 0; c < BENCH_SERVER_FAST_CLIENTS; c++) {
+         if (fast[c].readings != stats.readings - before.readings || fast[c].errors) errors = 1;
+         close(fast[c].fd);
+     }
+     if (stats.lagged == before.lagged || stalled.errors || stalled.next_sequence != last + 1 ||
+         stalled.readings >= stats.readings - before.readings) {
+         errors = 1;
+     }
+     close(stalled.fd);
+ 
+     add_result("server.publish", publish_s * 1e9 / BENCH_SERVER_BURST_READINGS, "ns/reading");
+     add_result("server.inbox_dropped", (double)(stats.dropped - before.dropped), "readings");
+ 
+     // History query: the whole store, column by column
+     int query = server_connect(socket_path, "history 0 18446744073709551615\n");
+     size_t expected = BENCH_SERVER_HISTORY_ROWS * (sizeof(uint64_t) + NUM_PARAMS * sizeof(float));
+     char *response = malloc(expected + 4096);
+     size_t received = 0;
+     ssize_t got;
+ 
+     if (query < 0 || !response) return 1;
+     start = now_seconds();
+     while ((got = read(query, response + received, expected + 4096 - received)) > 0) {
+         received += (size_t)got;
+     }
+     double query_s = now_seconds() - start;
+     close(query);
+ 
+     char *body = memchr(response, '\n', received);
+     if (!body || strtoull(response + 2, NULL, 10) != BENCH_SERVER_HISTORY_ROWS ||
+         received - (size_t)(body + 1 - response) != expected) {
+         errors = 1;
+     } else {
+         const char *column = body + 1;
+         for (size_t i = 0; i < BENCH_SERVER_HISTORY_ROWS; i++) {
+             uint64_t timestamp;
+             memcpy(&timestamp, column + i * sizeof(uint64_t), sizeof(timestamp));
+             if (timestamp != BENCH_START_MS + i * 1000) errors = 1;
+         }
+         column += BENCH_SERVER_HISTORY_ROWS * sizeof(uint64_t);
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             if (memcmp(column, columns[p], BENCH_SERVER_HISTORY_ROWS * sizeof(float)) != 0) errors = 1;
+             column += BENCH_SERVER_HISTORY_ROWS * sizeof(float);
+         }
+     }
+     add_result("server.history_query", received / query_s / 1e6, "MB/s");
+ 
+     server_stop(server);
+ 
+     // The history files and the (removed) socket were all in dir
+     char path[128];
+     snprintf(path, sizeof(path), "%s/index.idx", dir);
+     unlink(path);
+     snprintf(path, sizeof(path), "%s/timestamp_ms.col", dir);
+     unlink(path);
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         snprintf(path, sizeof(path), "%s/%s.col", dir, get_parameter_key(p));
+         unlink(path);
+     }
+     rmdir(dir);
+ 
+     free(response);
+     free(subscribers);
+     for (int p = 0; p < NUM_PARAMS; p++) free(columns[p]);
+     return errors;
+ }
+ 
+ // Derived state of one monitor, as main() keeps it between readings
+ typedef struct {
+     quality_result previous;
+     quality_stabilizer stabilizer;
+     station_trends trends;
+     station_windows windows;
+ } bench_monitor;
+ 
+ static void bench_monitor_init(bench_monitor *monitor) {
+     memset(&monitor->previous, 0, sizeof(monitor->previous));
+     quality_stabilizer_init(&monitor->stabilizer);
+     station_trends_init(&monitor->trends);
+     station_windows_init(&monitor->windows);
+ }
+ 
+ // One pass of the monitoring loop; returns the forecast changes
+ static uint32_t bench_monitor_step(bench_monitor *monitor, const quality_table *table,
+                                    const trend_config *config, uint64_t timestamp_ms,
+                                    const float values[NUM_PARAMS]) {
+     quality_result current;
+ 
+     analyze_water_quality(table, values, timestamp_ms, &current);
+     stabilize_water_quality(&monitor->stabilizer, table, values, ~0u, &current);
+     uint32_t changed = station_trends_update(&monitor->trends, config, table, timestamp_ms, values, ~0u);
+     station_windows_add(&monitor->windows, timestamp_ms, values, ~0u);
+     monitor->previous = current;
+     return changed;
+ }
+ 
+ static int bench_monitor_same(const bench_monitor *a, const bench_monitor *b) {
+     return a->previous.timestamp_ms == b->previous.timestamp_ms &&
+            a->previous.overall == b->previous.overall &&
+            memcmp(a->previous.level, b->previous.level, sizeof(a->previous.level)) == 0 &&
+            a->trends.warnings == b->trends.warnings;
+ }
+ 
+ static int bench_same_file(const char *a, const char *b) {
+     FILE *fa = fopen(a, "rb");
+     FILE *fb = fopen(b, "rb");
+     int same = fa && fb;
+ 
+     while (same) {
+         int ca = fgetc(fa);
+         int cb = fgetc(fb);
+         if (ca != cb) same = 0;
+         if (ca == EOF) break;
+     }
+ 
+     if (fa) fclose(fa);
+     if (fb) fclose(fb);
+     return same;
+ }
+ 
+ // A day of monitor state saved, loaded into a fresh monitor and carried on
+ // in step with the original; against rebuilding it from the readings
+ static int bench_checkpoint(void) {
+     static bench_monitor original;
+     static bench_monitor resumed;
+     static station_windows untouched;
+     char dir[] = "/tmp/water_quality_bench_XXXXXX";
+     char path[64];
+     size_t total = BENCH_CHECKPOINT_READINGS + BENCH_CHECKPOINT_RESUMED;
+     float *columns[NUM_PARAMS];
+     quality_table table;
+     trend_config config;
+     struct stat st;
+     int errors = 0;
+ 
+     if (!mkdtemp(dir)) return 1;
+     snprintf(path, sizeof(path), "%s/monitor.ckpt", dir);
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         columns[p] = malloc(total * sizeof(float));
+         if (!columns[p]) return 1;
+     }
+     simulate_columns(columns, total, 1000);
+     quality_table_init_default(&table);
+     trend_config_init_default(&config);
+ 
+     double start = now_seconds();
+     bench_monitor_init(&original);
+     for (size_t i = 0; i < BENCH_CHECKPOINT_READINGS; i++) {
+         float values[NUM_PARAMS];
+         for (int p = 0; p < NUM_PARAMS; p++) values[p] = columns[p][i];
+         bench_monitor_step(&original, &table, &config, BENCH_START_MS + i * 1000, values);
+     }
+     double rebuild_s = now_seconds() - start;
+ 
+     checkpoint_state saved = {
+         BENCH_CHECKPOINT_READINGS, original.previous.timestamp_ms, CHECKPOINT_HAVE_PREVIOUS,
+         &original.previous, &original.stabilizer, &original.trends, &original.windows
+     };
+     start = now_seconds();
+     if (checkpoint_save(path, &saved) < 0) return 1;
+     double save_s = now_seconds() - start;
+ 
+     bench_monitor_init(&resumed);
+     checkpoint_state loaded = {
+         0, 0, 0, &resumed.previous, &resumed.stabilizer, &resumed.trends, &resumed.windows
+     };
+     start = now_seconds();
+     if (checkpoint_load(path, &loaded) < 0) return 1;
+     double load_s = now_seconds() - start;
+ 
+     if (loaded.next_sequence != saved.next_sequence || loaded.timestamp_ms != saved.timestamp_ms ||
+         loaded.flags != saved.flags || !bench_monitor_same(&original, &resumed)) {
+         errors = 1;
+     }
+ 
+     // Through the writer thread the loop only pays for the copy, and the
+     // file comes out the same
+     char writer_path[80];
+     snprintf(writer_path, sizeof(writer_path), "%s/writer.ckpt", dir);
+     checkpoint_writer *writer = checkpoint_writer_start(writer_path);
+     if (!writer) return 1;
+     start = now_seconds();
+     if (checkpoint_writer_submit(writer, &saved) < 0) errors = 1;
+     double submit_s = now_seconds() - start;
+     if (checkpoint_writer_close(writer) < 0 || !bench_same_file(path, writer_path)) errors = 1;
+     unlink(writer_path);
+ 
+     // Every later reading gives the same levels, forecasts and statistics
+     for (size_t i = BENCH_CHECKPOINT_READINGS; i < total; i++) {
+         float values[NUM_PARAMS];
+         uint64_t timestamp_ms = BENCH_START_MS + i * 1000;
+ 
+         for (int p = 0; p < NUM_PARAMS; p++) values[p] = columns[p][i];
+         uint32_t changed = bench_monitor_step(&original, &table, &config, timestamp_ms, values);
+         if (bench_monitor_step(&resumed, &table, &config, timestamp_ms, values) != changed ||
+             !bench_monitor_same(&original, &resumed)) {
+             errors = 1;
+         }
+     }
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         for (int w = 0; w < NUM_WINDOWS; w++) {
+             window_stats a;
+             window_stats b;
+             sliding_window_stats(&original.windows.window[p][w], BENCH_START_MS + total * 1000, &a);
+             sliding_window_stats(&resumed.windows.window[p][w], BENCH_START_MS + total * 1000, &b);
+             if (memcmp(&a, &b, sizeof(a)) != 0) errors = 1;
+         }
+     }
+ 
+     // A damaged checkpoint is refused and leaves the state alone
+     if (stat(path, &st) < 0) return 1;
+     int fd = open(path, O_RDWR);
+     unsigned char byte = 0;
+     if (fd < 0 || pread(fd, &byte, 1, st.st_size / 2) != 1) return 1;
+     byte ^= 0x01;
+     if (pwrite(fd, &byte, 1, st.st_size / 2) != 1) return 1;
+     close(fd);
+ 
+     untouched = resumed.windows;
+     if (checkpoint_load(path, &loaded) == 0 || errno != EINVAL ||
+         memcmp(&untouched, &resumed.windows, sizeof(untouched)) != 0) {
+         errors = 1;
+     }
+ 
+     add_result("checkpoint.size", st.st_size / 1024.0, "KiB");
+     add_result("checkpoint.save", save_s * 1e3, "ms");
+     add_result("checkpoint.submit", submit_s * 1e6, "us");
+     add_result("checkpoint.load", load_s * 1e6, "us");
+     add_result("checkpoint.rebuild", rebuild_s * 1e3, "ms");
+ 
+     unlink(path);
+     rmdir(dir);
+     for (int p = 0; p < NUM_PARAMS; p++) free(columns[p]);
+     return errors;
+ }
+ 
+ static void print_json(int failures) {
+     printf("{\n");
+     printf("  \"suite\": \"water_quality_bench\",\n");
+     printf("  \"compiler\": \"%s\",\n", __VERSION__);
+     printf("  \"classify_kernel\": \"%s\",\n", classify_kernel_name(classify_best_kernel()));
+     printf("  \"failures\": %d,\n", failures);
+     printf("  \"results\": [\n");
+     for (int i = 0; i < result_count; i++) {
+         printf("    {\"name\": \"%s\", \"value\": %.6g, \"unit\": \"%s\"}%s\n",
+                results[i].name, results[i].value, results[i].unit,
+                i + 1 < result_count ? "," : "");
+     }
+     printf("  ]\n");
+     printf("}\n");
+ }
+ 
+ int main(void) {
+     int failures = 0;
+ 
+     failures += bench_classify();
+     failures += bench_display();
+     failures += bench_output_exact();
+     failures += bench_end_to_end();
+     failures += bench_sensors();
+     failures += bench_ring();
+     failures += bench_latency();
+     failures += bench_windows();
+     failures += bench_trends();
+     failures += bench_hysteresis();
+     failures += bench_profiles();
+     failures += bench_adc();
+     failures += bench_sampler();
+     failures += bench_uart();
+     failures += bench_telemetry();
+     failures += bench_adaptive();
+     failures += bench_server();
+     failures += bench_checkpoint();
+     failures += bench_gorilla();
+ 
+     print_json(failures);
+ 
+     return failures ? 1 : 0;
+ }
+ 
\ No newline at end of file
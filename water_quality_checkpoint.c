@@ -0,0 +1,329 @@
+/**
+ * Monitor State Checkpoints
+ *
+ * The checksum covers the sections in file order, so a torn or truncated
+ * file never loads. After the rename the directory is fsync'd as well,
+ * otherwise a crash could still bring back the previous name.
+ *
+ * The writer keeps two snapshots: the loop copies into one under the lock
+ * while the thread saves the other without it.
+ */
+
+ #define _POSIX_C_SOURCE 200809L
+ 
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <pthread.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+ #include "water_quality_checkpoint.h"
+ 
+ #define CHECKPOINT_SECTIONS 4
+ #define FNV_OFFSET 14695981039346656037ULL
+ #define FNV_PRIME  1099511628211ULL
+ 
+ // A copy of the state, owned by the writer
+ typedef struct {
+     uint64_t next_sequence;
+     uint64_t timestamp_ms;
+     uint32_t flags;
+     quality_result previous;
+     quality_stabilizer stabilizer;
+     station_trends trends;
+     station_windows windows;
+ } checkpoint_snapshot;
+ 
+ struct checkpoint_writer {
+     char *path;
+     pthread_t thread;
+     pthread_mutex_t lock;
+     pthread_cond_t wake;
+     checkpoint_snapshot *filling;   // Receives submitted states
+     checkpoint_snapshot *saving;    // Being written by the thread
+     int pending;                    // filling holds a state not saved yet
+     int stopping;
+     int error;                      // Errno of a failed save not reported yet
+     checkpoint_snapshot snapshots[2];
+ };
+ 
+ // Section pointers and sizes in file order
+ static void sections(const checkpoint_state *state, void *data[CHECKPOINT_SECTIONS],
+                      uint32_t size[CHECKPOINT_SECTIONS]) {
+     data[0] = state->previous;
+     size[0] = sizeof(*state->previous);
+     data[1] = state->stabilizer;
+     size[1] = sizeof(*state->stabilizer);
+     data[2] = state->trends;
+     size[2] = sizeof(*state->trends);
+     data[3] = state->windows;
+     size[3] = sizeof(*state->windows);
+ }
+ 
+ static uint64_t fnv1a(uint64_t hash, const void *data, size_t size) {
+     const unsigned char *p = data;
+ 
+     for (size_t i = 0; i < size; i++) {
+         hash ^= p[i];
+         hash *= FNV_PRIME;
+     }
+     return hash;
+ }
+ 
+ static int write_all(int fd, const void *data, size_t size) {
+     const char *p = data;
+ 
+     while (size > 0) {
+         ssize_t n = write(fd, p, size);
+         if (n < 0) {
+             if (errno == EINTR) continue;
+             return -1;
+         }
+         p += n;
+         size -= (size_t)n;
+     }
+ 
+     return 0;
+ }
+ 
+ // Makes the rename of a file in the directory of path durable
+ static int sync_directory(const char *path) {
+     const char *slash = strrchr(path, '/');
+     char *dir = slash ? strndup(path, slash == path ? 1 : (size_t)(slash - path)) : strdup(".");
+ 
+     if (!dir) {
+         errno = ENOMEM;
+         return -1;
+     }
+ 
+     int fd = open(dir, O_RDONLY);
+     free(dir);
+     if (fd < 0) return -1;
+ 
+     int result = fsync(fd);
+     close(fd);
+     return result;
+ }
+ 
+ int checkpoint_save(const char *path, const checkpoint_state *state) {
+     void *data[CHECKPOINT_SECTIONS];
+     uint32_t size[CHECKPOINT_SECTIONS];
+     checkpoint_header header;
+ 
+     sections(state, data, size);
+ 
+     memset(&header, 0, sizeof(header));
+     memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+     header.version = CHECKPOINT_VERSION;
+     header.num_params = NUM_PARAMS;
+     header.next_sequence = state->next_sequence;
+     header.timestamp_ms = state->timestamp_ms;
+     header.flags = state->flags;
+     header.checksum = FNV_OFFSET;
+     for (int s = 0; s < CHECKPOINT_SECTIONS; s++) {
+         header.section_size[s] = size[s];
+         header.checksum = fnv1a(header.checksum, data[s], size[s]);
+     }
+ 
+     size_t length = strlen(path);
+     char *temp = malloc(length + 8);
+     if (!temp) {
+         errno = ENOMEM;
+         return -1;
+     }
+     memcpy(temp, path, length);
+     memcpy(temp + length, ".XXXXXX", 8);
+ 
+     int fd = mkstemp(temp);
+     if (fd < 0) {
+         free(temp);
+         return -1;
+     }
+ 
+     int failed = write_all(fd, &header, sizeof(header)) < 0;
+     for (int s = 0; s < CHECKPOINT_SECTIONS && !failed; s++) {
+         failed = write_all(fd, data[s], size[s]) < 0;
+     }
+ 
+     // The data must be on disk before the new name can replace the old one
+     failed = failed || fsync(fd) < 0;
+     failed = close(fd) < 0 || failed;
+ 
+     if (failed || rename(temp, path) < 0) {
+         int saved = errno;
+         unlink(temp);
+         free(temp);
+         errno = saved;
+         return -1;
+     }
+ 
+     free(temp);
+     return sync_directory(path);
+ }
+ 
+ int checkpoint_load(const char *path, checkpoint_state *state) {
+     void *data[CHECKPOINT_SECTIONS];
+     uint32_t size[CHECKPOINT_SECTIONS];
+     size_t expected = sizeof(checkpoint_header);
+     struct stat st;
+ 
+     sections(state, data, size);
+     for (int s = 0; s < CHECKPOINT_SECTIONS; s++) expected += size[s];
+ 
+     int fd = open(path, O_RDONLY);
+     if (fd < 0) return -1;
+ 
+     if (fstat(fd, &st) < 0) {
+         close(fd);
+         return -1;
+     }
+     if ((size_t)st.st_size != expected) {
+         close(fd);
+         errno = EINVAL;
+         return -1;
+     }
+ 
+     const char *file = mmap(NULL, expected, PROT_READ, MAP_PRIVATE, fd, 0);
+     close(fd);
+     if (file == MAP_FAILED) return -1;
+ 
+     checkpoint_header header;
+     memcpy(&header, file, sizeof(header));
+ 
+     int valid = memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) == 0 &&
+                 header.version == CHECKPOINT_VERSION && header.num_params == NUM_PARAMS;
+     uint64_t checksum = FNV_OFFSET;
+     const char *section = file + sizeof(header);
+     for (int s = 0; s < CHECKPOINT_SECTIONS && valid; s++) {
+         valid = header.section_size[s] == size[s];
+         checksum = fnv1a(checksum, section, size[s]);
+         section += size[s];
+     }
+ 
+     if (!valid || checksum != header.checksum) {
+         munmap((void *)file, expected);
+         errno = EINVAL;
+         return -1;
+     }
+ 
+     section = file + sizeof(header);
+     for (int s = 0; s < CHECKPOINT_SECTIONS; s++) {
+         memcpy(data[s], section, size[s]);
+         section += size[s];
+     }
+     state->next_sequence = header.next_sequence;
+     state->timestamp_ms = header.timestamp_ms;
+     state->flags = header.flags;
+ 
+     munmap((void *)file, expected);
+     return 0;
+ }
+ 
+ static void* writer_thread(void *arg) {
+     checkpoint_writer *writer = arg;
+ 
+     pthread_mutex_lock(&writer->lock);
+     for (;;) {
+         while (!writer->pending && !writer->stopping) {
+             pthread_cond_wait(&writer->wake, &writer->lock);
+         }
+         if (!writer->pending) break;
+ 
+         checkpoint_snapshot *snapshot = writer->filling;
+         writer->filling = writer->saving;
+         writer->saving = snapshot;
+         writer->pending = 0;
+         pthread_mutex_unlock(&writer->lock);
+ 
+         // Disk I/O happens without the lock so submits never wait on it
+         checkpoint_state state = {
+             snapshot->next_sequence, snapshot->timestamp_ms, snapshot->flags,
+             &snapshot->previous, &snapshot->stabilizer, &snapshot->trends, &snapshot->windows
+         };
+         int error = checkpoint_save(writer->path, &state) < 0 ? errno : 0;
+ 
+         pthread_mutex_lock(&writer->lock);
+         if (error) writer->error = error;
+     }
+     pthread_mutex_unlock(&writer->lock);
+ 
+     return NULL;
+ }
+ 
+ checkpoint_writer* checkpoint_writer_start(const char *path) {
+     checkpoint_writer *writer = calloc(1, sizeof(checkpoint_writer));
+ 
+     if (!writer) return NULL;
+ 
+     writer->path = strdup(path);
+     if (!writer->path) {
+         free(writer);
+         errno = ENOMEM;
+         return NULL;
+     }
+     writer->filling = &writer->snapshots[0];
+     writer->saving = &writer->snapshots[1];
+ 
+     pthread_mutex_init(&writer->lock, NULL);
+     pthread_cond_init(&writer->wake, NULL);
+     int error = pthread_create(&writer->thread, NULL, writer_thread, writer);
+     if (error != 0) {
+         pthread_cond_destroy(&writer->wake);
+         pthread_mutex_destroy(&writer->lock);
+         free(writer->path);
+         free(writer);
+         errno = error;
+         return NULL;
+     }
+ 
+     return writer;
+ }
+ 
+ int checkpoint_writer_submit(checkpoint_writer *writer, const checkpoint_state *state) {
+     pthread_mutex_lock(&writer->lock);
+ 
+     checkpoint_snapshot *snapshot = writer->filling;
+     snapshot->next_sequence = state->next_sequence;
+     snapshot->timestamp_ms = state->timestamp_ms;
+     snapshot->flags = state->flags;
+     snapshot->previous = *state->previous;
+     snapshot->stabilizer = *state->stabilizer;
+     snapshot->trends = *state->trends;
+     snapshot->windows = *state->windows;
+     writer->pending = 1;
+     pthread_cond_signal(&writer->wake);
+ 
+     int error = writer->error;
+     writer->error = 0;
+     pthread_mutex_unlock(&writer->lock);
+ 
+     if (error) {
+         errno = error;
+         return -1;
+     }
+     return 0;
+ }
+ 
+ int checkpoint_writer_close(checkpoint_writer *writer) {
+     pthread_mutex_lock(&writer->lock);
+     writer->stopping = 1;
+     pthread_cond_signal(&writer->wake);
+     pthread_mutex_unlock(&writer->lock);
+     pthread_join(writer->thread, NULL);
+ 
+     int error = writer->error;
+ 
+     pthread_cond_destroy(&writer->wake);
+     pthread_mutex_destroy(&writer->lock);
+     free(writer->path);
+     free(writer);
+ 
+     if (error) {
+         errno = error;
+         return -1;
+     }
+     return 0;
+ }
\ No newline at end of file
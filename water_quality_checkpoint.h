@@ -0,0 +1,89 @@
+/**
+ * Monitor State Checkpoints
+ *
+ * Saves the state the live monitoring loop derives from past readings
+ * (debounced levels, trends, window statistics, the last reported result
+ * and the next sequence number) to one binary file, so a restarted
+ * monitor carries on where it stopped instead of re-alerting and
+ * rebuilding its statistics from scratch. The file is written to a
+ * temporary name, fsync'd and renamed over the old one, so a crash
+ * leaves either the old or the new checkpoint. Loading maps the file and
+ * copies the sections back in place.
+ *
+ * The monitoring loop never waits for the disk: checkpoint_writer_submit()
+ * copies the state and a writer thread saves the newest copy.
+ *
+ * File layout:
+ *   checkpoint_header
+ *   quality_result       last reported result
+ *   quality_stabilizer
+ *   station_trends
+ *   station_windows
+ *
+ * Sections are the in-memory structs, so a checkpoint only loads into a
+ * build with the same layout; the header records the version and every
+ * section size and load rejects anything else.
+ */
+
+ #ifndef WATER_QUALITY_CHECKPOINT_H
+ #define WATER_QUALITY_CHECKPOINT_H
+ 
+ #include <stdint.h>
+ #include "water_quality_config.h"
+ #include "water_quality_analysis.h"
+ #include "water_quality_trend.h"
+ #include "water_quality_window.h"
+ 
+ #define CHECKPOINT_MAGIC   "WQCKPT01"
+ #define CHECKPOINT_VERSION 1        // Bump when a section changes meaning but not size
+ 
+ #define CHECKPOINT_HAVE_PREVIOUS 0x1    // previous holds a reported result
+ 
+ typedef struct {
+     char magic[8];
+     uint32_t version;
+     uint32_t num_params;
+     uint32_t section_size[4];       // Bytes of each section, in file order
+     uint64_t next_sequence;
+     uint64_t timestamp_ms;          // Last reading included
+     uint32_t flags;                 // CHECKPOINT_* flags
+     uint32_t reserved;
+     uint64_t checksum;              // FNV-1a of every byte after the header
+ } checkpoint_header;
+ 
+ // The monitor's derived state. The sections point at the live structs:
+ // save reads them, load overwrites them.
+ typedef struct {
+     uint64_t next_sequence;         // Sequence number of the next reading
+     uint64_t timestamp_ms;
+     uint32_t flags;
+     quality_result *previous;
+     quality_stabilizer *stabilizer;
+     station_trends *trends;
+     station_windows *windows;
+ } checkpoint_state;
+ 
+ // Writes state to path atomically. Returns -1 with errno set on failure
+ // (the old checkpoint is then still in place).
+ int checkpoint_save(const char *path, const checkpoint_state *state);
+ 
+ // Restores state from path. Returns -1 with errno set when there is no
+ // checkpoint (ENOENT) or it is damaged or from another build (EINVAL);
+ // the sections are only written once the whole file checked out.
+ int checkpoint_load(const char *path, checkpoint_state *state);
+ 
+ typedef struct checkpoint_writer checkpoint_writer;
+ 
+ // Starts the writer thread that saves submitted states to path
+ checkpoint_writer* checkpoint_writer_start(const char *path);
+ 
+ // Copies state for the writer and returns without any I/O. A copy the
+ // writer has not started on yet is replaced. Returns -1 with errno set
+ // when a save failed since the last call.
+ int checkpoint_writer_submit(checkpoint_writer *writer, const checkpoint_state *state);
+ 
+ // Saves the last submitted state, if not saved yet, and stops the writer.
+ // Returns -1 with errno set when that save failed.
+ int checkpoint_writer_close(checkpoint_writer *writer);
+ 
+ #endif /* WATER_QUALITY_CHECKPOINT_H */
\ No newline at end of file
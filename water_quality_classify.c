@@ -0,0 +1,230 @@
+/**
+ * Water Quality Classification
+ *
+ * Scalar and SIMD batch kernels. Every kernel computes
+ * level = 2 - in_good_band - in_alert_band, so they agree bit for bit.
+ */
+
+ #include <math.h>
+ #include <pthread.h>
+ #include "water_quality_classify.h"
+ 
+ #if defined(__x86_64__) || defined(__i386__)
+ #include <immintrin.h>
+ #define CLASSIFY_X86 1
+ #endif
+ 
+ // Smallest float f >= x, so that v >= f <=> v >= x for every float v
+ static float round_lower_bound(double x) {
+     float f = (float)x;
+     if ((double)f < x) f = nextafterf(f, INFINITY);
+     return f;
+ }
+ 
+ // Largest float f <= x, so that v <= f <=> v <= x for every float v
+ static float round_upper_bound(double x) {
+     float f = (float)x;
+     if ((double)f > x) f = nextafterf(f, -INFINITY);
+     return f;
+ }
+ 
+ void quality_bounds_init(quality_bounds *bounds, double good_min, double good_max,
+                          double alert_min, double alert_max) {
+     bounds->good_min = round_lower_bound(good_min);
+     bounds->good_max = round_upper_bound(good_max);
+     bounds->alert_min = round_lower_bound(alert_min);
+     bounds->alert_max = round_upper_bound(alert_max);
+ }
+ 
+ // Open sides are already +/-INFINITY in the registry
+ #define CHANNEL_BOUNDS(id, key, name, unit, pin, period_ms, good_min, good_max, alert_min, \
+                        alert_max, ...) \
+     quality_bounds_init(&table->param[PARAM_##id], good_min, good_max, alert_min, alert_max);
+ 
+ void quality_table_init_default(quality_table *table) {
+     WATER_QUALITY_CHANNELS(CHANNEL_BOUNDS)
+ }
+ 
+ uint8_t classify_reading(const quality_table *table, const float values[NUM_PARAMS],
+                          uint8_t levels[NUM_PARAMS]) {
+     uint8_t overall = QUALITY_GOOD;
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         levels[p] = classify_value(&table->param[p], values[p]);
+         if (levels[p] > overall) overall = levels[p];
+     }
+ 
+     return overall;
+ }
+ 
+ static void classify_range_scalar(const quality_table *table, const sensor_batch *in,
+                                   quality_batch *out, size_t start, size_t n) {
+     for (size_t i = start; i < n; i++) {
+         uint8_t overall = QUALITY_GOOD;
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             uint8_t level = classify_value(&table->param[p], in->values[p][i]);
+             out->level[p][i] = level;
+             if (level > overall) overall = level;
+         }
+         out->overall[i] = overall;
+     }
+ }
+ 
+ #ifdef CLASSIFY_X86
+ 
+ // Levels of 4 values as int32 lanes (compare masks are -1 when true)
+ static inline __m128i levels4_sse2(__m128 x, __m128 gmin, __m128 gmax,
+                                    __m128 amin, __m128 amax) {
+     __m128 good = _mm_and_ps(_mm_cmpge_ps(x, gmin), _mm_cmple_ps(x, gmax));
+     __m128 alert = _mm_and_ps(_mm_cmpge_ps(x, amin), _mm_cmple_ps(x, amax));
+ 
+     return _mm_add_epi32(_mm_set1_epi32(QUALITY_CRITICAL),
+                          _mm_add_epi32(_mm_castps_si128(good), _mm_castps_si128(alert)));
+ }
+ 
+ static size_t classify_batch_sse2(const quality_table *table, const sensor_batch *in,
+                                   quality_batch *out, size_t n) {
+     size_t i = 0;
+ 
+     for (; i + 16 <= n; i += 16) {
+         __m128i overall = _mm_setzero_si128();
+ 
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             const quality_bounds *b = &table->param[p];
+             const float *v = in->values[p] + i;
+             __m128 gmin = _mm_set1_ps(b->good_min);
+             __m128 gmax = _mm_set1_ps(b->good_max);
+             __m128 amin = _mm_set1_ps(b->alert_min);
+             __m128 amax = _mm_set1_ps(b->alert_max);
+ 
+             __m128i l0 = levels4_sse2(_mm_loadu_ps(v), gmin, gmax, amin, amax);
+             __m128i l1 = levels4_sse2(_mm_loadu_ps(v + 4), gmin, gmax, amin, amax);
+             __m128i l2 = levels4_sse2(_mm_loadu_ps(v + 8), gmin, gmax, amin, amax);
+             __m128i l3 = levels4_sse2(_mm_loadu_ps(v + 12), gmin, gmax, amin, amax);
+ 
+             // Narrow 16 x int32 to 16 x uint8
+             __m128i levels = _mm_packus_epi16(_mm_packs_epi32(l0, l1), _mm_packs_epi32(l2, l3));
+             _mm_storeu_si128((__m128i *)(out->level[p] + i), levels);
+             overall = _mm_max_epu8(overall, levels);
+         }
+ 
+         _mm_storeu_si128((__m128i *)(out->overall + i), overall);
+     }
+ 
+     return i;
+ }
+ 
+ __attribute__((target("avx2")))
+ static inline __m256i levels8_avx2(__m256 x, __m256 gmin, __m256 gmax,
+                                    __m256 amin, __m256 amax) {
+     __m256 good = _mm256_and_ps(_mm256_cmp_ps(x, gmin, _CMP_GE_OQ),
+                                 _mm256_cmp_ps(x, gmax, _CMP_LE_OQ));
+     __m256 alert = _mm256_and_ps(_mm256_cmp_ps(x, amin, _CMP_GE_OQ),
+                                  _mm256_cmp_ps(x, amax, _CMP_LE_OQ));
+ 
+     return _mm256_add_epi32(_mm256_set1_epi32(QUALITY_CRITICAL),
+                             _mm256_add_epi32(_mm256_castps_si256(good),
+                                              _mm256_castps_si256(alert)));
+ }
+ 
+ __attribute__((target("avx2")))
+ static size_t classify_batch_avx2(const quality_table *table, const sensor_batch *in,
+                                   quality_batch *out, size_t n) {
+     size_t i = 0;
+ 
+     for (; i + 16 <= n; i += 16) {
+         __m128i overall = _mm_setzero_si128();
+ 
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             const quality_bounds *b = &table->param[p];
+             const float *v = in->values[p] + i;
+             __m256 gmin = _mm256_set1_ps(b->good_min);
+             __m256 gmax = _mm256_set1_ps(b->good_max);
+             __m256 amin = _mm256_set1_ps(b->alert_min);
+             __m256 amax = _mm256_set1_ps(b->alert_max);
+ 
+             __m256i l0 = levels8_avx2(_mm256_loadu_ps(v), gmin, gmax, amin, amax);
+             __m256i l1 = levels8_avx2(_mm256_loadu_ps(v + 8), gmin, gmax, amin, amax);
+ 
+             // packs works per 128-bit lane; restore element order before narrowing
+             __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(l0, l1),
+                                                       _MM_SHUFFLE(3, 1, 2, 0));
+             __m128i levels = _mm_packus_epi16(_mm256_castsi256_si128(packed),
+                                               _mm256_extracti128_si256(packed, 1));
+             _mm_storeu_si128((__m128i *)(out->level[p] + i), levels);
+             overall = _mm_max_epu8(overall, levels);
+         }
+ 
+         _mm_storeu_si128((__m128i *)(out->overall + i), overall);
+     }
+ 
+     return i;
+ }
+ 
+ #endif /* CLASSIFY_X86 */
+ 
+ int classify_kernel_available(classify_kernel kernel) {
+     switch (kernel) {
+         case CLASSIFY_SCALAR:
+             return 1;
+ #ifdef CLASSIFY_X86
+         case CLASSIFY_SSE2:
+             return __builtin_cpu_supports("sse2");
+         case CLASSIFY_AVX2:
+             return __builtin_cpu_supports("avx2");
+ #endif
+         default:
+             return 0;
+     }
+ }
+ 
+ // Resolved once; the load generator's workers ask concurrently
+ static pthread_once_t best_once = PTHREAD_ONCE_INIT;
+ static classify_kernel best;
+ 
+ static void resolve_best_kernel(void) {
+     if (classify_kernel_available(CLASSIFY_AVX2)) best = CLASSIFY_AVX2;
+     else if (classify_kernel_available(CLASSIFY_SSE2)) best = CLASSIFY_SSE2;
+     else best = CLASSIFY_SCALAR;
+ }
+ 
+ classify_kernel classify_best_kernel(void) {
+     pthread_once(&best_once, resolve_best_kernel);
+     return best;
+ }
+ 
+ const char* classify_kernel_name(classify_kernel kernel) {
+     switch (kernel) {
+         case CLASSIFY_SCALAR:
+             return "scalar";
+         case CLASSIFY_SSE2:
+             return "sse2";
+         case CLASSIFY_AVX2:
+             return "avx2";
+         default:
+             return "unknown";
+     }
+ }
+ 
+ void classify_batch_kernel(classify_kernel kernel, const quality_table *table,
+                            const sensor_batch *in, quality_batch *out, size_t n) {
+     size_t done = 0;
+ 
+ #ifdef CLASSIFY_X86
+     if (kernel == CLASSIFY_AVX2) {
+         done = classify_batch_avx2(table, in, out, n);
+     } else if (kernel == CLASSIFY_SSE2) {
+         done = classify_batch_sse2(table, in, out, n);
+     }
+ #else
+     (void)kernel;
+ #endif
+ 
+     // Scalar fallback and the tail that does not fill a vector
+     classify_range_scalar(table, in, out, done, n);
+ }
+ 
+ void classify_batch(const quality_table *table, const sensor_batch *in,
+                     quality_batch *out, size_t n) {
+     classify_batch_kernel(classify_best_kernel(), table, in, out, n);
+ }
\ No newline at end of file
@@ -0,0 +1,84 @@
+/**
+ * Water Quality Classification
+ *
+ * Branchless classification of sensor readings into quality levels.
+ * Readings can be classified one at a time or as struct-of-arrays
+ * batches covering many stations, using SSE2/AVX2 kernels when the
+ * CPU supports them and a scalar fallback otherwise.
+ */
+
+ #ifndef WATER_QUALITY_CLASSIFY_H
+ #define WATER_QUALITY_CLASSIFY_H
+ 
+ #include <stddef.h>
+ #include <stdint.h>
+ #include "water_quality_config.h"
+ 
+ // Good and alert bands of one parameter. Open sides are stored as
+ // +/-INFINITY so every parameter is classified with the same two range
+ // checks: outside the good band is Alert, outside the alert band is Critical.
+ typedef struct {
+     float good_min;
+     float good_max;
+     float alert_min;
+     float alert_max;
+ } quality_bounds;
+ 
+ // Bounds for every parameter, indexed by PARAM_*
+ typedef struct {
+     quality_bounds param[NUM_PARAMS];
+ } quality_table;
+ 
+ // Struct-of-arrays input: values[PARAM_*][i] is reading i of that parameter
+ typedef struct {
+     const float *values[NUM_PARAMS];
+ } sensor_batch;
+ 
+ // Struct-of-arrays output: one quality level per reading and parameter,
+ // plus the worst-case level of each reading
+ typedef struct {
+     uint8_t *level[NUM_PARAMS];
+     uint8_t *overall;
+ } quality_batch;
+ 
+ // Batch kernels, from slowest to fastest
+ typedef enum {
+     CLASSIFY_SCALAR,
+     CLASSIFY_SSE2,
+     CLASSIFY_AVX2
+ } classify_kernel;
+ 
+ // Builds bounds from double thresholds. Each bound is rounded to the float
+ // that keeps float comparisons identical to comparing against the double.
+ void quality_bounds_init(quality_bounds *bounds, double good_min, double good_max,
+                          double alert_min, double alert_max);
+ 
+ // Fills the table with the thresholds from water_quality_config.h
+ void quality_table_init_default(quality_table *table);
+ 
+ // Classifies one value without branching
+ static inline uint8_t classify_value(const quality_bounds *bounds, float value) {
+     int good = (value >= bounds->good_min) & (value <= bounds->good_max);
+     int alert = (value >= bounds->alert_min) & (value <= bounds->alert_max);
+ 
+     // NaN fails both checks and is reported as critical
+     return (uint8_t)(QUALITY_CRITICAL - good - alert);
+ }
+ 
+ // Classifies one reading, fills levels[] and returns the overall level
+ uint8_t classify_reading(const quality_table *table, const float values[NUM_PARAMS],
+                          uint8_t levels[NUM_PARAMS]);
+ 
+ // Classifies n readings with the fastest kernel the CPU supports
+ void classify_batch(const quality_table *table, const sensor_batch *in,
+                     quality_batch *out, size_t n);
+ 
+ // Classifies n readings with a specific kernel (for benchmarking)
+ void classify_batch_kernel(classify_kernel kernel, const quality_table *table,
+                            const sensor_batch *in, quality_batch *out, size_t n);
+ 
+ int classify_kernel_available(classify_kernel kernel);
+ classify_kernel classify_best_kernel(void);
+ const char* classify_kernel_name(classify_kernel kernel);
+ 
+ #endif /* WATER_QUALITY_CLASSIFY_H */
\ No newline at end of file
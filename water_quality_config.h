@@ -11,6 +11,19 @@
  // System configuration
  #define READING_INTERVAL 5  // Time between readings in seconds
  
+ // Firmware output: 0 for text reports, 1 for binary telemetry frames
+ // (water_quality_telemetry.h); can be set with -DTELEMETRY_BINARY=1
+ #ifndef TELEMETRY_BINARY
+ #define TELEMETRY_BINARY 0
+ #endif
+ 
+ // Sampling period of each sensor in the simulator (milliseconds)
+ #define PH_SAMPLE_PERIOD_MS               5000
+ #define TEMPERATURE_SAMPLE_PERIOD_MS      10000  // Temperature changes slowly
+ #define TURBIDITY_SAMPLE_PERIOD_MS        5000
+ #define TDS_SAMPLE_PERIOD_MS              10000
+ #define DISSOLVED_OXYGEN_SAMPLE_PERIOD_MS 5000
+ 
  // Quality categories
  #define QUALITY_GOOD     0
  #define QUALITY_ALERT    1
@@ -45,6 +58,98 @@
  #define DO_ALERT         4.0   // Stressful for aquatic life
  // Anything below DO_ALERT is considered critical
  
+ // Range of the percentile histogram of each parameter's window statistics
+ // (values outside are counted in the first or last bin)
+ #define PH_HISTOGRAM_MIN          4.0
+ #define PH_HISTOGRAM_MAX          10.0
+ #define TEMP_HISTOGRAM_MIN        0.0
+ #define TEMP_HISTOGRAM_MAX        40.0
+ #define TURBIDITY_HISTOGRAM_MIN   0.0
+ #define TURBIDITY_HISTOGRAM_MAX   20.0
+ #define TDS_HISTOGRAM_MIN         0.0
+ #define TDS_HISTOGRAM_MAX         1000.0
+ #define DO_HISTOGRAM_MIN          0.0
+ #define DO_HISTOGRAM_MAX          16.0
+ 
+ // Hysteresis and debounce of quality levels: a level is left for a better
+ // one only once the value is this far inside the better band
+ #define PH_HYSTERESIS         0.1
+ #define TEMP_HYSTERESIS       0.5
+ #define TURBIDITY_HYSTERESIS  0.5
+ #define TDS_HYSTERESIS        10.0
+ #define DO_HYSTERESIS         0.2
+ #define ESCALATE_SAMPLES      2     // Consecutive samples needed to move to a worse level
+ #define RECOVER_SAMPLES       3     // Consecutive samples needed to move to a better level
+ 
+ // Adaptive sampling of the firmware: READING_INTERVAL doubles after every
+ // ADAPTIVE_STABLE_READINGS calm readings with all parameters Good, up to
+ // ADAPTIVE_MAX_INTERVAL_S, and drops to ADAPTIVE_MIN_INTERVAL_S while a
+ // value is within its *_NEAR distance of a worse level or, at its current
+ // rate, would reach one within ADAPTIVE_HORIZON_READINGS readings
+ #define ADAPTIVE_MIN_INTERVAL_S   2
+ #define ADAPTIVE_MAX_INTERVAL_S   60
+ #define ADAPTIVE_STABLE_READINGS  6
+ #define ADAPTIVE_HORIZON_READINGS 3
+ #define PH_NEAR          0.15
+ #define TEMP_NEAR        0.5
+ #define TURBIDITY_NEAR   0.5
+ #define TDS_NEAR         15.0
+ #define DO_NEAR          0.25
+ 
+ // Sensor value at ADC_MAX (water_quality_adc.h); every conversion is
+ // linear from 0 at count 0
+ #define PH_FULL_SCALE          14.0    // 0-14 pH
+ #define TEMP_FULL_SCALE        500.0   // LM35 (10 mV/°C) at a 5 V reference
+ #define TURBIDITY_FULL_SCALE   100.0   // 0-100 NTU
+ #define TDS_FULL_SCALE         1000.0  // 0-1000 ppm
+ #define DO_FULL_SCALE          20.0    // 0-20 mg/L
+ 
+ // Predictive alerts (trend forecasts)
+ #define TREND_LEVEL_TAU_S   60.0    // Smoothing of the value
+ #define TREND_SLOPE_TAU_S   600.0   // Smoothing of its rate of change
+ #define TREND_HORIZON_S     1800    // Warn when a worse level is predicted within this time
+ 
+ // Channel registry: one row per sensor channel, in PARAM_* order. The
+ // per-channel tables (float and ADC count thresholds, names, units,
+ // profile keys, sampling periods, histogram ranges, firmware pins) are all
+ // expanded from it at compile time, so the acquisition, classification and
+ // output loops just walk NUM_PARAMS entries. Columns:
+ //
+ //     id, profile key, name, unit, analog pin, sample period (ms),
+ //     good min, good max, alert min, alert max, hysteresis, near distance,
+ //     full scale, histogram min, histogram max
+ //
+ // Open sides of the good and alert bands are -INFINITY or INFINITY (from
+ // <math.h>, like quality_bounds). Readings carry one mask bit per channel,
+ // so there can be up to 32.
+ #define WATER_QUALITY_CHANNELS(X) \
+     X(PH, "ph", "pH", "", 0, PH_SAMPLE_PERIOD_MS, \
+       PH_GOOD_MIN, PH_GOOD_MAX, PH_ALERT_MIN, PH_ALERT_MAX, PH_HYSTERESIS, PH_NEAR, \
+       PH_FULL_SCALE, PH_HISTOGRAM_MIN, PH_HISTOGRAM_MAX) \
+     X(TEMPERATURE, "temperature", "Temperature", "°C", 1, TEMPERATURE_SAMPLE_PERIOD_MS, \
+       TEMP_GOOD_MIN, TEMP_GOOD_MAX, TEMP_ALERT_MIN, TEMP_ALERT_MAX, TEMP_HYSTERESIS, TEMP_NEAR, \
+       TEMP_FULL_SCALE, TEMP_HISTOGRAM_MIN, TEMP_HISTOGRAM_MAX) \
+     X(TURBIDITY, "turbidity", "Turbidity", "NTU", 2, TURBIDITY_SAMPLE_PERIOD_MS, \
+       -INFINITY, TURBIDITY_GOOD, -INFINITY, TURBIDITY_ALERT, TURBIDITY_HYSTERESIS, TURBIDITY_NEAR, \
+       TURBIDITY_FULL_SCALE, TURBIDITY_HISTOGRAM_MIN, TURBIDITY_HISTOGRAM_MAX) \
+     X(TDS, "tds", "TDS", "ppm", 3, TDS_SAMPLE_PERIOD_MS, \
+       -INFINITY, TDS_GOOD, -INFINITY, TDS_ALERT, TDS_HYSTERESIS, TDS_NEAR, \
+       TDS_FULL_SCALE, TDS_HISTOGRAM_MIN, TDS_HISTOGRAM_MAX) \
+     X(DISSOLVED_OXYGEN, "dissolved_oxygen", "Dissolved Oxygen", "mg/L", 4, \
+       DISSOLVED_OXYGEN_SAMPLE_PERIOD_MS, \
+       DO_GOOD, INFINITY, DO_ALERT, INFINITY, DO_HYSTERESIS, DO_NEAR, \
+       DO_FULL_SCALE, DO_HISTOGRAM_MIN, DO_HISTOGRAM_MAX)
+ 
+ // Parameter indices (order of per-parameter arrays and batch columns)
+ #define WATER_QUALITY_PARAM_INDEX(id, ...) PARAM_##id,
+ enum {
+     WATER_QUALITY_CHANNELS(WATER_QUALITY_PARAM_INDEX)
+     NUM_PARAMS
+ };
+ 
+ // Channel masks (due, watched, warnings) are 32 bits wide
+ _Static_assert(NUM_PARAMS <= 32, "at most 32 channels");
+ 
  #endif /* WATER_QUALITY_CONFIG_H */
  
  
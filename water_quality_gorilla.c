@@ -0,0 +1,265 @@
+/**
+ * Gorilla Time-Series Compression
+ *
+ * Timestamp delta-of-delta buckets:      Value XOR encoding:
+ *   '0'                 dod == 0           '0'   same value as before
+ *   '10'   + 7 bits     [-64, 63]          '10'  meaningful bits inside the
+ *   '110'  + 9 bits     [-256, 255]              previous leading/trailing window
+ *   '1110' + 12 bits    [-2048, 2047]      '11'  5 bits leading zeros, 5 bits
+ *   '1111' + 64 bits    anything else            length - 1, meaningful bits
+ *
+ * The first sample stores its timestamp (64 bits) and value (32 bits) raw.
+ */
+
+ #include <string.h>
+ #include "water_quality_gorilla.h"
+ 
+ #define NO_WINDOW 0xFF
+ 
+ static inline uint64_t low_bits(uint64_t value, int n) {
+     return value & (((uint64_t)1 << n) - 1);
+ }
+ 
+ // Appends up to 32 bits, most significant first
+ static inline void put_bits(gorilla_encoder *encoder, uint64_t value, int n) {
+     encoder->bits = (encoder->bits << n) | low_bits(value, n);
+     encoder->bit_count += n;
+ 
+     while (encoder->bit_count >= 8) {
+         encoder->bit_count -= 8;
+         encoder->data[encoder->position++] = (uint8_t)(encoder->bits >> encoder->bit_count);
+     }
+ }
+ 
+ static inline void put_bits64(gorilla_encoder *encoder, uint64_t value) {
+     put_bits(encoder, value >> 32, 32);
+     put_bits(encoder, value, 32);
+ }
+ 
+ static inline uint32_t float_bits(float value) {
+     uint32_t bits;
+     memcpy(&bits, &value, sizeof(bits));
+     return bits;
+ }
+ 
+ static inline float bits_float(uint32_t bits) {
+     float value;
+     memcpy(&value, &bits, sizeof(value));
+     return value;
+ }
+ 
+ void gorilla_encoder_init(gorilla_encoder *encoder, uint8_t *buffer, size_t capacity) {
+     memset(encoder, 0, sizeof(*encoder));
+     encoder->data = buffer;
+     encoder->capacity = capacity;
+     encoder->leading = NO_WINDOW;
+ }
+ 
+ static void encode_timestamp(gorilla_encoder *encoder, uint64_t timestamp) {
+     int64_t delta = (int64_t)(timestamp - encoder->previous_timestamp);
+     int64_t dod = delta - encoder->previous_delta;
+ 
+     if (dod == 0) {
+         put_bits(encoder, 0x0, 1);
+     } else if (dod >= -64 && dod <= 63) {
+         put_bits(encoder, 0x2, 2);
+         put_bits(encoder, (uint64_t)dod, 7);
+     } else if (dod >= -256 && dod <= 255) {
+         put_bits(encoder, 0x6, 3);
+         put_bits(encoder, (uint64_t)dod, 9);
+     } else if (dod >= -2048 && dod <= 2047) {
+         put_bits(encoder, 0xE, 4);
+         put_bits(encoder, (uint64_t)dod, 12);
+     } else {
+         put_bits(encoder, 0xF, 4);
+         put_bits64(encoder, (uint64_t)dod);
+     }
+ 
+     encoder->previous_delta = delta;
+     encoder->previous_timestamp = timestamp;
+ }
+ 
+ static void encode_value(gorilla_encoder *encoder, uint32_t value) {
+     uint32_t xor = value ^ encoder->previous_value;
+ 
+     encoder->previous_value = value;
+ 
+     if (xor == 0) {
+         put_bits(encoder, 0x0, 1);
+         return;
+     }
+ 
+     int leading = __builtin_clz(xor);
+     int trailing = __builtin_ctz(xor);
+ 
+     if (encoder->leading != NO_WINDOW &&
+         leading >= encoder->leading && trailing >= encoder->trailing) {
+         // Fits the previous window: only the window bits are stored
+         int length = 32 - encoder->leading - encoder->trailing;
+         put_bits(encoder, 0x2, 2);
+         put_bits(encoder, xor >> encoder->trailing, length);
+         return;
+     }
+ 
+     int length = 32 - leading - trailing;
+     put_bits(encoder, 0x3, 2);
+     put_bits(encoder, (uint64_t)leading, 5);
+     put_bits(encoder, (uint64_t)(length - 1), 5);
+     put_bits(encoder, xor >> trailing, length);
+ 
+     encoder->leading = (uint8_t)leading;
+     encoder->trailing = (uint8_t)trailing;
+ }
+ 
+ int gorilla_encode(gorilla_encoder *encoder, uint64_t timestamp, float value) {
+     if (encoder->capacity - encoder->position < GORILLA_MAX_SAMPLE_BYTES) return -1;
+ 
+     if (encoder->count == 0) {
+         put_bits64(encoder, timestamp);
+         put_bits(encoder, float_bits(value), 32);
+         encoder->previous_timestamp = timestamp;
+         encoder->previous_value = float_bits(value);
+     } else {
+         encode_timestamp(encoder, timestamp);
+         encode_value(encoder, float_bits(value));
+     }
+ 
+     encoder->count++;
+     return 0;
+ }
+ 
+ size_t gorilla_encoder_finish(gorilla_encoder *encoder) {
+     if (encoder->bit_count > 0) {
+         encoder->data[encoder->position++] = (uint8_t)(encoder->bits << (8 - encoder->bit_count));
+         encoder->bit_count = 0;
+     }
+ 
+     return encoder->position;
+ }
+ 
+ void gorilla_decoder_init(gorilla_decoder *decoder, const uint8_t *data, size_t size,
+                           uint64_t count) {
+     memset(decoder, 0, sizeof(*decoder));
+     decoder->data = data;
+     decoder->size = size;
+     decoder->remaining = count;
+     decoder->leading = NO_WINDOW;
+ }
+ 
+ // Reads up to 32 bits; returns -1 when the stream is exhausted
+ static inline int get_bits(gorilla_decoder *decoder, int n, uint64_t *value) {
+     while (decoder->bit_count <= 56 && decoder->position < decoder->size) {
+         decoder->bits = (decoder->bits << 8) | decoder->data[decoder->position++];
+         decoder->bit_count += 8;
+     }
+ 
+     if (decoder->bit_count < n) return -1;
+ 
+     decoder->bit_count -= n;
+     *value = low_bits(decoder->bits >> decoder->bit_count, n);
+     return 0;
+ }
+ 
+ static inline int get_bits64(gorilla_decoder *decoder, uint64_t *value) {
+     uint64_t high;
+     uint64_t low;
+ 
+     if (get_bits(decoder, 32, &high) < 0 || get_bits(decoder, 32, &low) < 0) return -1;
+     *value = (high << 32) | low;
+     return 0;
+ }
+ 
+ static inline int64_t sign_extend(uint64_t value, int n) {
+     return (int64_t)(value << (64 - n)) >> (64 - n);
+ }
+ 
+ static int decode_timestamp(gorilla_decoder *decoder) {
+     uint64_t bit;
+     uint64_t raw;
+     int64_t dod;
+     int prefix = 0;
+ 
+     // Count leading '1' bits of the bucket prefix (at most four)
+     while (prefix < 4) {
+         if (get_bits(decoder, 1, &bit) < 0) return -1;
+         if (bit == 0) break;
+         prefix++;
+     }
+ 
+     switch (prefix) {
+         case 0:
+             dod = 0;
+             break;
+         case 1:
+             if (get_bits(decoder, 7, &raw) < 0) return -1;
+             dod = sign_extend(raw, 7);
+             break;
+         case 2:
+             if (get_bits(decoder, 9, &raw) < 0) return -1;
+             dod = sign_extend(raw, 9);
+             break;
+         case 3:
+             if (get_bits(decoder, 12, &raw) < 0) return -1;
+             dod = sign_extend(raw, 12);
+             break;
+         default:
+             if (get_bits64(decoder, &raw) < 0) return -1;
+             dod = (int64_t)raw;
+             break;
+     }
+ 
+     decoder->previous_delta += dod;
+     decoder->previous_timestamp += (uint64_t)decoder->previous_delta;
+     return 0;
+ }
+ 
+ static int decode_value(gorilla_decoder *decoder) {
+     uint64_t control;
+     uint64_t raw;
+ 
+     if (get_bits(decoder, 1, &control) < 0) return -1;
+     if (control == 0) return 0;
+ 
+     if (get_bits(decoder, 1, &control) < 0) return -1;
+ 
+     if (control == 1) {
+         uint64_t leading;
+         uint64_t length;
+ 
+         if (get_bits(decoder, 5, &leading) < 0 || get_bits(decoder, 5, &length) < 0) return -1;
+         length += 1;
+         if (leading + length > 32) return -1;
+ 
+         decoder->leading = (uint8_t)leading;
+         decoder->trailing = (uint8_t)(32 - leading - length);
+     } else if (decoder->leading == NO_WINDOW) {
+         return -1;
+     }
+ 
+     int length = 32 - decoder->leading - decoder->trailing;
+     if (get_bits(decoder, length, &raw) < 0) return -1;
+ 
+     decoder->previous_value ^= (uint32_t)(raw << decoder->trailing);
+     return 0;
+ }
+ 
+ int gorilla_decode(gorilla_decoder *decoder, uint64_t *timestamp, float *value) {
+     if (decoder->remaining == 0) return -1;
+ 
+     if (decoder->count == 0) {
+         uint64_t raw;
+ 
+         if (get_bits64(decoder, &decoder->previous_timestamp) < 0) return -1;
+         if (get_bits(decoder, 32, &raw) < 0) return -1;
+         decoder->previous_value = (uint32_t)raw;
+     } else if (decode_timestamp(decoder) < 0 || decode_value(decoder) < 0) {
+         return -1;
+     }
+ 
+     decoder->remaining--;
+     decoder->count++;
+ 
+     *timestamp = decoder->previous_timestamp;
+     *value = bits_float(decoder->previous_value);
+     return 0;
+ }
\ No newline at end of file
@@ -0,0 +1,69 @@
+/**
+ * Gorilla Time-Series Compression
+ *
+ * Streaming encoder and decoder for one sensor channel: timestamps are
+ * stored as delta-of-deltas and values as the XOR with the previous
+ * value, as described for Facebook's Gorilla TSDB (adapted to 32-bit
+ * floats). Slowly changing readings at a steady rate take a few bits
+ * per sample instead of 96.
+ */
+
+ #ifndef WATER_QUALITY_GORILLA_H
+ #define WATER_QUALITY_GORILLA_H
+ 
+ #include <stddef.h>
+ #include <stdint.h>
+ 
+ // Worst-case encoded size of one sample, in bytes (rounded up)
+ #define GORILLA_MAX_SAMPLE_BYTES 16
+ 
+ // Buffer size that always fits count samples
+ #define GORILLA_BUFFER_SIZE(count) ((size_t)(count) * GORILLA_MAX_SAMPLE_BYTES + 8)
+ 
+ typedef struct {
+     uint8_t *data;
+     size_t capacity;
+     size_t position;        // Bytes completely written
+     uint64_t bits;          // Pending bits not yet written as a byte
+     int bit_count;
+ 
+     uint64_t count;         // Samples encoded
+     uint64_t previous_timestamp;
+     int64_t previous_delta;
+     uint32_t previous_value;
+     uint8_t leading;        // Zero-bit window of the previous XOR
+     uint8_t trailing;
+ } gorilla_encoder;
+ 
+ typedef struct {
+     const uint8_t *data;
+     size_t size;
+     size_t position;
+     uint64_t bits;
+     int bit_count;
+ 
+     uint64_t remaining;     // Samples left to decode
+     uint64_t count;         // Samples decoded
+     uint64_t previous_timestamp;
+     int64_t previous_delta;
+     uint32_t previous_value;
+     uint8_t leading;
+     uint8_t trailing;
+ } gorilla_decoder;
+ 
+ void gorilla_encoder_init(gorilla_encoder *encoder, uint8_t *buffer, size_t capacity);
+ 
+ // Appends one sample. Returns -1 when the buffer cannot hold another sample.
+ int gorilla_encode(gorilla_encoder *encoder, uint64_t timestamp, float value);
+ 
+ // Writes the final partial byte; returns the encoded size in bytes
+ size_t gorilla_encoder_finish(gorilla_encoder *encoder);
+ 
+ // Decodes a stream produced by gorilla_encode() holding count samples
+ void gorilla_decoder_init(gorilla_decoder *decoder, const uint8_t *data, size_t size,
+                           uint64_t count);
+ 
+ // Returns 0 and the next sample, or -1 at the end of the stream or on corruption
+ int gorilla_decode(gorilla_decoder *decoder, uint64_t *timestamp, float *value);
+ 
+ #endif /* WATER_QUALITY_GORILLA_H */
\ No newline at end of file
@@ -0,0 +1,543 @@
+/**
+ * Water Quality History Store
+ *
+ * The appender fills an in-memory block; full (or flushed) blocks are
+ * queued to a writer thread that pwrite()s them at their fixed offset in
+ * every column file, updates the index and fsyncs on its own schedule.
+ * Only rows not handed to the writer before are queued and written, so
+ * flushing after every reading costs one row, not the whole block.
+ */
+
+ #define _POSIX_C_SOURCE 200809L
+ 
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <pthread.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <time.h>
+ #include <unistd.h>
+ #include "water_quality_history.h"
+ 
+ // File slots: index, timestamps, then one column per parameter
+ #define FILE_INDEX      0
+ #define FILE_TIMESTAMPS 1
+ #define FILE_PARAM(p)   (2 + (p))
+ #define NUM_FILES       (NUM_PARAMS + 2)
+ 
+ #define CHANNEL_COLUMN(id, key, ...) key ".col",
+ 
+ static const char *file_names[NUM_FILES] = {
+     "index.idx",
+     "timestamp_ms.col",
+     WATER_QUALITY_CHANNELS(CHANNEL_COLUMN)
+ };
+ 
+ typedef struct history_block {
+     struct history_block *next;
+     uint32_t number;
+     uint32_t start;                 // First row not handed to the writer yet
+     uint32_t count;
+     uint64_t timestamp_ms[HISTORY_BLOCK_READINGS];
+     float values[NUM_PARAMS][HISTORY_BLOCK_READINGS];
+ } history_block;
+ 
+ struct history_store {
+     int fds[NUM_FILES];
+     history_block *current;
+ 
+     pthread_t writer;
+     pthread_mutex_t lock;
+     pthread_cond_t wake;
+     history_block *queue_head;      // Blocks waiting to be written
+     history_block *queue_tail;
+     history_block *free_blocks;     // Written blocks ready for reuse
+     int stopping;
+     int error;                      // First write error seen by the writer
+ };
+ 
+ static void join_path(char *buf, size_t size, const char *dir, const char *name) {
+     snprintf(buf, size, "%s/%s", dir, name);
+ }
+ 
+ static int write_all(int fd, const void *data, size_t size, off_t offset) {
+     const char *p = data;
+ 
+     while (size > 0) {
+         ssize_t n = pwrite(fd, p, size, offset);
+         if (n < 0) {
+             if (errno == EINTR) continue;
+             return -1;
+         }
+         p += n;
+         size -= (size_t)n;
+         offset += n;
+     }
+ 
+     return 0;
+ }
+ 
+ static int read_all(int fd, void *data, size_t size, off_t offset) {
+     char *p = data;
+ 
+     while (size > 0) {
+         ssize_t n = pread(fd, p, size, offset);
+         if (n <= 0) {
+             if (n < 0 && errno == EINTR) continue;
+             return -1;
+         }
+         p += n;
+         size -= (size_t)n;
+         offset += n;
+     }
+ 
+     return 0;
+ }
+ 
+ static int write_block(history_store *store, const history_block *block) {
+     off_t row = (off_t)block->number * HISTORY_BLOCK_READINGS + block->start;
+     size_t rows = block->count - block->start;
+     history_index_entry entry;
+ 
+     if (write_all(store->fds[FILE_TIMESTAMPS], block->timestamp_ms + block->start,
+                   rows * sizeof(uint64_t), row * (off_t)sizeof(uint64_t)) < 0) {
+         return -1;
+     }
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         if (write_all(store->fds[FILE_PARAM(p)], block->values[p] + block->start,
+                       rows * sizeof(float), row * (off_t)sizeof(float)) < 0) {
+             return -1;
+         }
+     }
+ 
+     // The index entry goes last so it never covers unwritten rows
+     memset(&entry, 0, sizeof(entry));
+     entry.first_timestamp_ms = block->timestamp_ms[0];
+     entry.last_timestamp_ms = block->timestamp_ms[block->count - 1];
+     entry.count = block->count;
+ 
+     return write_all(store->fds[FILE_INDEX], &entry, sizeof(entry),
+                      (off_t)sizeof(history_index_header) +
+                      (off_t)block->number * (off_t)sizeof(entry));
+ }
+ 
+ static void sync_files(history_store *store) {
+     for (int f = 0; f < NUM_FILES; f++) {
+         fdatasync(store->fds[f]);
+     }
+ }
+ 
+ static void* writer_thread(void *arg) {
+     history_store *store = arg;
+     struct timespec last_sync;
+     int dirty = 0;
+ 
+     clock_gettime(CLOCK_REALTIME, &last_sync);
+ 
+     pthread_mutex_lock(&store->lock);
+     for (;;) {
+         struct timespec deadline = last_sync;
+         deadline.tv_sec += HISTORY_SYNC_INTERVAL;
+ 
+         while (!store->queue_head && !store->stopping) {
+             if (pthread_cond_timedwait(&store->wake, &store->lock, &deadline) == ETIMEDOUT) break;
+         }
+ 
+         history_block *pending = store->queue_head;
+         int stopping = store->stopping;
+         store->queue_head = store->queue_tail = NULL;
+         pthread_mutex_unlock(&store->lock);
+ 
+         // Disk I/O happens without the lock so appenders never wait on it
+         history_block *written = NULL;
+         while (pending) {
+             history_block *block = pending;
+             pending = block->next;
+ 
+             if (write_block(store, block) < 0 && !store->error) store->error = errno;
+             dirty = 1;
+ 
+             block->next = written;
+             written = block;
+         }
+ 
+         struct timespec now;
+         clock_gettime(CLOCK_REALTIME, &now);
+         if (dirty && (stopping || now.tv_sec >= last_sync.tv_sec + HISTORY_SYNC_INTERVAL)) {
+             sync_files(store);
+             dirty = 0;
+         }
+         if (now.tv_sec >= last_sync.tv_sec + HISTORY_SYNC_INTERVAL) last_sync = now;
+ 
+         pthread_mutex_lock(&store->lock);
+         while (written) {
+             history_block *block = written;
+             written = block->next;
+             block->next = store->free_blocks;
+             store->free_blocks = block;
+         }
+ 
+         if (stopping && !store->queue_head) break;
+     }
+     pthread_mutex_unlock(&store->lock);
+ 
+     return NULL;
+ }
+ 
+ // Takes a recycled block or allocates one; called with the lock held
+ static history_block* take_block(history_store *store) {
+     history_block *block = store->free_blocks;
+ 
+     if (block) {
+         store->free_blocks = block->next;
+     } else {
+         block = malloc(sizeof(history_block));
+     }
+ 
+     return block;
+ }
+ 
+ static void submit_block(history_store *store, history_block *block) {
+     block->next = NULL;
+     if (store->queue_tail) store->queue_tail->next = block;
+     else store->queue_head = block;
+     store->queue_tail = block;
+     pthread_cond_signal(&store->wake);
+ }
+ 
+ // Prepares the files and resumes the last, partially filled block
+ static int resume_store(history_store *store, history_block *block) {
+     history_index_header header;
+     struct stat st;
+     int fd = store->fds[FILE_INDEX];
+ 
+     block->number = 0;
+     block->start = 0;
+     block->count = 0;
+ 
+     if (fstat(fd, &st) < 0) return -1;
+ 
+     if ((size_t)st.st_size < sizeof(header)) {
+         memset(&header, 0, sizeof(header));
+         memcpy(header.magic, HISTORY_MAGIC, sizeof(header.magic));
+         header.block_readings = HISTORY_BLOCK_READINGS;
+         header.num_params = NUM_PARAMS;
+         return write_all(fd, &header, sizeof(header), 0);
+     }
+ 
+     if (read_all(fd, &header, sizeof(header), 0) < 0) return -1;
+     if (memcmp(header.magic, HISTORY_MAGIC, sizeof(header.magic)) != 0 ||
+         header.block_readings != HISTORY_BLOCK_READINGS || header.num_params != NUM_PARAMS) {
+         errno = EINVAL;
+         return -1;
+     }
+ 
+     size_t blocks = ((size_t)st.st_size - sizeof(header)) / sizeof(history_index_entry);
+     if (blocks == 0) return 0;
+ 
+     history_index_entry last;
+     off_t last_offset = (off_t)sizeof(header) + (off_t)(blocks - 1) * (off_t)sizeof(last);
+     if (read_all(fd, &last, sizeof(last), last_offset) < 0) return -1;
+ 
+     if (last.count >= HISTORY_BLOCK_READINGS) {
+         block->number = (uint32_t)blocks;
+         return 0;
+     }
+ 
+     // Reload the partial block so appends continue filling it
+     off_t row = (off_t)(blocks - 1) * HISTORY_BLOCK_READINGS;
+     block->number = (uint32_t)(blocks - 1);
+     block->start = last.count;
+     block->count = last.count;
+ 
+     if (read_all(store->fds[FILE_TIMESTAMPS], block->timestamp_ms,
+                  last.count * sizeof(uint64_t), row * (off_t)sizeof(uint64_t)) < 0) {
+         return -1;
+     }
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         if (read_all(store->fds[FILE_PARAM(p)], block->values[p],
+                      last.count * sizeof(float), row * (off_t)sizeof(float)) < 0) {
+             return -1;
+         }
+     }
+ 
+     return 0;
+ }
+ 
+ history_store* history_open(const char *dir) {
+     history_store *store;
+     char path[4096];
+ 
+     if (mkdir(dir, 0755) < 0 && errno != EEXIST) return NULL;
+ 
+     store = calloc(1, sizeof(history_store));
+     if (!store) return NULL;
+ 
+     for (int f = 0; f < NUM_FILES; f++) {
+         store->fds[f] = -1;
+     }
+ 
+     for (int f = 0; f < NUM_FILES; f++) {
+         join_path(path, sizeof(path), dir, file_names[f]);
+         store->fds[f] = open(path, O_RDWR | O_CREAT, 0644);
+         if (store->fds[f] < 0) goto fail;
+     }
+ 
+     store->current = malloc(sizeof(history_block));
+     if (!store->current || resume_store(store, store->current) < 0) goto fail;
+ 
+     pthread_mutex_init(&store->lock, NULL);
+     pthread_cond_init(&store->wake, NULL);
+     if (pthread_create(&store->writer, NULL, writer_thread, store) != 0) goto fail;
+ 
+     return store;
+ 
+ fail:
+     for (int f = 0; f < NUM_FILES; f++) {
+         if (store->fds[f] >= 0) close(store->fds[f]);
+     }
+     free(store->current);
+     free(store);
+     return NULL;
+ }
+ 
+ int history_append(history_store *store, uint64_t timestamp_ms, const float values[NUM_PARAMS]) {
+     history_block *block = store->current;
+     uint32_t i = block->count;
+ 
+     block->timestamp_ms[i] = timestamp_ms;
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         block->values[p][i] = values[p];
+     }
+     block->count = i + 1;
+ 
+     if (block->count < HISTORY_BLOCK_READINGS) return 0;
+ 
+     // Block is full: queue it and continue in a fresh one
+     pthread_mutex_lock(&store->lock);
+     history_block *next = take_block(store);
+     if (next) submit_block(store, block);
+     pthread_mutex_unlock(&store->lock);
+ 
+     if (!next) {
+         block->count--;
+         errno = ENOMEM;
+         return -1;
+     }
+ 
+     next->number = block->number + 1;
+     next->start = 0;
+     next->count = 0;
+     store->current = next;
+ 
+     return 0;
+ }
+ 
+ int history_flush(history_store *store) {
+     history_block *block = store->current;
+ 
+     uint32_t start = block->start;
+ 
+     if (block->count == start) return 0;
+ 
+     // Queue a snapshot of the new rows at their place in the block, plus
+     // the first timestamp for the index entry; the live block keeps filling
+     pthread_mutex_lock(&store->lock);
+     history_block *copy = take_block(store);
+     if (copy) {
+         copy->number = block->number;
+         copy->start = start;
+         copy->count = block->count;
+         copy->timestamp_ms[0] = block->timestamp_ms[0];
+         memcpy(copy->timestamp_ms + start, block->timestamp_ms + start,
+                (block->count - start) * sizeof(uint64_t));
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             memcpy(copy->values[p] + start, block->values[p] + start,
+                    (block->count - start) * sizeof(float));
+         }
+         submit_block(store, copy);
+     }
+     pthread_mutex_unlock(&store->lock);
+ 
+     if (!copy) {
+         errno = ENOMEM;
+         return -1;
+     }
+ 
+     block->start = block->count;
+     return 0;
+ }
+ 
+ int history_close(history_store *store) {
+     int result = history_flush(store);
+ 
+     pthread_mutex_lock(&store->lock);
+     store->stopping = 1;
+     pthread_cond_signal(&store->wake);
+     pthread_mutex_unlock(&store->lock);
+     pthread_join(store->writer, NULL);
+ 
+     if (store->error) {
+         errno = store->error;
+         result = -1;
+     }
+ 
+     for (int f = 0; f < NUM_FILES; f++) {
+         close(store->fds[f]);
+     }
+ 
+     while (store->free_blocks) {
+         history_block *block = store->free_blocks;
+         store->free_blocks = block->next;
+         free(block);
+     }
+     free(store->current);
+     pthread_mutex_destroy(&store->lock);
+     pthread_cond_destroy(&store->wake);
+     free(store);
+ 
+     return result;
+ }
+ 
+ static void* map_file(const char *dir, const char *name, size_t *size) {
+     char path[4096];
+     struct stat st;
+     void *data;
+     int fd;
+ 
+     join_path(path, sizeof(path), dir, name);
+     fd = open(path, O_RDONLY);
+     if (fd < 0) return NULL;
+ 
+     if (fstat(fd, &st) < 0 || st.st_size == 0) {
+         close(fd);
+         *size = 0;
+         return NULL;
+     }
+ 
+     data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+     close(fd);
+     if (data == MAP_FAILED) return NULL;
+ 
+     *size = (size_t)st.st_size;
+     return data;
+ }
+ 
+ int history_reader_open(history_reader *reader, const char *dir) {
+     const history_index_header *header;
+ 
+     memset(reader, 0, sizeof(*reader));
+ 
+     for (int f = 0; f < NUM_FILES; f++) {
+         reader->mappings[f] = map_file(dir, file_names[f], &reader->mapping_sizes[f]);
+     }
+ 
+     header = reader->mappings[FILE_INDEX];
+     if (!header || reader->mapping_sizes[FILE_INDEX] < sizeof(*header) ||
+         memcmp(header->magic, HISTORY_MAGIC, sizeof(header->magic)) != 0 ||
+         header->block_readings != HISTORY_BLOCK_READINGS || header->num_params != NUM_PARAMS) {
+         history_reader_close(reader);
+         errno = EINVAL;
+         return -1;
+     }
+ 
+     reader->index = (const history_index_entry *)(header + 1);
+     reader->blocks = (reader->mapping_sizes[FILE_INDEX] - sizeof(*header)) /
+                      sizeof(history_index_entry);
+     if (reader->blocks > 0) {
+         reader->rows = (reader->blocks - 1) * HISTORY_BLOCK_READINGS +
+                        reader->index[reader->blocks - 1].count;
+     }
+ 
+     // Never expose rows the column files do not cover yet
+     size_t available = reader->mapping_sizes[FILE_TIMESTAMPS] / sizeof(uint64_t);
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         size_t column_rows = reader->mapping_sizes[FILE_PARAM(p)] / sizeof(float);
+         if (column_rows < available) available = column_rows;
+     }
+     if (reader->rows > available) reader->rows = available;
+ 
+     reader->timestamp_ms = reader->mappings[FILE_TIMESTAMPS];
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         reader->values[p] = reader->mappings[FILE_PARAM(p)];
+     }
+ 
+     return 0;
+ }
+ 
+ void history_reader_close(history_reader *reader) {
+     for (int f = 0; f < NUM_FILES; f++) {
+         if (reader->mappings[f]) munmap(reader->mappings[f], reader->mapping_sizes[f]);
+     }
+     memset(reader, 0, sizeof(*reader));
+ }
+ 
+ // First row in [lo, hi) whose timestamp is greater than (or equal to, when
+ // inclusive) the given time
+ static size_t lower_row(const uint64_t *timestamps, size_t lo, size_t hi,
+                         uint64_t timestamp_ms, int inclusive) {
+     while (lo < hi) {
+         size_t mid = lo + (hi - lo) / 2;
+         int before = inclusive ? timestamps[mid] < timestamp_ms : timestamps[mid] <= timestamp_ms;
+         if (before) lo = mid + 1;
+         else hi = mid;
+     }
+     return lo;
+ }
+ 
+ // Row where the search for a timestamp starts: the first row of the first
+ // block whose span reaches (or passes, when not inclusive) that time
+ static size_t block_start(const history_reader *reader, uint64_t timestamp_ms, int inclusive) {
+     size_t lo = 0;
+     size_t hi = reader->blocks;
+ 
+     while (lo < hi) {
+         size_t mid = lo + (hi - lo) / 2;
+         uint64_t last = reader->index[mid].last_timestamp_ms;
+         int before = inclusive ? last < timestamp_ms : last <= timestamp_ms;
+         if (before) lo = mid + 1;
+         else hi = mid;
+     }
+ 
+     size_t row = lo * HISTORY_BLOCK_READINGS;
+     return row < reader->rows ? row : reader->rows;
+ }
+ 
+ size_t history_query(const history_reader *reader, uint64_t from_ms, uint64_t to_ms,
+                      size_t *first) {
+     size_t begin;
+     size_t end;
+ 
+     *first = 0;
+     if (reader->rows == 0 || from_ms > to_ms) return 0;
+ 
+     // The index narrows each search to one block of the timestamp column
+     begin = block_start(reader, from_ms, 1);
+     size_t limit = begin + HISTORY_BLOCK_READINGS < reader->rows ?
+                    begin + HISTORY_BLOCK_READINGS : reader->rows;
+     begin = lower_row(reader->timestamp_ms, begin, limit, from_ms, 1);
+ 
+     end = block_start(reader, to_ms, 0);
+     limit = end + HISTORY_BLOCK_READINGS < reader->rows ?
+             end + HISTORY_BLOCK_READINGS : reader->rows;
+     end = lower_row(reader->timestamp_ms, end, limit, to_ms, 0);
+ 
+     *first = begin;
+     return end > begin ? end - begin : 0;
+ }
+ 
+ int history_column_open(const char *dir, int column) {
+     char path[4096];
+ 
+     if (column < 0 || column > NUM_PARAMS) {
+         errno = EINVAL;
+         return -1;
+     }
+ 
+     join_path(path, sizeof(path), dir, file_names[FILE_TIMESTAMPS + column]);
+     return open(path, O_RDONLY);
+ }
\ No newline at end of file
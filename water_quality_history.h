@@ -0,0 +1,82 @@
+/**
+ * Water Quality History Store
+ *
+ * Append-only columnar storage of readings. Every parameter (and the
+ * timestamps) lives in its own column file made of fixed-size blocks;
+ * a small index records the time span of each block. Appends only copy
+ * into memory, full blocks are written and fsync'd by a background
+ * thread, and queries read the column files through mmap without any
+ * deserialization.
+ *
+ * Directory layout:
+ *   index.idx          history_index_header + one history_index_entry per block
+ *   timestamp_ms.col   uint64_t per reading
+ *   <parameter>.col    float per reading, one file per parameter
+ */
+
+ #ifndef WATER_QUALITY_HISTORY_H
+ #define WATER_QUALITY_HISTORY_H
+ 
+ #include <stddef.h>
+ #include <stdint.h>
+ #include "water_quality_config.h"
+ 
+ #define HISTORY_MAGIC          "WQHIST01"
+ #define HISTORY_BLOCK_READINGS 1024  // Readings per column block
+ #define HISTORY_SYNC_INTERVAL  5     // Seconds between background fsyncs
+ 
+ typedef struct {
+     char magic[8];
+     uint32_t block_readings;
+     uint32_t num_params;
+ } history_index_header;
+ 
+ typedef struct {
+     uint64_t first_timestamp_ms;
+     uint64_t last_timestamp_ms;
+     uint32_t count;              // Readings in the block (< block size only for the last one)
+     uint32_t reserved;
+ } history_index_entry;
+ 
+ typedef struct history_store history_store;
+ 
+ // Opens (creating if needed) a history directory for appending
+ history_store* history_open(const char *dir);
+ 
+ // Adds one reading. Never waits for disk I/O. Timestamps must not decrease.
+ int history_append(history_store *store, uint64_t timestamp_ms, const float values[NUM_PARAMS]);
+ 
+ // Hands the rows appended since the last flush to the writer so queries
+ // can see them
+ int history_flush(history_store *store);
+ 
+ // Flushes, syncs and stops the writer thread
+ int history_close(history_store *store);
+ 
+ // Read-only view of a history directory. Columns point into the mappings.
+ typedef struct {
+     size_t rows;
+     size_t blocks;
+     const history_index_entry *index;
+     const uint64_t *timestamp_ms;
+     const float *values[NUM_PARAMS];
+ 
+     void *mappings[NUM_PARAMS + 2];
+     size_t mapping_sizes[NUM_PARAMS + 2];
+ } history_reader;
+ 
+ int history_reader_open(history_reader *reader, const char *dir);
+ void history_reader_close(history_reader *reader);
+ 
+ // Finds the rows with from_ms <= timestamp <= to_ms. Stores the first row
+ // in *first and returns the number of rows.
+ size_t history_query(const history_reader *reader, uint64_t from_ms, uint64_t to_ms,
+                      size_t *first);
+ 
+ // Opens one column file read-only, for copying rows out without mapping
+ // them (sendfile): column 0 holds the timestamps (uint64_t), column 1 + p
+ // parameter p (float). Row r starts at r times the value size. Returns -1
+ // with errno set.
+ int history_column_open(const char *dir, int column);
+ 
+ #endif /* WATER_QUALITY_HISTORY_H */
\ No newline at end of file
@@ -0,0 +1,62 @@
+/**
+ * Quality Level Hysteresis
+ *
+ * While a change is pending, samples pointing further in the same
+ * direction keep counting towards it, and the filter settles on the
+ * smallest change seen during the dwell: a value alternating between
+ * Alert and Critical readings from Good moves to Alert, not nowhere.
+ */
+
+ #include "water_quality_hysteresis.h"
+ 
+ void level_filter_config_init_default(level_filter_config *config) {
+     config->escalate_samples = ESCALATE_SAMPLES;
+     config->recover_samples = RECOVER_SAMPLES;
+ }
+ 
+ void level_filter_init(level_filter *filter) {
+     filter->level = LEVEL_FILTER_UNSET;
+     filter->pending = LEVEL_FILTER_UNSET;
+     filter->count = 0;
+ }
+ 
+ uint8_t level_filter_update(level_filter *filter, const level_filter_config *config,
+                             uint8_t raw_level, uint8_t strict_level) {
+     uint8_t target;
+ 
+     // The first sample sets the level directly
+     if (filter->level == LEVEL_FILTER_UNSET) {
+         filter->level = raw_level;
+         filter->count = 0;
+         return raw_level;
+     }
+ 
+     if (raw_level > filter->level) {
+         target = raw_level;
+     } else if (strict_level < filter->level) {
+         target = strict_level;
+     } else {
+         target = filter->level;
+     }
+ 
+     if (target == filter->level) {
+         filter->count = 0;
+         return filter->level;
+     }
+ 
+     int worse = target > filter->level;
+     if (filter->count > 0 && worse == (filter->pending > filter->level)) {
+         if (worse ? target < filter->pending : target > filter->pending) filter->pending = target;
+     } else {
+         filter->pending = target;
+         filter->count = 0;
+     }
+ 
+     filter->count++;
+     if (filter->count >= (worse ? config->escalate_samples : config->recover_samples)) {
+         filter->level = filter->pending;
+         filter->count = 0;
+     }
+ 
+     return filter->level;
+ }
\ No newline at end of file
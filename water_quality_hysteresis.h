@@ -0,0 +1,41 @@
+/**
+ * Quality Level Hysteresis
+ *
+ * Debounces the quality level of one parameter so a value sitting on a
+ * boundary does not flip between levels on every sample. A worse level
+ * is entered at the normal boundary, a better one only once the value is
+ * a hysteresis band past it, and either change must hold for a minimum
+ * number of consecutive samples. Plain C99 with no host dependencies, so
+ * the simulator and the firmware share it.
+ */
+
+ #ifndef WATER_QUALITY_HYSTERESIS_H
+ #define WATER_QUALITY_HYSTERESIS_H
+ 
+ #include <stdint.h>
+ #include "water_quality_config.h"
+ 
+ #define LEVEL_FILTER_UNSET 0xFF     // No sample seen yet
+ 
+ typedef struct {
+     uint8_t escalate_samples;       // Consecutive samples before moving to a worse level
+     uint8_t recover_samples;        // Consecutive samples before moving to a better level
+ } level_filter_config;
+ 
+ typedef struct {
+     uint8_t level;                  // Debounced level
+     uint8_t pending;                // Level the value is moving towards
+     uint8_t count;                  // Consecutive samples supporting pending
+ } level_filter;
+ 
+ // ESCALATE_SAMPLES and RECOVER_SAMPLES from water_quality_config.h
+ void level_filter_config_init_default(level_filter_config *config);
+ 
+ void level_filter_init(level_filter *filter);
+ 
+ // raw_level classifies the sample with the normal bounds, strict_level with
+ // every band narrowed by the hysteresis margin. Returns the debounced level.
+ uint8_t level_filter_update(level_filter *filter, const level_filter_config *config,
+                             uint8_t raw_level, uint8_t strict_level);
+ 
+ #endif /* WATER_QUALITY_HYSTERESIS_H */
\ No newline at end of file
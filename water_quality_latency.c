@@ -0,0 +1,172 @@
+/**
+ * Latency Histograms
+ *
+ * Bucket b below LATENCY_SUB_BUCKETS holds exactly the value b. Above
+ * that, bucket (e - 2) * 8 + s holds the values whose highest set bit is
+ * e and whose next three bits are s, i.e. [2^e + s * 2^(e-3),
+ * 2^e + (s+1) * 2^(e-3)). Every power of two therefore starts a bucket,
+ * so the buckets below one hold exactly the values up to 2^e - 1 ns,
+ * which the Prometheus export uses as its (inclusive) bounds.
+ */
+
+ #define _POSIX_C_SOURCE 200809L
+ 
+ #include <errno.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+ #include "water_quality_latency.h"
+ 
+ // Prometheus bucket bounds: 2^e - 1 ns for e from 6 to 34 (63 ns .. 17 s)
+ #define PROMETHEUS_MIN_EXPONENT 6
+ #define PROMETHEUS_MAX_EXPONENT 34
+ 
+ uint64_t latency_bucket_low(int bucket) {
+     if (bucket < LATENCY_SUB_BUCKETS) return (uint64_t)bucket;
+ 
+     int exponent = bucket / LATENCY_SUB_BUCKETS + LATENCY_SUB_BITS - 1;
+     uint64_t sub = (uint64_t)(bucket % LATENCY_SUB_BUCKETS);
+ 
+     return (1ULL << exponent) + (sub << (exponent - LATENCY_SUB_BITS));
+ }
+ 
+ static uint64_t bucket_high(int bucket) {
+     if (bucket == LATENCY_BUCKETS - 1) return UINT64_MAX;
+     return latency_bucket_low(bucket + 1) - 1;
+ }
+ 
+ void latency_snapshot(const latency_histogram *hist, latency_histogram *copy) {
+     uint64_t count = 0;
+ 
+     for (int b = 0; b < LATENCY_BUCKETS; b++) {
+         copy->counts[b] = __atomic_load_n(&hist->counts[b], __ATOMIC_RELAXED);
+         count += copy->counts[b];
+     }
+ 
+     // Derive count from the buckets so quantiles always add up, even if
+     // the writer was halfway through a record when the copy was taken
+     copy->count = count;
+     copy->sum_ns = __atomic_load_n(&hist->sum_ns, __ATOMIC_RELAXED);
+     copy->max_ns = __atomic_load_n(&hist->max_ns, __ATOMIC_RELAXED);
+ }
+ 
+ uint64_t latency_quantile(const latency_histogram *hist, double q) {
+     if (hist->count == 0) return 0;
+ 
+     uint64_t rank = (uint64_t)(q * (double)hist->count);
+     uint64_t seen = 0;
+ 
+     if (rank >= hist->count) rank = hist->count - 1;
+ 
+     for (int b = 0; b < LATENCY_BUCKETS; b++) {
+         seen += hist->counts[b];
+         if (seen > rank) {
+             uint64_t high = bucket_high(b);
+             return high < hist->max_ns ? high : hist->max_ns;
+         }
+     }
+ 
+     return hist->max_ns;
+ }
+ 
+ void latency_print_summary(FILE *out, const latency_histogram hists[], const char *const names[],
+                            int count) {
+     fprintf(out, "%-10s %10s %10s %10s %10s %10s %10s %10s\n",
+             "Stage", "Count", "Mean us", "p50 us", "p90 us", "p99 us", "p99.9 us", "Max us");
+ 
+     for (int i = 0; i < count; i++) {
+         latency_histogram snapshot;
+         latency_snapshot(&hists[i], &snapshot);
+ 
+         double mean = snapshot.count ? (double)snapshot.sum_ns / (double)snapshot.count : 0.0;
+ 
+         fprintf(out, "%-10s %10llu %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+                 names[i], (unsigned long long)snapshot.count, mean / 1000.0,
+                 latency_quantile(&snapshot, 0.50) / 1000.0,
+                 latency_quantile(&snapshot, 0.90) / 1000.0,
+                 latency_quantile(&snapshot, 0.99) / 1000.0,
+                 latency_quantile(&snapshot, 0.999) / 1000.0,
+                 snapshot.max_ns / 1000.0);
+     }
+ }
+ 
+ static void write_prometheus_histogram(FILE *out, const char *metric, const char *name,
+                                        const latency_histogram *hist) {
+     uint64_t cumulative = 0;
+     int b = 0;
+ 
+     for (int exponent = PROMETHEUS_MIN_EXPONENT; exponent <= PROMETHEUS_MAX_EXPONENT; exponent++) {
+         uint64_t le_ns = (1ULL << exponent) - 1;
+         int limit = latency_bucket(le_ns + 1);
+ 
+         // Buckets never straddle a power of two, so this is exactly the
+         // count of values <= le_ns; the bound is printed as exact decimal
+         // seconds so it never rounds past a value that is not counted
+         while (b < limit) cumulative += hist->counts[b++];
+ 
+         fprintf(out, "%s_bucket{stage=\"%s\",le=\"%llu.%09llu\"} %llu\n",
+                 metric, name, (unsigned long long)(le_ns / 1000000000ULL),
+                 (unsigned long long)(le_ns % 1000000000ULL), (unsigned long long)cumulative);
+     }
+ 
+     fprintf(out, "%s_bucket{stage=\"%s\",le=\"+Inf\"} %llu\n",
+             metric, name, (unsigned long long)hist->count);
+     fprintf(out, "%s_sum{stage=\"%s\"} %.9f\n", metric, name, (double)hist->sum_ns / 1e9);
+     fprintf(out, "%s_count{stage=\"%s\"} %llu\n", metric, name, (unsigned long long)hist->count);
+ }
+ 
+ int latency_write_prometheus(const char *path, const char *metric,
+                              const latency_histogram hists[], const char *const names[], int count) {
+     size_t length = strlen(path);
+     char *temp = malloc(length + 8);
+ 
+     if (!temp) {
+         errno = ENOMEM;
+         return -1;
+     }
+     memcpy(temp, path, length);
+     memcpy(temp + length, ".XXXXXX", 8);
+ 
+     int fd = mkstemp(temp);
+     if (fd < 0) {
+         free(temp);
+         return -1;
+     }
+ 
+     FILE *out = fdopen(fd, "w");
+     if (!out) {
+         int saved = errno;
+         close(fd);
+         unlink(temp);
+         free(temp);
+         errno = saved;
+         return -1;
+     }
+ 
+     fprintf(out, "# HELP %s Time spent in each stage of the monitoring loop.\n", metric);
+     fprintf(out, "# TYPE %s histogram\n", metric);
+ 
+     for (int i = 0; i < count; i++) {
+         latency_histogram snapshot;
+         latency_snapshot(&hists[i], &snapshot);
+         write_prometheus_histogram(out, metric, names[i], &snapshot);
+     }
+ 
+     // mkstemp creates the file 0600; collectors usually run as another user
+     int failed = fchmod(fd, 0644) < 0;
+     failed |= ferror(out) != 0;
+     failed |= fclose(out) != 0;
+ 
+     if (failed || rename(temp, path) < 0) {
+         int saved = errno;
+         unlink(temp);
+         free(temp);
+         errno = saved;
+         return -1;
+     }
+ 
+     free(temp);
+     return 0;
+ }
\ No newline at end of file
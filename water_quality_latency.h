@@ -0,0 +1,75 @@
+/**
+ * Latency Histograms
+ *
+ * HDR-style histograms with log-linear buckets: every power of two is
+ * split into 8 linear sub-buckets, so any recorded value is known to
+ * within 12.5% from a few hundred counters. Recording is a handful of
+ * instructions and never allocates or locks; each histogram has a single
+ * writer thread and may be read from any other thread.
+ */
+
+ #ifndef WATER_QUALITY_LATENCY_H
+ #define WATER_QUALITY_LATENCY_H
+ 
+ #include <stdint.h>
+ #include <stdio.h>
+ #include <time.h>
+ 
+ #define LATENCY_SUB_BITS 3
+ #define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+ #define LATENCY_MAX_EXPONENT 40     // Values from 2^40 ns (about 18 minutes) share the last bucket
+ #define LATENCY_BUCKETS ((LATENCY_MAX_EXPONENT - LATENCY_SUB_BITS + 2) * LATENCY_SUB_BUCKETS)
+ 
+ typedef struct {
+     uint64_t counts[LATENCY_BUCKETS];
+     uint64_t count;
+     uint64_t sum_ns;
+     uint64_t max_ns;
+ } latency_histogram;
+ 
+ static inline uint64_t latency_now_ns(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+ }
+ 
+ static inline int latency_bucket(uint64_t ns) {
+     if (ns < LATENCY_SUB_BUCKETS) return (int)ns;
+ 
+     int exponent = 63 - __builtin_clzll(ns);
+     if (exponent > LATENCY_MAX_EXPONENT) return LATENCY_BUCKETS - 1;
+ 
+     int sub = (int)(ns >> (exponent - LATENCY_SUB_BITS)) & (LATENCY_SUB_BUCKETS - 1);
+     return (exponent - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS + sub;
+ }
+ 
+ // Single writer; relaxed atomic stores keep concurrent readers tear-free
+ static inline void latency_record(latency_histogram *hist, uint64_t ns) {
+     uint64_t *bucket = &hist->counts[latency_bucket(ns)];
+ 
+     __atomic_store_n(bucket, *bucket + 1, __ATOMIC_RELAXED);
+     __atomic_store_n(&hist->count, hist->count + 1, __ATOMIC_RELAXED);
+     __atomic_store_n(&hist->sum_ns, hist->sum_ns + ns, __ATOMIC_RELAXED);
+     if (ns > hist->max_ns) __atomic_store_n(&hist->max_ns, ns, __ATOMIC_RELAXED);
+ }
+ 
+ // Smallest value that falls into bucket
+ uint64_t latency_bucket_low(int bucket);
+ 
+ // Consistent-enough copy of a histogram another thread is writing
+ void latency_snapshot(const latency_histogram *hist, latency_histogram *copy);
+ 
+ // Upper bound of the bucket holding quantile q (0..1) of the recorded values
+ uint64_t latency_quantile(const latency_histogram *hist, double q);
+ 
+ // Count, mean, percentiles and maximum of each histogram, one line each
+ void latency_print_summary(FILE *out, const latency_histogram hists[], const char *const names[],
+                            int count);
+ 
+ // Writes the histograms in the Prometheus text format to path through a
+ // temporary file and rename(), so collectors never see a partial file.
+ // Returns -1 with errno set on failure.
+ int latency_write_prometheus(const char *path, const char *metric,
+                              const latency_histogram hists[], const char *const names[], int count);
+ 
+ #endif /* WATER_QUALITY_LATENCY_H */
\ No newline at end of file
@@ -0,0 +1,277 @@
+/**
+ * Multi-Station Load Generator
+ *
+ * Virtual time advances in LOADGEN_EPOCH_MS steps. Each step is one
+ * parallel loop over the station array: a worker generates every reading
+ * due in the step for its stations, optionally Gorilla-encodes them per
+ * station and channel, and classifies its own chunk of readings in
+ * batches. Workers share nothing but the station array, where each
+ * station is touched by one worker per step.
+ */
+
+ #define _POSIX_C_SOURCE 200809L
+ 
+ #include <errno.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <time.h>
+ #include "water_quality_loadgen.h"
+ #include "water_quality_sensors.h"
+ #include "water_quality_gorilla.h"
+ #include "water_quality_threadpool.h"
+ 
+ #define LOADGEN_CHUNK 4096
+ #define LOADGEN_GRAIN 256                               // Stations per stolen range
+ #define LOADGEN_BASE_TIME_MS 1700000000000ULL
+ 
+ // Sampling periods assigned to stations (ms)
+ static const uint32_t station_periods[] = { 1000, 2000, 5000, 10000, 30000, 60000 };
+ 
+ #define LOADGEN_MIN_PERIOD_MS 1000
+ #define LOADGEN_MAX_EPOCH_READINGS (LOADGEN_EPOCH_MS / LOADGEN_MIN_PERIOD_MS)
+ 
+ typedef struct {
+     sensor_station sensor;
+     uint32_t period_ms;
+     uint32_t next_ms;           // Virtual time of the next reading
+ } station;
+ 
+ // Per-worker buffers; aligned so workers never share a cache line
+ typedef struct {
+     float values[NUM_PARAMS][LOADGEN_CHUNK];
+     uint8_t levels[NUM_PARAMS][LOADGEN_CHUNK];
+     uint8_t overall[LOADGEN_CHUNK];
+     size_t count;
+ 
+     uint64_t timestamp_ms[LOADGEN_MAX_EPOCH_READINGS];
+     uint8_t stream[GORILLA_BUFFER_SIZE(LOADGEN_MAX_EPOCH_READINGS)];
+ 
+     uint64_t readings;
+     uint64_t level_counts[3];
+     uint64_t stored_bytes;
+ } __attribute__((aligned(64))) worker_state;
+ 
+ typedef struct {
+     const loadgen_config *config;
+     const quality_table *table;
+     station *stations;
+     worker_state *workers;
+     uint32_t epoch_end_ms;
+ } loadgen_job;
+ 
+ static double now_seconds(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+ }
+ 
+ static void init_stations(station *stations, size_t count, uint64_t seed) {
+     size_t num_periods = sizeof(station_periods) / sizeof(station_periods[0]);
+     prng_state rng;
+ 
+     prng_seed(&rng, seed);
+ 
+     for (size_t i = 0; i < count; i++) {
+         sensor_station_init(&stations[i].sensor, seed ^ ((uint64_t)i * 0x9E3779B97F4A7C15ULL));
+         stations[i].period_ms = station_periods[prng_next(&rng) % num_periods];
+         // Spread first readings over one period so stations do not fire together
+         stations[i].next_ms = prng_next(&rng) % stations[i].period_ms;
+     }
+ }
+ 
+ // Classifies the worker's buffered readings
+ static void flush_worker(const quality_table *table, worker_state *w) {
+     sensor_batch in;
+     quality_batch out;
+ 
+     if (w->count == 0) return;
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         in.values[p] = w->values[p];
+         out.level[p] = w->levels[p];
+     }
+     out.overall = w->overall;
+ 
+     classify_batch(table, &in, &out, w->count);
+ 
+     for (size_t i = 0; i < w->count; i++) {
+         w->level_counts[w->overall[i]]++;
+     }
+ 
+     w->readings += w->count;
+     w->count = 0;
+ }
+ 
+ // Compresses one station's readings of the current step, channel by channel
+ static void store_station(worker_state *w, size_t first, size_t count) {
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         gorilla_encoder encoder;
+         gorilla_encoder_init(&encoder, w->stream, sizeof(w->stream));
+         for (size_t i = 0; i < count; i++) {
+             gorilla_encode(&encoder, w->timestamp_ms[i], w->values[p][first + i]);
+         }
+         w->stored_bytes += gorilla_encoder_finish(&encoder);
+     }
+ }
+ 
+ static void simulate_stations(void *context, size_t begin, size_t end, int worker) {
+     loadgen_job *job = context;
+     worker_state *w = &job->workers[worker];
+ 
+     for (size_t s = begin; s < end; s++) {
+         station *st = &job->stations[s];
+         float *values[NUM_PARAMS];
+         size_t first;
+         size_t count;
+ 
+         if (st->next_ms >= job->epoch_end_ms) continue;
+         count = (job->epoch_end_ms - 1 - st->next_ms) / st->period_ms + 1;
+ 
+         if (w->count + count > LOADGEN_CHUNK) {
+             flush_worker(job->table, w);
+         }
+         first = w->count;
+ 
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             values[p] = w->values[p] + first;
+         }
+         sensor_station_read_batch(&st->sensor, LOADGEN_BASE_TIME_MS + st->next_ms,
+                                   st->period_ms, count, values);
+ 
+         if (job->config->store) {
+             for (size_t i = 0; i < count; i++) {
+                 w->timestamp_ms[i] = LOADGEN_BASE_TIME_MS + st->next_ms + (uint64_t)i * st->period_ms;
+             }
+             store_station(w, first, count);
+         }
+ 
+         st->next_ms += (uint32_t)count * st->period_ms;
+         w->count += count;
+     }
+ }
+ 
+ static int run_once(const loadgen_config *config, const quality_table *table,
+                     station *stations, int threads, loadgen_run *run) {
+     loadgen_job job;
+     threadpool *pool;
+     worker_state *workers;
+     uint64_t duration_ms = (uint64_t)config->duration_s * 1000;
+     double start;
+ 
+     if (posix_memalign((void **)&workers, 64, sizeof(worker_state) * (size_t)threads) != 0) {
+         errno = ENOMEM;
+         return -1;
+     }
+     memset(workers, 0, sizeof(worker_state) * (size_t)threads);
+ 
+     pool = threadpool_create(threads);
+     if (!pool) {
+         free(workers);
+         return -1;
+     }
+ 
+     // Every run simulates exactly the same readings
+     init_stations(stations, config->stations, config->seed);
+ 
+     job.config = config;
+     job.table = table;
+     job.stations = stations;
+     job.workers = workers;
+ 
+     start = now_seconds();
+     for (uint64_t t = 0; t < duration_ms; t += LOADGEN_EPOCH_MS) {
+         uint64_t end = t + LOADGEN_EPOCH_MS;
+         job.epoch_end_ms = (uint32_t)(end < duration_ms ? end : duration_ms);
+         threadpool_for(pool, config->stations, LOADGEN_GRAIN, simulate_stations, &job);
+     }
+     for (int i = 0; i < threads; i++) {
+         flush_worker(table, &workers[i]);
+     }
+     run->seconds = now_seconds() - start;
+ 
+     run->threads = threadpool_size(pool);
+     run->readings = 0;
+     run->steals = 0;
+     run->stored_bytes = 0;
+     memset(run->level_counts, 0, sizeof(run->level_counts));
+ 
+     for (int i = 0; i < run->threads; i++) {
+         threadpool_worker_stats stats;
+         threadpool_worker_stats_get(pool, i, &stats);
+ 
+         run->readings += workers[i].readings;
+         run->steals += stats.steals;
+         run->stored_bytes += workers[i].stored_bytes;
+         for (int level = 0; level < 3; level++) {
+             run->level_counts[level] += workers[i].level_counts[level];
+         }
+     }
+     run->readings_per_second = run->seconds > 0 ? run->readings / run->seconds : 0.0;
+ 
+     threadpool_destroy(pool);
+     free(workers);
+     return 0;
+ }
+ 
+ int loadgen_sweep(const loadgen_config *config, const quality_table *table,
+                   loadgen_run runs[], int max_runs) {
+     station *stations;
+     int count = 0;
+     int threads = 1;
+ 
+     if (config->stations == 0 || config->max_threads < 1 || max_runs < 1) {
+         errno = EINVAL;
+         return -1;
+     }
+ 
+     stations = malloc(config->stations * sizeof(station));
+     if (!stations) return -1;
+ 
+     // 1, 2, 4, ... threads, always ending with max_threads
+     while (count < max_runs) {
+         if (run_once(config, table, stations, threads, &runs[count]) < 0) {
+             free(stations);
+             return -1;
+         }
+         count++;
+ 
+         if (threads == config->max_threads) break;
+         threads = threads * 2 < config->max_threads ? threads * 2 : config->max_threads;
+     }
+ 
+     for (int i = 0; i < count; i++) {
+         double ideal = runs[0].readings_per_second * runs[i].threads;
+         runs[i].efficiency = ideal > 0 ? runs[i].readings_per_second / ideal : 0.0;
+     }
+ 
+     free(stations);
+     return count;
+ }
+ 
+ void loadgen_print(const loadgen_config *config, const loadgen_run runs[], int count) {
+     printf("Load Generator Summary:\n");
+     printf("Stations: %zu, simulated time: %u s per run%s, seed %llu\n", config->stations,
+            (unsigned)config->duration_s, config->store ? ", Gorilla storage" : "",
+            (unsigned long long)config->seed);
+     if (count > 0) {
+         printf("Readings per run: %llu (Good %llu, Alert %llu, Critical %llu)\n",
+                (unsigned long long)runs[0].readings,
+                (unsigned long long)runs[0].level_counts[QUALITY_GOOD],
+                (unsigned long long)runs[0].level_counts[QUALITY_ALERT],
+                (unsigned long long)runs[0].level_counts[QUALITY_CRITICAL]);
+         if (config->store && runs[0].readings > 0) {
+             printf("Stored: %llu bytes (%.2f bytes per reading)\n",
+                    (unsigned long long)runs[0].stored_bytes,
+                    (double)runs[0].stored_bytes / runs[0].readings);
+         }
+     }
+     printf("\n");
+ 
+     printf("%8s %10s %16s %12s %10s\n", "Threads", "Time (s)", "Readings/sec", "Efficiency", "Steals");
+     for (int i = 0; i < count; i++) {
+         printf("%8d %10.3f %16.0f %11.1f%% %10llu\n", runs[i].threads, runs[i].seconds,
+                runs[i].readings_per_second, runs[i].efficiency * 100.0,
+                (unsigned long long)runs[i].steals);
+     }
+ }
\ No newline at end of file
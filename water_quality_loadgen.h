@@ -0,0 +1,47 @@
+/**
+ * Multi-Station Load Generator
+ *
+ * Simulates many virtual stations, each sampling on its own period, and
+ * pushes their readings through the classification and storage stages on
+ * a work-stealing thread pool. Runs are repeated with 1, 2, 4, ... threads
+ * to show where the pipeline stops scaling.
+ */
+
+ #ifndef WATER_QUALITY_LOADGEN_H
+ #define WATER_QUALITY_LOADGEN_H
+ 
+ #include <stddef.h>
+ #include <stdint.h>
+ #include "water_quality_config.h"
+ #include "water_quality_classify.h"
+ 
+ #define LOADGEN_EPOCH_MS 60000      // Virtual time simulated per parallel step
+ #define LOADGEN_MAX_RUNS 16
+ 
+ typedef struct {
+     size_t stations;
+     int max_threads;
+     uint32_t duration_s;            // Simulated time per run
+     int store;                      // Gorilla-encode each station's readings
+     uint64_t seed;                  // Station i is seeded from seed and i
+ } loadgen_config;
+ 
+ typedef struct {
+     int threads;
+     uint64_t readings;
+     double seconds;
+     double readings_per_second;
+     double efficiency;              // Rate relative to threads x the 1-thread rate
+     uint64_t steals;
+     uint64_t level_counts[3];       // Overall quality of every reading
+     uint64_t stored_bytes;          // Compressed size when storing
+ } loadgen_run;
+ 
+ // Runs the simulation once per thread count up to config->max_threads.
+ // Returns the number of runs written to runs[], or -1 with errno set.
+ int loadgen_sweep(const loadgen_config *config, const quality_table *table,
+                   loadgen_run runs[], int max_runs);
+ 
+ void loadgen_print(const loadgen_config *config, const loadgen_run runs[], int count);
+ 
+ #endif /* WATER_QUALITY_LOADGEN_H */
\ No newline at end of file
@@ -5,54 +5,914 @@
  * and categorizing water quality based on predefined thresholds.
  */
 
+ #define _POSIX_C_SOURCE 200809L
+ 
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <pthread.h>
+ #include <sched.h>
+ #include <signal.h>
  #include <stdio.h>
  #include <stdlib.h>
+ #include <stdint.h>
+ #include <string.h>
  #include <time.h>
  #include <unistd.h>
  #include "water_quality_config.h"
+ #include "water_quality_classify.h"
+ #include "water_quality_analysis.h"
+ #include "water_quality_sensors.h"
+ #include "water_quality_replay.h"
+ #include "water_quality_history.h"
+ #include "water_quality_loadgen.h"
+ #include "water_quality_scheduler.h"
+ #include "water_quality_ring.h"
+ #include "water_quality_latency.h"
+ #include "water_quality_window.h"
+ #include "water_quality_trend.h"
+ #include "water_quality_output.h"
+ #include "water_quality_profile.h"
+ #include "water_quality_rcu.h"
+ #include "water_quality_telemetry.h"
+ #include "water_quality_server.h"
+ #include "water_quality_checkpoint.h"
+ 
+ #define READING_QUEUE_CAPACITY 1024     // Readings buffered between acquisition and output
+ #define METRICS_EXPORT_INTERVAL_S 15    // Seconds between Prometheus file updates (-M)
+ #define TELEMETRY_READ_SIZE 65536       // Bytes read per call when decoding telemetry (-T)
+ #define CHECKPOINT_INTERVAL_S 60        // Seconds of readings between state checkpoints (-c)
+ 
+ // Default sampling period of each channel (-i overrides them)
+ #define CHANNEL_SAMPLE_PERIOD(id, key, name, unit, pin, period_ms, ...) period_ms,
+ 
+ // Stages of the monitoring loop with a latency histogram each
+ enum {
+     STAGE_READ,         // Sensor reads (acquisition thread)
+     STAGE_CLASSIFY,     // analyze_water_quality()
+     STAGE_STORE,        // Capture and history sinks
+     STAGE_OUTPUT,       // Text report or events
+     NUM_STAGES
+ };
+ 
+ // Where readings are recorded besides the text report
+ typedef struct {
+     capture_writer *capture;
+     history_store *history;
+ } reading_sinks;
+ 
+ // What the metrics thread serves besides the latency histograms
+ typedef struct {
+     const char *export_path;        // Prometheus file (-M), or NULL
+     const char *profile_path;       // Reloaded on SIGHUP (-p), or NULL
+     const char *profile_name;
+     int stop_signals;               // SIGINT and SIGTERM stop the monitor cleanly (-c)
+ } metrics_settings;
+ 
+ // State owned by the acquisition thread, plus the queue it fills
+ typedef struct {
+     scheduler *sched;
+     sensor_station station;
+     reading_ring ring;
+     uint64_t first_sequence;        // Sequence number of the first reading
+ } acquisition;
  
  // Function prototypes
- float read_ph_sensor(void);
- float read_temperature_sensor(void);
- float read_turbidity_sensor(void);
- float read_tds_sensor(void);
- float read_dissolved_oxygen_sensor(void);
- void analyze_water_quality(float ph, float temperature, float turbidity, float tds, float dissolved_oxygen);
- const char* get_quality_category(int quality_level);
- void display_sensor_readings(float ph, float temperature, float turbidity, float tds, float dissolved_oxygen);
+ uint64_t current_time_ms(void);
  void initialize_system(void);
+ void print_usage(const char *program);
+ int run_replay(const char *replay_path, reading_sinks *sinks);
+ int run_history_query(const char *history_dir, const char *range);
+ int run_load_generator(const loadgen_config *config);
+ int run_telemetry_decode(const char *path);
+ void print_telemetry_reading(const telemetry_reading *reading, void *context);
+ int parse_sample_periods(const char *list, uint32_t period_ms[NUM_PARAMS]);
+ void* acquisition_main(void *arg);
+ void* metrics_main(void *arg);
+ threshold_profile* load_profile(const char *path, const char *name);
+ void reload_profile(const char *path, const char *name);
+ void report_missed_deadlines(const reading_record *record, uint64_t reported[NUM_PARAMS]);
+ void record_reading(reading_sinks *sinks, uint64_t timestamp_ms, const float values[NUM_PARAMS]);
+ void record_replay_chunk(const replay_chunk *chunk, void *context);
+ int close_sinks(reading_sinks *sinks);
+ 
+ // Thresholds used to classify replayed and generated readings
+ static quality_table thresholds;
+ 
+ // Thresholds of the live readings. The metrics thread replaces the profile
+ // on SIGHUP; the monitoring loop reads it without locking and reports its
+ // quiescent points to profile_rcu, which tells the reload when the old
+ // profile can be freed.
+ static threshold_profile *live_profile;
+ static rcu_domain profile_rcu;
+ 
+ // Each histogram is written by one thread only; the metrics thread reads them
+ static latency_histogram stage_latency[NUM_STAGES];
+ static const char *const stage_names[NUM_STAGES] = { "read", "classify", "store", "output" };
+ 
+ // Debounced quality levels of the live readings (off with -R)
+ static quality_stabilizer stabilizer;
+ 
+ // 1 min / 1 h / 24 h statistics of the live readings (-S)
+ static station_windows windows;
+ 
+ // Early warnings from the trend of each parameter (-t)
+ static station_trends trends;
+ static trend_config trend_settings;
+ 
+ // Set by the metrics thread on SIGINT/SIGTERM with -c, so the last state
+ // is saved before exiting
+ static int stop_requested;
+ 
+ int main(int argc, char *argv[]) {
+     const char *replay_path = NULL;
+     const char *capture_path = NULL;
+     const char *history_dir = NULL;
+     const char *query_range = NULL;
+     const char *metrics_path = NULL;
+     const char *profile_path = NULL;
+     const char *profile_name = NULL;
+     const char *telemetry_path = NULL;
+     const char *checkpoint_path = NULL;
+     const char *listen_addresses[SERVER_MAX_LISTENERS];
+     int listen_count = 0;
+     telemetry_server *server = NULL;
+     reading_sinks sinks = { NULL, NULL };
+     loadgen_config load = { 0, 0, 300, 0, 0 };
+     uint64_t seed = (uint64_t)time(NULL);
+     uint32_t sample_period_ms[NUM_PARAMS] = { WATER_QUALITY_CHANNELS(CHANNEL_SAMPLE_PERIOD) };
+     int compress_capture = 0;
+     int event_mode = 0;
+     int show_statistics = 0;
+     int raw_levels = 0;
+     float forecast_horizon_s = TREND_HORIZON_S;
+     int opt;
+ 
+     while ((opt = getopt(argc, argv, "eSRt:p:n:r:w:zH:q:L:j:d:s:i:M:T:l:c:h")) != -1) {
+         switch (opt) {
+             case 'e':
+                 // Only report quality level changes
+                 event_mode = 1;
+                 break;
+             case 'S':
+                 show_statistics = 1;
+                 break;
+             case 'R':
+                 // Report every sample's own level, without hysteresis
+                 raw_levels = 1;
+                 break;
+             case 't':
+                 forecast_horizon_s = strtof(optarg, NULL);
+                 break;
+             case 'p':
+                 profile_path = optarg;
+                 break;
+             case 'n':
+                 profile_name = optarg;
+                 break;
+             case 'r':
+                 replay_path = optarg;
+                 break;
+             case 'w':
+                 capture_path = optarg;
+                 break;
+             case 'z':
+                 compress_capture = 1;
+                 break;
+             case 'H':
+                 history_dir = optarg;
+                 break;
+             case 'q':
+                 query_range = optarg;
+                 break;
+             case 'L':
+                 load.stations = strtoul(optarg, NULL, 10);
+                 break;
+             case 'j':
+                 load.max_threads = atoi(optarg);
+                 break;
+             case 'd':
+                 load.duration_s = strtoul(optarg, NULL, 10);
+                 break;
+             case 's':
+                 seed = strtoull(optarg, NULL, 10);
+                 break;
+             case 'i':
+                 if (parse_sample_periods(optarg, sample_period_ms) < 0) {
+                     fprintf(stderr, "Invalid sample periods '%s' (expected %d values in ms)\n",
+                             optarg, NUM_PARAMS);
+                     return 1;
+                 }
+                 break;
+             case 'M':
+                 metrics_path = optarg;
+                 break;
+             case 'T':
+                 telemetry_path = optarg;
+                 break;
+             case 'l':
+                 if (listen_count == SERVER_MAX_LISTENERS) {
+                     fprintf(stderr, "At most %d listening addresses (-l)\n", SERVER_MAX_LISTENERS);
+                     return 1;
+                 }
+                 listen_addresses[listen_count++] = optarg;
+                 break;
+             case 'c':
+                 checkpoint_path = optarg;
+                 break;
+             default:
+                 print_usage(argv[0]);
+                 return opt == 'h' ? 0 : 1;
+         }
+     }
+ 
+     if (telemetry_path) return run_telemetry_decode(telemetry_path);
+ 
+     if (profile_name && !profile_path) {
+         fprintf(stderr, "-n needs a profile file (-p)\n");
+         return 1;
+     }
+ 
+     live_profile = load_profile(profile_path, profile_name);
+     if (!live_profile) return 1;
+     thresholds = live_profile->table;
+ 
+     if (query_range) {
+         if (!history_dir) {
+             fprintf(stderr, "-q needs a history directory (-H)\n");
+             return 1;
+         }
+         return run_history_query(history_dir, query_range);
+     }
+ 
+     if (load.stations > 0) {
+         // -z selects the Gorilla storage stage for the simulated stations
+         load.store = compress_capture;
+         load.seed = seed;
+         return run_load_generator(&load);
+     }
+ 
+     if (capture_path) {
+         sinks.capture = capture_open(capture_path, compress_capture);
+         if (!sinks.capture) {
+             perror(capture_path);
+             return 1;
+         }
+     }
+ 
+     if (history_dir) {
+         sinks.history = history_open(history_dir);
+         if (!sinks.history) {
+             perror(history_dir);
+             return 1;
+         }
+     }
+ 
+     if (replay_path) {
+         // Backtest a recorded capture instead of simulating live readings
+         return run_replay(replay_path, &sinks);
+     }
+ 
+     // The simulated station reproduces the same readings for the same seed
+     acquisition acq;
+     sensor_station_init(&acq.station, seed);
  
- int main() {
-     // Seed the random number generator for simulated sensor readings
-     srand(time(NULL));
-     
      // Initialize the system
      initialize_system();
-     
+     printf("Threshold profile: %s%s%s\n\n", live_profile->name,
+            profile_path ? " from " : "", profile_path ? profile_path : "");
+ 
+     // Reports bypass stdio from here on
+     fflush(stdout);
+     output_stream output;
+     if (output_init(&output, STDOUT_FILENO) < 0) {
+         perror("output");
+         return 1;
+     }
+ 
+     // Every sensor is sampled on its own fixed grid of deadlines
+     acq.sched = scheduler_create(sample_period_ms, NUM_PARAMS);
+     if (!acq.sched) {
+         perror("scheduler");
+         return 1;
+     }
+ 
+     if (reading_ring_init(&acq.ring, READING_QUEUE_CAPACITY) < 0) {
+         perror("reading queue");
+         return 1;
+     }
+ 
+     // SIGUSR1 and SIGHUP (and with -c, SIGINT and SIGTERM) are only taken
+     // by the metrics thread (sigwait), so block them here before any
+     // thread is created and inherits the mask
+     sigset_t metrics_signals;
+     sigemptyset(&metrics_signals);
+     sigaddset(&metrics_signals, SIGUSR1);
+     sigaddset(&metrics_signals, SIGHUP);
+     if (checkpoint_path) {
+         sigaddset(&metrics_signals, SIGINT);
+         sigaddset(&metrics_signals, SIGTERM);
+     }
+     pthread_sigmask(SIG_BLOCK, &metrics_signals, NULL);
+ 
+     rcu_init(&profile_rcu);
+     rcu_reader *profile_reader = rcu_register(&profile_rcu);
+ 
+     static metrics_settings metrics;
+     metrics.export_path = metrics_path;
+     metrics.profile_path = profile_path;
+     metrics.profile_name = profile_name;
+     metrics.stop_signals = checkpoint_path != NULL;
+ 
+     pthread_t metrics_thread;
+     if (pthread_create(&metrics_thread, NULL, metrics_main, &metrics) != 0) {
+         fprintf(stderr, "Failed to start the metrics thread\n");
+         return 1;
+     }
+     pthread_detach(metrics_thread);
+ 
+     // Subscribers get the live readings from the server thread; history
+     // queries read the -H store
+     if (listen_count > 0) {
+         server = server_start(listen_addresses, listen_count, history_dir);
+         if (!server) {
+             perror("telemetry server");
+             return 1;
+         }
+         for (int i = 0; i < listen_count; i++) {
+             fprintf(stderr, "Serving telemetry on %s\n", listen_addresses[i]);
+         }
+     }
+ 
+     quality_stabilizer_init(&stabilizer);
+     station_windows_init(&windows);
+     station_trends_init(&trends);
+     trend_config_init_default(&trend_settings);
+     trend_settings.horizon_s = forecast_horizon_s;
+ 
+     // Zeroed: checkpoints save it even when only event mode sets it
+     quality_result previous = { 0 };
+     quality_result current;
+     int have_previous = 0;
+     checkpoint_state state = { 0, 0, 0, &previous, &stabilizer, &trends, &windows };
+ 
+     // Carry on from the state the last run saved, so levels that already
+     // were reported are not reported again
+     if (checkpoint_path) {
+         if (checkpoint_load(checkpoint_path, &state) == 0) {
+             uint64_t now_ms = current_time_ms();
+             uint64_t age_s = now_ms > state.timestamp_ms ? (now_ms - state.timestamp_ms) / 1000 : 0;
+ 
+             have_previous = (state.flags & CHECKPOINT_HAVE_PREVIOUS) != 0;
+ 
+             // A slope that old would be extrapolated across the whole gap
+             if (age_s > TREND_SLOPE_TAU_S) station_trends_init(&trends);
+ 
+             fprintf(stderr, "Resumed from checkpoint %s (sequence %llu, %llu s old)\n", checkpoint_path,
+                     (unsigned long long)state.next_sequence, (unsigned long long)age_s);
+         } else if (errno != ENOENT) {
+             perror(checkpoint_path);
+             fprintf(stderr, "Starting without the checkpoint\n");
+         }
+     }
+     acq.first_sequence = state.next_sequence;
+ 
+     // Checkpoints are saved on their own thread; the loop only copies
+     checkpoint_writer *checkpointer = NULL;
+     if (checkpoint_path) {
+         checkpointer = checkpoint_writer_start(checkpoint_path);
+         if (!checkpointer) {
+             perror("checkpoint writer");
+             return 1;
+         }
+     }
+ 
+     // Sampling runs on its own thread; this thread analyzes and prints
+     pthread_t acquisition_thread;
+     if (pthread_create(&acquisition_thread, NULL, acquisition_main, &acq) != 0) {
+         fprintf(stderr, "Failed to start the acquisition thread\n");
+         return 1;
+     }
+ 
+     uint64_t checkpoint_due_ms = 0;
+     uint64_t missed_reported[NUM_PARAMS] = { 0 };
+     uint64_t overflows_reported = 0;
+     uint64_t overflow_warning_ms = 0;
+ 
      // Main monitoring loop
      while (1) {
-         // Simulate reading from sensors
-         float ph = read_ph_sensor();
-         float temperature = read_temperature_sensor();
-         float turbidity = read_turbidity_sensor();
-         float tds = read_tds_sensor();
-         float dissolved_oxygen = read_dissolved_oxygen_sensor();
-         
-         // Display current sensor readings
-         display_sensor_readings(ph, temperature, turbidity, tds, dissolved_oxygen);
-         
-         // Analyze water quality and trigger alerts if necessary
-         analyze_water_quality(ph, temperature, turbidity, tds, dissolved_oxygen);
-         
-         // Delay between readings (in seconds)
-         printf("\nWaiting %d seconds for next reading...\n", READING_INTERVAL);
-         printf("------------------------------------------------------\n\n");
-         sleep(READING_INTERVAL);
-     }
-     
+         reading_record record;
+ 
+         // A reload never waits for a loop blocked on an empty queue
+         if (reading_ring_empty(&acq.ring)) {
+             rcu_offline(profile_reader);
+             reading_ring_pop_wait(&acq.ring, &record);
+             rcu_online(&profile_rcu, profile_reader);
+         } else {
+             reading_ring_pop_wait(&acq.ring, &record);
+         }
+ 
+         if (record.flags & READING_END) break;
+ 
+         report_missed_deadlines(&record, missed_reported);
+ 
+         // Queued readings are older than the drops, so check the counter
+         // itself; at most one warning per second while behind
+         uint64_t overflows = reading_ring_overflows(&acq.ring);
+         uint64_t now_ms = current_time_ms();
+         if (overflows > overflows_reported && now_ms >= overflow_warning_ms + 1000) {
+             fprintf(stderr, "Warning: output is falling behind, %llu reading(s) dropped (%llu in total)\n",
+                     (unsigned long long)(overflows - overflows_reported), (unsigned long long)overflows);
+             overflows_reported = overflows;
+             overflow_warning_ms = now_ms;
+         }
+ 
+         // The profile stays valid until the next quiescent point
+         const quality_table *table = &__atomic_load_n(&live_profile, __ATOMIC_ACQUIRE)->table;
+ 
+         // Analyze water quality
+         uint64_t start_ns = latency_now_ns();
+         analyze_water_quality(table, record.values, record.timestamp_ms, &current);
+         if (!raw_levels) {
+             stabilize_water_quality(&stabilizer, table, record.values, record.due, &current);
+         }
+         uint32_t forecasts_changed = 0;
+         if (forecast_horizon_s > 0) {
+             forecasts_changed = station_trends_update(&trends, &trend_settings, table,
+                                                       record.timestamp_ms, record.values, record.due);
+         }
+         uint64_t classified_ns = latency_now_ns();
+         rcu_quiescent(&profile_rcu, profile_reader);
+ 
+         record_reading(&sinks, current.timestamp_ms, record.values);
+         if (server) server_publish(server, record.sequence, record.values, &current);
+         if (show_statistics) {
+             // Only freshly sampled channels; the others repeat their last value
+             station_windows_add(&windows, record.timestamp_ms, record.values, record.due);
+         }
+         uint64_t stored_ns = latency_now_ns();
+ 
+         latency_record(&stage_latency[STAGE_CLASSIFY], classified_ns - start_ns);
+         latency_record(&stage_latency[STAGE_STORE], stored_ns - classified_ns);
+ 
+         // The whole record is formatted straight into the output buffer
+         char *text = output_record_begin(&output);
+         if (event_mode) {
+             // Stay silent unless a parameter changed quality level
+             int changes;
+             const char *when = output_time(&output, current.timestamp_ms);
+             text = format_quality_changes(text, when, have_previous ? &previous : NULL, &current,
+                                           record.values, &changes);
+             text = format_forecast_changes(text, when, &trends, forecasts_changed);
+             previous = current;
+             have_previous = 1;
+         } else {
+             // Display current sensor readings and the analysis, with alerts if necessary
+             text = format_sensor_readings(text, record.values);
+             text = format_water_quality(text, &current);
+             text = format_forecasts(text, &trends);
+ 
+             if (show_statistics) {
+                 output_record_end(&output, text);
+                 text = format_window_statistics(output_record_begin(&output), &windows,
+                                                 record.timestamp_ms);
+             }
+ 
+             text = format_text(text, "\nWaiting ");
+             text = format_uint(text, (scheduler_next_delay_ms(acq.sched) + 500) / 1000);
+             text = format_text(text, " seconds for next reading...\n");
+             text = format_text(text, "------------------------------------------------------\n\n");
+         }
+ 
+         // Write once the queue is drained, so a backlog goes out in batches
+         int written = output_record_end(&output, text);
+         if (written == 0 && reading_ring_empty(&acq.ring)) written = output_flush(&output);
+         if (written < 0) perror("output");
+ 
+         latency_record(&stage_latency[STAGE_OUTPUT], latency_now_ns() - stored_ns);
+ 
+         state.next_sequence = record.sequence + 1;
+         state.timestamp_ms = record.timestamp_ms;
+         state.flags = have_previous ? CHECKPOINT_HAVE_PREVIOUS : 0;
+         if (checkpointer && record.timestamp_ms >= checkpoint_due_ms) {
+             if (checkpoint_writer_submit(checkpointer, &state) < 0) perror(checkpoint_path);
+             checkpoint_due_ms = record.timestamp_ms + CHECKPOINT_INTERVAL_S * 1000;
+         }
+     }
+ 
+     pthread_join(acquisition_thread, NULL);
+     if (checkpointer) {
+         checkpoint_writer_submit(checkpointer, &state);
+         if (checkpoint_writer_close(checkpointer) < 0) perror(checkpoint_path);
+     }
+     if (server) server_stop(server);
+     output_destroy(&output);
+     reading_ring_destroy(&acq.ring);
+     scheduler_destroy(acq.sched);
+     close_sinks(&sinks);
+     return __atomic_load_n(&stop_requested, __ATOMIC_ACQUIRE) ? 0 : 1;
+ }
+ 
+ void print_usage(const char *program) {
+     printf("Usage: %s [-e] [-R] [-S] [-t seconds] [-p profiles [-n name]] [-s seed] [-i periods] [-M metrics] [-l address]... [-c checkpoint] [-r capture] [-w capture [-z]] [-H dir [-q from_ms,to_ms]]\n", program);
+     printf("       %s -L stations [-j threads] [-d seconds] [-s seed] [-z] [-p profiles [-n name]]\n", program);
+     printf("       %s -T telemetry\n", program);
+     printf("  -e          Event mode: print only when a parameter's quality level changes\n");
+     printf("  -R          Raw levels: no hysteresis or debounce (levels may flip on every sample)\n");
+     printf("  -S          Add 1 min / 1 h / 24 h statistics of every parameter to each report\n");
+     printf("  -t seconds  Warn when a parameter's trend reaches a worse level within this time\n");
+     printf("              (default: %d, 0 disables the forecasts)\n", TREND_HORIZON_S);
+     printf("  -p file     Read the thresholds from a profile file (SIGHUP reloads it)\n");
+     printf("  -n name     Profile to use from the -p file (default: the first one)\n");
+     printf("  -r capture  Replay a CSV or binary capture as fast as possible and summarize it\n");
+     printf("  -w capture  Record readings to a binary capture (converts when replaying)\n");
+     printf("  -z          Gorilla-compress the capture written by -w\n");
+     printf("  -H dir      Append readings to the columnar history store in dir\n");
+     printf("  -q from,to  Summarize the history readings between two timestamps (ms)\n");
+     printf("  -L count    Load generator: simulate count stations as fast as possible\n");
+     printf("  -j threads  Largest thread count of the load generator sweep (default: all cores)\n");
+     printf("  -d seconds  Simulated time per load generator run (default: 300)\n");
+     printf("  -s seed     Seed of the simulated sensors (default: current time)\n");
+     printf("  -i periods  Sampling period of each sensor in ms: ph,temperature,turbidity,tds,do\n");
+     printf("  -M file     Write stage latency histograms to file in the Prometheus text format\n");
+     printf("              every %d s (SIGUSR1 prints them to stderr at any time)\n",
+            METRICS_EXPORT_INTERVAL_S);
+     printf("  -T file     Decode binary telemetry frames captured from the firmware ('-' for\n");
+     printf("              stdin) and print the readings as CSV\n");
+     printf("  -l address  Serve live readings and -H history queries to local clients on a\n");
+     printf("              Unix socket path or [host:]port (repeatable, up to %d)\n",
+            SERVER_MAX_LISTENERS);
+     printf("  -c file     Resume from the state checkpoint in file and save it every %d s\n",
+            CHECKPOINT_INTERVAL_S);
+ }
+ 
+ int run_replay(const char *replay_path, reading_sinks *sinks) {
+     replay_stats stats;
+     int result = 0;
+ 
+     if (replay_capture(replay_path, &thresholds, record_replay_chunk, sinks, &stats) < 0) {
+         perror(replay_path);
+         result = 1;
+     }
+ 
+     if (close_sinks(sinks) != 0) result = 1;
+ 
+     if (result == 0) replay_print_stats(&stats);
+     return result;
+ }
+ 
+ int run_history_query(const char *history_dir, const char *range) {
+     unsigned long long from_ms;
+     unsigned long long to_ms;
+     history_reader reader;
+     size_t first;
+ 
+     if (sscanf(range, "%llu,%llu", &from_ms, &to_ms) != 2) {
+         fprintf(stderr, "Invalid range '%s' (expected from_ms,to_ms)\n", range);
+         return 1;
+     }
+ 
+     if (history_reader_open(&reader, history_dir) < 0) {
+         perror(history_dir);
+         return 1;
+     }
+ 
+     size_t count = history_query(&reader, from_ms, to_ms, &first);
+ 
+     printf("History Query:\n");
+     printf("Readings: %zu of %zu stored\n", count, reader.rows);
+ 
+     if (count > 0) {
+         printf("\n%-18s %12s %12s %12s\n", "Parameter", "Min", "Mean", "Max");
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             // Columns are read straight from the mapped files
+             const float *column = reader.values[p] + first;
+             float min = column[0];
+             float max = column[0];
+             double sum = 0.0;
+ 
+             for (size_t i = 0; i < count; i++) {
+                 if (column[i] < min) min = column[i];
+                 if (column[i] > max) max = column[i];
+                 sum += column[i];
+             }
+ 
+             printf("%-18s %12.2f %12.2f %12.2f\n", get_parameter_name(p), min, sum / count, max);
+         }
+     }
+ 
+     history_reader_close(&reader);
      return 0;
  }
  
+ int run_telemetry_decode(const char *path) {
+     int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+     telemetry_decoder *decoder = malloc(sizeof(*decoder));
+     uint8_t *buffer = malloc(TELEMETRY_READ_SIZE);
+     output_stream output;
+     size_t buffered = 0;
+     int result = 0;
+ 
+     if (fd < 0 || !decoder || !buffer || output_init(&output, STDOUT_FILENO) < 0) {
+         perror(path);
+         free(decoder);
+         free(buffer);
+         if (fd > STDIN_FILENO) close(fd);
+         return 1;
+     }
+ 
+     telemetry_decoder_init(decoder);
+ 
+     char *out = output_record_begin(&output);
+     out = format_text(out, "sequence");
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         *out++ = ',';
+         out = format_text(out, get_parameter_key(p));
+     }
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         *out++ = ',';
+         out = format_text(out, get_parameter_key(p));
+         out = format_text(out, "_level");
+     }
+     *out++ = '\n';
+     output_record_end(&output, out);
+ 
+     for (;;) {
+         ssize_t got = read(fd, buffer + buffered, TELEMETRY_READ_SIZE - buffered);
+ 
+         if (got < 0) {
+             if (errno == EINTR) continue;
+             perror(path);
+             result = 1;
+             break;
+         }
+ 
+         // An incomplete frame stays at the start of the buffer for the next read
+         size_t size = buffered + (size_t)got;
+         size_t used = telemetry_decode(decoder, buffer, size, got == 0,
+                                        print_telemetry_reading, &output);
+         buffered = size - used;
+         memmove(buffer, buffer + used, buffered);
+ 
+         if (got == 0) break;
+     }
+ 
+     if (output_flush(&output) < 0) result = 1;
+     output_destroy(&output);
+ 
+     const telemetry_stats *stats = &decoder->stats;
+     fprintf(stderr, "Telemetry: %llu readings from %llu frames, %llu CRC errors, "
+             "%llu bytes skipped, %llu gaps, %llu frames before a keyframe\n",
+             (unsigned long long)stats->readings, (unsigned long long)stats->frames,
+             (unsigned long long)stats->crc_errors, (unsigned long long)stats->skipped_bytes,
+             (unsigned long long)stats->gaps, (unsigned long long)stats->unsynced);
+ 
+     free(decoder);
+     free(buffer);
+     if (fd > STDIN_FILENO) close(fd);
+     return result;
+ }
+ 
+ void print_telemetry_reading(const telemetry_reading *reading, void *context) {
+     output_stream *output = context;
+     char *out = output_record_begin(output);
+ 
+     out = format_uint(out, reading->sequence);
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         *out++ = ',';
+         out = format_centi(out, reading->values[p]);
+     }
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         *out++ = ',';
+         *out++ = (char)('0' + reading->levels[p]);
+     }
+     *out++ = '\n';
+ 
+     output_record_end(output, out);
+ }
+ 
+ int run_load_generator(const loadgen_config *config) {
+     loadgen_config load = *config;
+     loadgen_run runs[LOADGEN_MAX_RUNS];
+     int count;
+ 
+     if (load.max_threads <= 0) {
+         long cores = sysconf(_SC_NPROCESSORS_ONLN);
+         load.max_threads = cores > 0 ? (int)cores : 1;
+     }
+     if (load.duration_s == 0 || load.duration_s > 30 * 24 * 3600) {
+         fprintf(stderr, "Simulated time must be between 1 second and 30 days\n");
+         return 1;
+     }
+ 
+     count = loadgen_sweep(&load, &thresholds, runs, LOADGEN_MAX_RUNS);
+     if (count < 0) {
+         perror("load generator");
+         return 1;
+     }
+ 
+     loadgen_print(&load, runs, count);
+     return 0;
+ }
+ 
+ int parse_sample_periods(const char *list, uint32_t period_ms[NUM_PARAMS]) {
+     uint32_t parsed[NUM_PARAMS];
+     const char *p = list;
+ 
+     for (int i = 0; i < NUM_PARAMS; i++) {
+         char *end;
+         unsigned long value = strtoul(p, &end, 10);
+ 
+         if (end == p || value == 0 || value > 86400000UL) return -1;
+         if (*end != (i + 1 < NUM_PARAMS ? ',' : '\0')) return -1;
+ 
+         parsed[i] = (uint32_t)value;
+         p = end + 1;
+     }
+ 
+     for (int i = 0; i < NUM_PARAMS; i++) period_ms[i] = parsed[i];
+     return 0;
+ }
+ 
+ void* acquisition_main(void *arg) {
+     acquisition *acq = arg;
+     reading_record record = { 0 };
+ 
+     record.sequence = acq->first_sequence;
+     for (;;) {
+         uint32_t due;
+         float fresh[NUM_PARAMS];
+ 
+         if (scheduler_wait(acq->sched, &due) < 0) {
+             if (errno == EINTR) continue;
+             perror("scheduler");
+             break;
+         }
+         if (__atomic_load_n(&stop_requested, __ATOMIC_ACQUIRE)) break;
+ 
+         // Simulate reading from sensors; channels that are not due keep
+         // their previous value (every channel is due on the first pass)
+         record.timestamp_ms = current_time_ms();
+         uint64_t start_ns = latency_now_ns();
+         sensor_station_read(&acq->station, record.timestamp_ms, fresh);
+         latency_record(&stage_latency[STAGE_READ], latency_now_ns() - start_ns);
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             scheduler_channel_stats stats;
+             if (due & (1u << p)) record.values[p] = fresh[p];
+             scheduler_get_stats(acq->sched, p, &stats);
+             record.missed[p] = (uint32_t)stats.missed;
+         }
+         record.due = due;
+ 
+         // Never waits for the consumer: a full queue drops the reading
+         reading_ring_push(&acq->ring, &record);
+         record.sequence++;
+     }
+ 
+     // The end marker must get through, so wait for room
+     record.flags = READING_END;
+     while (reading_ring_push(&acq->ring, &record) < 0) {
+         sched_yield();
+     }
+ 
+     return NULL;
+ }
+ 
+ void* metrics_main(void *arg) {
+     const metrics_settings *settings = arg;
+     const char *path = settings->export_path;
+     sigset_t signals;
+     struct timespec interval = { METRICS_EXPORT_INTERVAL_S, 0 };
+ 
+     sigemptyset(&signals);
+     sigaddset(&signals, SIGUSR1);
+     sigaddset(&signals, SIGHUP);
+     if (settings->stop_signals) {
+         sigaddset(&signals, SIGINT);
+         sigaddset(&signals, SIGTERM);
+     }
+ 
+     // Histograms are only read here, so the hot path never pays for the
+     // formatting; sigtimedwait() doubles as the export timer
+     for (;;) {
+         int received = path ? sigtimedwait(&signals, NULL, &interval) : sigwaitinfo(&signals, NULL);
+ 
+         if (received == SIGUSR1) {
+             latency_print_summary(stderr, stage_latency, stage_names, NUM_STAGES);
+         } else if (received == SIGHUP) {
+             reload_profile(settings->profile_path, settings->profile_name);
+         } else if (received == SIGINT || received == SIGTERM) {
+             // The acquisition thread ends at its next deadline
+             __atomic_store_n(&stop_requested, 1, __ATOMIC_RELEASE);
+         } else if (received < 0 && errno == EAGAIN) {
+             if (latency_write_prometheus(path, "water_quality_stage_latency_seconds",
+                                          stage_latency, stage_names, NUM_STAGES) < 0) {
+                 perror(path);
+             }
+         }
+     }
+ 
+     return NULL;
+ }
+ 
+ threshold_profile* load_profile(const char *path, const char *name) {
+     int line;
+     threshold_profile *profile = profile_create(path, name, &line);
+ 
+     if (profile) return profile;
+ 
+     if (line > 0) {
+         fprintf(stderr, "%s:%d: expected '[name]' or 'parameter good_min good_max alert_min "
+                 "alert_max' with the good band inside the alert band\n", path, line);
+     } else if (errno == EINVAL) {
+         fprintf(stderr, "%s: no profile '%s'\n", path, name ? name : "");
+     } else {
+         perror(path);
+     }
+     return NULL;
+ }
+ 
+ // Runs on the metrics thread, the only one that replaces the live profile
+ void reload_profile(const char *path, const char *name) {
+     if (!path) {
+         fprintf(stderr, "SIGHUP ignored: no profile file (-p)\n");
+         return;
+     }
+ 
+     threshold_profile *fresh = load_profile(path, name);
+     if (!fresh) {
+         fprintf(stderr, "Keeping threshold profile '%s'\n", live_profile->name);
+         return;
+     }
+ 
+     // Readers pick up the new table on their next reading; the old one is
+     // freed once none of them can still be using it
+     threshold_profile *old = __atomic_exchange_n(&live_profile, fresh, __ATOMIC_ACQ_REL);
+     uint64_t start_ns = latency_now_ns();
+     rcu_synchronize(&profile_rcu);
+     free(old);
+ 
+     fprintf(stderr, "Reloaded threshold profile '%s' from %s (old table freed after %.1f ms)\n",
+             fresh->name, path, (latency_now_ns() - start_ns) / 1e6);
+ }
+ 
+ void report_missed_deadlines(const reading_record *record, uint64_t reported[NUM_PARAMS]) {
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         if (record->missed[p] > reported[p]) {
+             fprintf(stderr, "Warning: %s sampling missed %llu deadline(s) (%u in total)\n",
+                     get_parameter_name(p), (unsigned long long)(record->missed[p] - reported[p]),
+                     record->missed[p]);
+             reported[p] = record->missed[p];
+         }
+     }
+ }
+ 
+ void record_reading(reading_sinks *sinks, uint64_t timestamp_ms, const float values[NUM_PARAMS]) {
+     if (sinks->capture) {
+         capture_write(sinks->capture, timestamp_ms, values);
+         capture_flush(sinks->capture);
+     }
+ 
+     if (sinks->history) {
+         // Live readings are slow, so hand each one to the writer right away
+         history_append(sinks->history, timestamp_ms, values);
+         history_flush(sinks->history);
+     }
+ }
+ 
+ void record_replay_chunk(const replay_chunk *chunk, void *context) {
+     reading_sinks *sinks = context;
+ 
+     if (!sinks->capture && !sinks->history) return;
+ 
+     for (size_t i = 0; i < chunk->count; i++) {
+         float values[NUM_PARAMS];
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             values[p] = chunk->readings.values[p][i];
+         }
+ 
+         if (sinks->capture) capture_write(sinks->capture, chunk->timestamp_ms[i], values);
+         if (sinks->history) history_append(sinks->history, chunk->timestamp_ms[i], values);
+     }
+ }
+ 
+ int close_sinks(reading_sinks *sinks) {
+     int result = 0;
+ 
+     if (sinks->capture && capture_close(sinks->capture) != 0) {
+         perror("capture");
+         result = -1;
+     }
+ 
+     if (sinks->history && history_close(sinks->history) != 0) {
+         perror("history");
+         result = -1;
+     }
+ 
+     sinks->capture = NULL;
+     sinks->history = NULL;
+     return result;
+ }
+ 
  void initialize_system(void) {
      printf("------------------------------------------------------\n");
      printf("      WATER QUALITY MONITORING SYSTEM SIMULATION      \n");
@@ -61,148 +921,9 @@
      printf("System ready! Beginning continuous monitoring.\n\n");
  }
  
- float read_ph_sensor(void) {
-     // Simulate pH reading (typically 0-14, with 7 being neutral)
-     // Adding some random variation to simulate real-world fluctuations
-     float base_ph = 7.0;  // Neutral pH as base
-     float variation = ((float)rand() / RAND_MAX * 2.0 - 1.0) * 2.0;  // Random variation between -2 and +2
-     
-     return base_ph + variation;
- }
- 
- float read_temperature_sensor(void) {
-     // Simulate temperature reading (in Celsius)
-     // Normal water temperature might be around 15-25°C
-     float base_temp = 20.0;
-     float variation = ((float)rand() / RAND_MAX * 2.0 - 1.0) * 5.0;  // Random variation between -5 and +5
-     
-     return base_temp + variation;
- }
- 
- float read_turbidity_sensor(void) {
-     // Simulate turbidity reading (in NTU - Nephelometric Turbidity Units)
-     // Drinking water is typically <1 NTU, while very cloudy water can be >100 NTU
-     float base_turbidity = 5.0;
-     float variation = ((float)rand() / RAND_MAX) * 20.0;  // Random variation between 0 and 20
-     
-     return base_turbidity + variation;
- }
- 
- float read_tds_sensor(void) {
-     // Simulate TDS (Total Dissolved Solids) reading (in ppm - parts per million)
-     // Drinking water typically has TDS < 500 ppm
-     float base_tds = 200.0;
-     float variation = ((float)rand() / RAND_MAX) * 400.0;  // Random variation between 0 and 400
-     
-     return base_tds + variation;
- }
- 
- float read_dissolved_oxygen_sensor(void) {
-     // Simulate dissolved oxygen reading (in mg/L)
-     // Healthy water typically has DO levels > 6 mg/L
-     float base_do = 8.0;
-     float variation = ((float)rand() / RAND_MAX * 2.0 - 1.0) * 4.0;  // Random variation between -4 and +4
-     
-     return base_do + variation;
- }
- 
- void display_sensor_readings(float ph, float temperature, float turbidity, float tds, float dissolved_oxygen) {
-     printf("Current Sensor Readings:\n");
-     printf("pH: %.2f\n", ph);
-     printf("Temperature: %.2f °C\n", temperature);
-     printf("Turbidity: %.2f NTU\n", turbidity);
-     printf("TDS: %.2f ppm\n", tds);
-     printf("Dissolved Oxygen: %.2f mg/L\n", dissolved_oxygen);
-     printf("\n");
- }
- 
- void analyze_water_quality(float ph, float temperature, float turbidity, float tds, float dissolved_oxygen) {
-     int ph_quality = 0;
-     int temp_quality = 0;
-     int turbidity_quality = 0;
-     int tds_quality = 0;
-     int do_quality = 0;
-     
-     // Analyze pH
-     if (ph >= PH_GOOD_MIN && ph <= PH_GOOD_MAX) {
-         ph_quality = QUALITY_GOOD;
-     } else if ((ph >= PH_ALERT_MIN && ph < PH_GOOD_MIN) || (ph > PH_GOOD_MAX && ph <= PH_ALERT_MAX)) {
-         ph_quality = QUALITY_ALERT;
-     } else {
-         ph_quality = QUALITY_CRITICAL;
-     }
-     
-     // Analyze temperature
-     if (temperature >= TEMP_GOOD_MIN && temperature <= TEMP_GOOD_MAX) {
-         temp_quality = QUALITY_GOOD;
-     } else if ((temperature >= TEMP_ALERT_MIN && temperature < TEMP_GOOD_MIN) || 
-                (temperature > TEMP_GOOD_MAX && temperature <= TEMP_ALERT_MAX)) {
-         temp_quality = QUALITY_ALERT;
-     } else {
-         temp_quality = QUALITY_CRITICAL;
-     }
-     
-     // Analyze turbidity
-     if (turbidity <= TURBIDITY_GOOD) {
-         turbidity_quality = QUALITY_GOOD;
-     } else if (turbidity <= TURBIDITY_ALERT) {
-         turbidity_quality = QUALITY_ALERT;
-     } else {
-         turbidity_quality = QUALITY_CRITICAL;
-     }
-     
-     // Analyze TDS
-     if (tds <= TDS_GOOD) {
-         tds_quality = QUALITY_GOOD;
-     } else if (tds <= TDS_ALERT) {
-         tds_quality = QUALITY_ALERT;
-     } else {
-         tds_quality = QUALITY_CRITICAL;
-     }
-     
-     // Analyze dissolved oxygen
-     if (dissolved_oxygen >= DO_GOOD) {
-         do_quality = QUALITY_GOOD;
-     } else if (dissolved_oxygen >= DO_ALERT) {
-         do_quality = QUALITY_ALERT;
-     } else {
-         do_quality = QUALITY_CRITICAL;
-     }
-     
-     // Display quality analysis
-     printf("Water Quality Analysis:\n");
-     printf("pH: %s\n", get_quality_category(ph_quality));
-     printf("Temperature: %s\n", get_quality_category(temp_quality));
-     printf("Turbidity: %s\n", get_quality_category(turbidity_quality));
-     printf("TDS: %s\n", get_quality_category(tds_quality));
-     printf("Dissolved Oxygen: %s\n", get_quality_category(do_quality));
-     
-     // Determine overall water quality (worst case)
-     int overall_quality = ph_quality;
-     if (temp_quality > overall_quality) overall_quality = temp_quality;
-     if (turbidity_quality > overall_quality) overall_quality = turbidity_quality;
-     if (tds_quality > overall_quality) overall_quality = tds_quality;
-     if (do_quality > overall_quality) overall_quality = do_quality;
-     
-     printf("\nOVERALL WATER QUALITY: %s\n", get_quality_category(overall_quality));
-     
-     // Trigger alert if necessary
-     if (overall_quality == QUALITY_ALERT) {
-         printf("⚠️ ALERT: Water quality requires attention!\n");
-     } else if (overall_quality == QUALITY_CRITICAL) {
-         printf("🚨 CRITICAL: Immediate action required! Water quality is unsafe!\n");
-     }
- }
- 
- const char* get_quality_category(int quality_level) {
-     switch (quality_level) {
-         case QUALITY_GOOD:
-             return "Good";
-         case QUALITY_ALERT:
-             return "Alert";
-         case QUALITY_CRITICAL:
-             return "Critical";
-         default:
-             return "Unknown";
-     }
- }
\ No newline at end of file
+ uint64_t current_time_ms(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_REALTIME, &ts);
+     return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+ }
+ 
\ No newline at end of file
@@ -9,39 +9,88 @@
 
  #include <avr/io.h>
  #include <avr/interrupt.h>
+ #include <avr/sleep.h>
+ #include <avr/wdt.h>
+ #include <avr/pgmspace.h>
  #include <util/delay.h>
  #include <stdio.h>
  #include <stdlib.h>
  #include "water_quality_config.h"
+ #include "water_quality_hysteresis.h"
+ #include "water_quality_adc.h"
+ #include "water_quality_sampler.h"
+ #include "water_quality_uart.h"
+ #include "water_quality_telemetry.h"
+ #include "water_quality_adaptive.h"
  
- // Pin definitions
- #define PH_SENSOR_PIN          0  // Analog pin A0
- #define TEMPERATURE_SENSOR_PIN 1  // Analog pin A1
- #define TURBIDITY_SENSOR_PIN   2  // Analog pin A2
- #define TDS_SENSOR_PIN         3  // Analog pin A3
- #define DO_SENSOR_PIN          4  // Analog pin A4
- 
+ // Pin definitions (sensor pins are in the channel registry)
  #define RED_LED_PIN            9  // Digital pin for red LED (critical)
  #define YELLOW_LED_PIN         10 // Digital pin for yellow LED (alert)
  #define GREEN_LED_PIN          11 // Digital pin for green LED (good)
  
+ // Analog pin of each parameter, indexed by PARAM_*
+ #define CHANNEL_PIN(id, key, name, unit, pin, ...) [PARAM_##id] = pin,
+ static const uint8_t sensor_pins[NUM_PARAMS] = { WATER_QUALITY_CHANNELS(CHANNEL_PIN) };
+ 
+ // Strings stay in flash (PROGMEM) and are printed from there, so none of
+ // them is copied into the 2 KB of SRAM at startup
+ #define UART_PRINT(literal) uart_print_string_P(PSTR(literal))
+ 
+ #define CHANNEL_STRINGS(id, key, name, unit, ...) \
+     static const char name_##id[] PROGMEM = name; \
+     static const char unit_##id[] PROGMEM = unit;
+ #define CHANNEL_NAME(id, ...) [PARAM_##id] = name_##id,
+ #define CHANNEL_UNIT(id, ...) [PARAM_##id] = unit_##id,
+ 
+ WATER_QUALITY_CHANNELS(CHANNEL_STRINGS)
+ 
+ // Tables of flash pointers, in flash themselves (read with pgm_read_ptr)
+ static PGM_P const parameter_names[NUM_PARAMS] PROGMEM = { WATER_QUALITY_CHANNELS(CHANNEL_NAME) };
+ static PGM_P const parameter_units[NUM_PARAMS] PROGMEM = { WATER_QUALITY_CHANNELS(CHANNEL_UNIT) };
+ 
+ // Oversampled readings, filled by the ADC interrupt
+ static adc_sampler sampler;
+ 
+ // Output waiting for the UART, sent by its interrupt
+ static uart_tx_queue uart_queue;
+ static uint16_t dropped_reported;
+ 
+ #if TELEMETRY_BINARY
+ // Previous values and sequence number of the binary frames
+ static telemetry_encoder telemetry;
+ #endif
+ 
+ // One character at UART_BAUD (10 bits), rounded up, in microseconds
+ #define UART_CHARACTER_US (10 * 1000000UL / UART_BAUD + 1)
+ 
+ // Longest watchdog wakeup period is 8 s (2^3 s)
+ #define WATCHDOG_MAX_SHIFT 3
+ 
+ // Wait before the next reading, from the last one
+ static adaptive_schedule schedule;
+ static adaptive_config adaptive_settings;
+ 
+ // Debounced quality level of each parameter, indexed by PARAM_*
+ static level_filter level_filters[NUM_PARAMS];
+ static level_filter_config filter_config;
+ 
  // Function prototypes
  void initialize_system(void);
- void initialize_adc(void);
- void initialize_uart(void);
- uint16_t read_adc(uint8_t channel);
- float read_ph_sensor(void);
- float read_temperature_sensor(void);
- float read_turbidity_sensor(void);
- float read_tds_sensor(void);
- float read_dissolved_oxygen_sensor(void);
- void analyze_water_quality(float ph, float temperature, float turbidity, float tds, float dissolved_oxygen);
- const char* get_quality_category(int quality_level);
- void display_sensor_readings(float ph, float temperature, float turbidity, float tds, float dissolved_oxygen);
+ void read_sensors(uint16_t counts[NUM_PARAMS]);
+ uint8_t analyze_water_quality(const uint16_t counts[NUM_PARAMS], uint8_t levels[NUM_PARAMS]);
+ void display_water_quality(const uint8_t levels[NUM_PARAMS], uint8_t overall_quality);
+ void send_telemetry_frame(const uint16_t counts[NUM_PARAMS], const uint8_t levels[NUM_PARAMS]);
+ uint8_t stable_quality(uint8_t param, uint16_t count);
+ PGM_P get_quality_category(int quality_level);
+ void display_sensor_readings(const uint16_t counts[NUM_PARAMS]);
  void set_alert_leds(int quality_level);
  void uart_transmit(unsigned char data);
  void uart_print_string(const char* str);
- void uart_print_float(float value, uint8_t decimal_places);
+ void uart_print_string_P(PGM_P str);
+ void uart_print_centi(uint32_t centi);
+ void report_dropped_output(void);
+ void wait_for_uart(void);
+ void sleep_seconds(uint16_t seconds);
  
  int main(void) {
      // Initialize the system
@@ -49,27 +98,43 @@
      
      // Main monitoring loop
      while (1) {
-         // Read from sensors
-         float ph = read_ph_sensor();
-         float temperature = read_temperature_sensor();
-         float turbidity = read_turbidity_sensor();
-         float tds = read_tds_sensor();
-         float dissolved_oxygen = read_dissolved_oxygen_sensor();
+         // Read from sensors (raw ADC counts, never converted to float)
+         uint16_t counts[NUM_PARAMS];
+         read_sensors(counts);
+         
+         // Analyze water quality and set the LEDs
+         uint8_t levels[NUM_PARAMS];
+         uint16_t interval_s;
+ #if TELEMETRY_BINARY
+         analyze_water_quality(counts, levels);
+         interval_s = adaptive_update(&schedule, &adaptive_settings, counts, levels);
+         
+         // One compact frame per reading; a lost one is detected by the
+         // receiver from the sequence number
+         send_telemetry_frame(counts, levels);
+ #else
+         uint8_t overall_quality = analyze_water_quality(counts, levels);
+         interval_s = adaptive_update(&schedule, &adaptive_settings, counts, levels);
          
-         // Display current sensor readings via UART
-         display_sensor_readings(ph, temperature, turbidity, tds, dissolved_oxygen);
+         // Output is queued, never waited for; say if any was lost
+         report_dropped_output();
          
-         // Analyze water quality and trigger alerts if necessary
-         analyze_water_quality(ph, temperature, turbidity, tds, dissolved_oxygen);
+         // Display current sensor readings and their quality via UART
+         display_sensor_readings(counts);
+         display_water_quality(levels, overall_quality);
          
          // Delay between readings
-         uart_print_string("\nWaiting for next reading...\n");
-         uart_print_string("------------------------------------------------------\n\n");
+         char digits[6];
+         utoa(interval_s, digits, 10);
+         UART_PRINT("\nWaiting ");
+         uart_print_string(digits);
+         UART_PRINT(" s for next reading...\n");
+         UART_PRINT("------------------------------------------------------\n\n");
+ #endif
          
-         // Delay for READING_INTERVAL seconds
-         for (uint8_t i = 0; i < READING_INTERVAL; i++) {
-             _delay_ms(1000);  // 1 second delay
-         }
+         // Sleep until the next reading: longer while the water is stably
+         // Good, shorter while a value nears or heads for a worse level
+         sleep_seconds(interval_s);
      }
      
      return 0;  // Never reached
@@ -79,244 +144,162 @@
      // Set up LED pins as outputs
      DDRB |= (1 << RED_LED_PIN) | (1 << YELLOW_LED_PIN) | (1 << GREEN_LED_PIN);
      
-     // Initialize ADC for sensor readings
-     initialize_adc();
+     // Levels start from the first reading
+     level_filter_config_init_default(&filter_config);
+     for (uint8_t p = 0; p < NUM_PARAMS; p++) {
+         level_filter_init(&level_filters[p]);
+     }
+     
+     // Readings start at READING_INTERVAL and adapt from there
+     adaptive_config_init_default(&adaptive_settings);
+     adaptive_init(&schedule, &adaptive_settings);
      
-     // Initialize UART for communication
-     initialize_uart();
+     // Sample every sensor continuously from the ADC interrupt
+     adc_sampler_start(&sampler, sensor_pins);
+     
+     // Initialize UART for communication; a report that does not fit
+     // loses its end rather than mangling the part already queued
+     uart_tx_init(&uart_queue, UART_DROP_NEWEST);
      
      // Enable global interrupts
      sei();
      
+ #if TELEMETRY_BINARY
+     // Frames only: text would look like corrupt frames to the receiver
+     telemetry_encoder_init(&telemetry);
+ #else
      // Send startup message
-     uart_print_string("------------------------------------------------------\n");
-     uart_print_string("      WATER QUALITY MONITORING SYSTEM INITIALIZED     \n");
-     uart_print_string("------------------------------------------------------\n");
-     uart_print_string("System ready! Beginning continuous monitoring.\n\n");
- }
- 
- void initialize_adc(void) {
-     // Set ADC reference voltage to AVCC
-     ADMUX = (1 << REFS0);
-     
-     // Enable ADC and set prescaler to 128 (16MHz/128 = 125kHz)
-     ADCSRA = (1 << ADEN) | (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0);
- }
- 
- void initialize_uart(void) {
-     // Set baud rate to 9600 bps for 16MHz clock
-     UBRR0H = 0;
-     UBRR0L = 103;
-     
-     // Enable transmitter
-     UCSR0B = (1 << TXEN0);
-     
-     // Set frame format: 8 data bits, 1 stop bit, no parity
-     UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);
+     UART_PRINT("------------------------------------------------------\n");
+     UART_PRINT("      WATER QUALITY MONITORING SYSTEM INITIALIZED     \n");
+     UART_PRINT("------------------------------------------------------\n");
+     UART_PRINT("System ready! Beginning continuous monitoring.\n\n");
+ #endif
  }
  
- uint16_t read_adc(uint8_t channel) {
-     // Select ADC channel
-     ADMUX = (ADMUX & 0xF0) | (channel & 0x0F);
-     
-     // Start conversion
-     ADCSRA |= (1 << ADSC);
-     
-     // Wait for conversion to complete
-     while (ADCSRA & (1 << ADSC));
-     
-     // Return ADC value
-     return ADC;
+ ISR(ADC_vect) {
+     adc_sampler_isr(&sampler);
  }
  
- float read_ph_sensor(void) {
-     // Read raw ADC value
-     uint16_t adc_value = read_adc(PH_SENSOR_PIN);
-     
-     // Convert ADC value to pH (this conversion depends on the specific sensor)
-     // For example, if using a pH sensor with range 0-14 pH mapped to 0-1023 ADC:
-     float ph = (float)adc_value * 14.0 / 1023.0;
-     
-     return ph;
+ ISR(USART_UDRE_vect) {
+     uart_tx_isr(&uart_queue);
  }
  
- float read_temperature_sensor(void) {
-     // Read raw ADC value
-     uint16_t adc_value = read_adc(TEMPERATURE_SENSOR_PIN);
-     
-     // Convert ADC value to temperature (this conversion depends on the specific sensor)
-     // For example, if using an LM35 temperature sensor (10mV/°C):
-     // 0-1023 ADC maps to 0-5V, and each 10mV is 1°C
-     float temperature = (float)adc_value * 5.0 * 100.0 / 1023.0;
-     
-     return temperature;
+ // Only wakes the CPU from power-down
+ ISR(WDT_vect) {
  }
  
- float read_turbidity_sensor(void) {
-     // Read raw ADC value
-     uint16_t adc_value = read_adc(TURBIDITY_SENSOR_PIN);
-     
-     // Convert ADC value to turbidity (this conversion depends on the specific sensor)
-     // For example, if using a turbidity sensor with range 0-100 NTU mapped to 0-1023 ADC:
-     float turbidity = (float)adc_value * 100.0 / 1023.0;
-     
-     return turbidity;
- }
- 
- float read_tds_sensor(void) {
-     // Read raw ADC value
-     uint16_t adc_value = read_adc(TDS_SENSOR_PIN);
-     
-     // Convert ADC value to TDS (this conversion depends on the specific sensor)
-     // For example, if using a TDS sensor with range 0-1000 ppm mapped to 0-1023 ADC:
-     float tds = (float)adc_value * 1000.0 / 1023.0;
+ void read_sensors(uint16_t counts[NUM_PARAMS]) {
+     // The sampler restarts with empty rings after every sleep; wait until
+     // each holds SAMPLER_RING_SIZE values (about 70 ms) so the mean is
+     // filtered as much as a continuously running one. The CPU idles in
+     // between: the free-running ADC interrupt wakes it for every sample,
+     // so a ring filling just before sleep_mode() costs one more sample.
+     // sleep_seconds() left power-down selected.
+     set_sleep_mode(SLEEP_MODE_IDLE);
+     while (!adc_sampler_full(&sampler)) {
+         sleep_mode();
+     }
      
-     return tds;
+     // Sensor scales are in water_quality_config.h; thresholds were converted
+     // to counts at compile time
+     for (uint8_t p = 0; p < NUM_PARAMS; p++) {
+         counts[p] = adc_sampler_mean(&sampler, p);
+     }
  }
  
- float read_dissolved_oxygen_sensor(void) {
-     // Read raw ADC value
-     uint16_t adc_value = read_adc(DO_SENSOR_PIN);
-     
-     // Convert ADC value to dissolved oxygen (this conversion depends on the specific sensor)
-     // For example, if using a DO sensor with range 0-20 mg/L mapped to 0-1023 ADC:
-     float dissolved_oxygen = (float)adc_value * 20.0 / 1023.0;
+ void display_sensor_readings(const uint16_t counts[NUM_PARAMS]) {
+     UART_PRINT("Current Sensor Readings:\n");
      
-     return dissolved_oxygen;
+     for (uint8_t p = 0; p < NUM_PARAMS; p++) {
+         PGM_P unit = pgm_read_ptr(&parameter_units[p]);
+         
+         uart_print_string_P(pgm_read_ptr(&parameter_names[p]));
+         UART_PRINT(": ");
+         uart_print_centi(adc_to_centi(p, counts[p]));
+         if (pgm_read_byte(unit)) {
+             uart_transmit(' ');
+             uart_print_string_P(unit);
+         }
+         uart_transmit('\n');
+     }
+     uart_transmit('\n');
  }
  
- void display_sensor_readings(float ph, float temperature, float turbidity, float tds, float dissolved_oxygen) {
-     uart_print_string("Current Sensor Readings:\n");
-     
-     uart_print_string("pH: ");
-     uart_print_float(ph, 2);
-     uart_print_string("\n");
-     
-     uart_print_string("Temperature: ");
-     uart_print_float(temperature, 2);
-     uart_print_string(" °C\n");
+ uint8_t analyze_water_quality(const uint16_t counts[NUM_PARAMS], uint8_t levels[NUM_PARAMS]) {
+     uint8_t overall_quality = QUALITY_GOOD;
      
-     uart_print_string("Turbidity: ");
-     uart_print_float(turbidity, 2);
-     uart_print_string(" NTU\n");
+     for (uint8_t p = 0; p < NUM_PARAMS; p++) {
+         // Levels only change once a value has clearly crossed a boundary
+         // (hysteresis) for a few consecutive readings (debounce)
+         levels[p] = stable_quality(p, counts[p]);
+         
+         // Determine overall water quality (worst case)
+         if (levels[p] > overall_quality) overall_quality = levels[p];
+     }
      
-     uart_print_string("TDS: ");
-     uart_print_float(tds, 2);
-     uart_print_string(" ppm\n");
+     // Set LEDs based on water quality
+     set_alert_leds(overall_quality);
      
-     uart_print_string("Dissolved Oxygen: ");
-     uart_print_float(dissolved_oxygen, 2);
-     uart_print_string(" mg/L\n\n");
+     return overall_quality;
  }
  
- void analyze_water_quality(float ph, float temperature, float turbidity, float tds, float dissolved_oxygen) {
-     int ph_quality = 0;
-     int temp_quality = 0;
-     int turbidity_quality = 0;
-     int tds_quality = 0;
-     int do_quality = 0;
+ void display_water_quality(const uint8_t levels[NUM_PARAMS], uint8_t overall_quality) {
+     // Display quality analysis
+     UART_PRINT("Water Quality Analysis:\n");
      
-     // Analyze pH
-     if (ph >= PH_GOOD_MIN && ph <= PH_GOOD_MAX) {
-         ph_quality = QUALITY_GOOD;
-     } else if ((ph >= PH_ALERT_MIN && ph < PH_GOOD_MIN) || (ph > PH_GOOD_MAX && ph <= PH_ALERT_MAX)) {
-         ph_quality = QUALITY_ALERT;
-     } else {
-         ph_quality = QUALITY_CRITICAL;
+     for (uint8_t p = 0; p < NUM_PARAMS; p++) {
+         uart_print_string_P(pgm_read_ptr(&parameter_names[p]));
+         UART_PRINT(": ");
+         uart_print_string_P(get_quality_category(levels[p]));
+         uart_transmit('\n');
      }
      
-     // Analyze temperature
-     if (temperature >= TEMP_GOOD_MIN && temperature <= TEMP_GOOD_MAX) {
-         temp_quality = QUALITY_GOOD;
-     } else if ((temperature >= TEMP_ALERT_MIN && temperature < TEMP_GOOD_MIN) || 
-                (temperature > TEMP_GOOD_MAX && temperature <= TEMP_ALERT_MAX)) {
-         temp_quality = QUALITY_ALERT;
-     } else {
-         temp_quality = QUALITY_CRITICAL;
-     }
+     UART_PRINT("\nOVERALL WATER QUALITY: ");
+     uart_print_string_P(get_quality_category(overall_quality));
+     uart_transmit('\n');
      
-     // Analyze turbidity
-     if (turbidity <= TURBIDITY_GOOD) {
-         turbidity_quality = QUALITY_GOOD;
-     } else if (turbidity <= TURBIDITY_ALERT) {
-         turbidity_quality = QUALITY_ALERT;
-     } else {
-         turbidity_quality = QUALITY_CRITICAL;
+     // Trigger alert if necessary
+     if (overall_quality == QUALITY_ALERT) {
+         UART_PRINT("ALERT: Water quality requires attention!\n");
+     } else if (overall_quality == QUALITY_CRITICAL) {
+         UART_PRINT("CRITICAL: Immediate action required! Water quality is unsafe!\n");
      }
+ }
+ 
+ #if TELEMETRY_BINARY
+ void send_telemetry_frame(const uint16_t counts[NUM_PARAMS], const uint8_t levels[NUM_PARAMS]) {
+     int32_t values[NUM_PARAMS];
+     uint8_t frame[TELEMETRY_MAX_FRAME];
      
-     // Analyze TDS
-     if (tds <= TDS_GOOD) {
-         tds_quality = QUALITY_GOOD;
-     } else if (tds <= TDS_ALERT) {
-         tds_quality = QUALITY_ALERT;
-     } else {
-         tds_quality = QUALITY_CRITICAL;
+     for (uint8_t p = 0; p < NUM_PARAMS; p++) {
+         values[p] = (int32_t)adc_to_centi(p, counts[p]);
      }
      
-     // Analyze dissolved oxygen
-     if (dissolved_oxygen >= DO_GOOD) {
-         do_quality = QUALITY_GOOD;
-     } else if (dissolved_oxygen >= DO_ALERT) {
-         do_quality = QUALITY_ALERT;
-     } else {
-         do_quality = QUALITY_CRITICAL;
+     uint8_t length = telemetry_encode(&telemetry, values, levels, frame);
+     for (uint8_t i = 0; i < length; i++) {
+         uart_transmit(frame[i]);
      }
+ }
+ #endif
+ 
+ uint8_t stable_quality(uint8_t param, uint16_t count) {
+     // Integer comparisons against thresholds precomputed in counts
+     uint8_t raw = adc_classify(&adc_normal_bounds[param], count);
+     uint8_t strict = adc_classify(&adc_strict_bounds[param], count);
      
-     // Display quality analysis
-     uart_print_string("Water Quality Analysis:\n");
-     
-     uart_print_string("pH: ");
-     uart_print_string(get_quality_category(ph_quality));
-     uart_print_string("\n");
-     
-     uart_print_string("Temperature: ");
-     uart_print_string(get_quality_category(temp_quality));
-     uart_print_string("\n");
-     
-     uart_print_string("Turbidity: ");
-     uart_print_string(get_quality_category(turbidity_quality));
-     uart_print_string("\n");
-     
-     uart_print_string("TDS: ");
-     uart_print_string(get_quality_category(tds_quality));
-     uart_print_string("\n");
-     
-     uart_print_string("Dissolved Oxygen: ");
-     uart_print_string(get_quality_category(do_quality));
-     uart_print_string("\n");
-     
-     // Determine overall water quality (worst case)
-     int overall_quality = ph_quality;
-     if (temp_quality > overall_quality) overall_quality = temp_quality;
-     if (turbidity_quality > overall_quality) overall_quality = turbidity_quality;
-     if (tds_quality > overall_quality) overall_quality = tds_quality;
-     if (do_quality > overall_quality) overall_quality = do_quality;
-     
-     uart_print_string("\nOVERALL WATER QUALITY: ");
-     uart_print_string(get_quality_category(overall_quality));
-     uart_print_string("\n");
-     
-     // Set LEDs based on water quality
-     set_alert_leds(overall_quality);
-     
-     // Trigger alert if necessary
-     if (overall_quality == QUALITY_ALERT) {
-         uart_print_string("ALERT: Water quality requires attention!\n");
-     } else if (overall_quality == QUALITY_CRITICAL) {
-         uart_print_string("CRITICAL: Immediate action required! Water quality is unsafe!\n");
-     }
+     return level_filter_update(&level_filters[param], &filter_config, raw, strict);
  }
  
- const char* get_quality_category(int quality_level) {
+ PGM_P get_quality_category(int quality_level) {
      switch (quality_level) {
          case QUALITY_GOOD:
-             return "Good";
+             return PSTR("Good");
          case QUALITY_ALERT:
-             return "Alert";
+             return PSTR("Alert");
          case QUALITY_CRITICAL:
-             return "Critical";
+             return PSTR("Critical");
          default:
-             return "Unknown";
+             return PSTR("Unknown");
      }
  }
  
@@ -339,11 +322,8 @@
  }
  
  void uart_transmit(unsigned char data) {
-     // Wait for empty transmit buffer
-     while (!(UCSR0A & (1 << UDRE0)));
-     
-     // Put data into buffer, sends the data
-     UDR0 = data;
+     // Queue for the UART interrupt; never waits for the line
+     uart_tx_enqueue(&uart_queue, data);
  }
  
  void uart_print_string(const char* str) {
@@ -353,28 +333,86 @@
      }
  }
  
- void uart_print_float(float value, uint8_t decimal_places) {
-     // Handle negative numbers
-     if (value < 0) {
-         uart_transmit('-');
-         value = -value;
+ void uart_print_string_P(PGM_P str) {
+     // Same, reading the string from flash
+     char c;
+     while ((c = pgm_read_byte(str++))) {
+         uart_transmit(c);
      }
+ }
+ 
+ void report_dropped_output(void) {
+     uint16_t dropped = uart_tx_dropped(&uart_queue);
      
-     // Extract the integer part
-     int32_t int_part = (int32_t)value;
+     if (dropped == dropped_reported) return;
      
-     // Convert integer part to string and send
-     char int_str[10];
-     itoa(int_part, int_str, 10);
-     uart_print_string(int_str);
+     char digits[6];
+     utoa(dropped - dropped_reported, digits, 10);
+     UART_PRINT("(");
+     uart_print_string(digits);
+     UART_PRINT(" bytes of output dropped)\n");
+     dropped_reported = dropped;
+ }
+ 
+ void uart_print_centi(uint32_t centi) {
+     // Whole part, then always two decimal digits
+     char digits[11];
+     ultoa(centi / 100, digits, 10);
+     uart_print_string(digits);
      
-     // Print decimal point
+     uint8_t hundredths = (uint8_t)(centi % 100);
      uart_transmit('.');
+     uart_transmit('0' + hundredths / 10);
+     uart_transmit('0' + hundredths % 10);
+ }
+ 
+ void wait_for_uart(void) {
+     // The CPU idles while the UART (and ADC) interrupts keep running
+     set_sleep_mode(SLEEP_MODE_IDLE);
+     while (uart_tx_pending(&uart_queue)) {
+         sleep_mode();
+     }
      
-     // Extract and print decimal part
-     float decimal_part = value - int_part;
-     for (uint8_t i = 0; i < decimal_places; i++) {
-         decimal_part *= 10;
-         uart_transmit('0' + ((int)decimal_part % 10));
+     // The last byte may still be in the data and shift registers
+     while (!(UCSR0A & (1 << UDRE0)));
+     _delay_us(UART_CHARACTER_US);
+ }
+ 
+ void sleep_seconds(uint16_t seconds) {
+     // Power-down stops the UART clock mid-byte and the ADC, so finish the
+     // output and turn the converter off first
+     wait_for_uart();
+     adc_sampler_stop();
+     
+     set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+     while (seconds > 0) {
+         // Longest watchdog period (1, 2, 4 or 8 s) that fits
+         uint8_t shift = 0;
+         while (shift < WATCHDOG_MAX_SHIFT && (2u << shift) <= seconds) shift++;
+         
+         // Watchdog prescaler 6 + shift, interrupt only (no reset); WDP3
+         // is not next to WDP2..0. The change must follow WDCE within four
+         // cycles.
+         uint8_t prescaler = 6 + shift;
+         uint8_t control = (1 << WDIE) | ((prescaler & 0x08) ? (1 << WDP3) : 0) | (prescaler & 0x07);
+         
+         cli();
+         wdt_reset();
+         MCUSR &= ~(1 << WDRF);
+         WDTCSR = (1 << WDCE) | (1 << WDE);
+         WDTCSR = control;
+         
+         // sei() takes effect after the next instruction, so the wakeup
+         // cannot slip in before sleep_cpu()
+         sleep_enable();
+         sei();
+         sleep_cpu();
+         sleep_disable();
+         
+         seconds -= 1u << shift;
      }
- } 
\ No newline at end of file
+     wdt_disable();
+     
+     // Sampling resumes; read_sensors() waits for full rings
+     adc_sampler_start(&sampler, sensor_pins);
+ }
\ No newline at end of file
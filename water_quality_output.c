@@ -0,0 +1,344 @@
+/**
+ * Buffered Report Output
+ *
+ * A float multiplied by 10^d (d <= 9) is exact in double precision, so
+ * rounding the product to an integer with llrint() (ties to even, like
+ * glibc) gives exactly the digits printf("%.*f") prints. Values too large
+ * for that, NaN and infinity fall back to snprintf.
+ */
+
+ #define _POSIX_C_SOURCE 200809L
+ 
+ #include <errno.h>
+ #include <math.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <time.h>
+ #include <unistd.h>
+ #include "water_quality_output.h"
+ 
+ #define FORMAT_MAX_DECIMALS 9
+ #define FORMAT_FAST_LIMIT 1e18      // Scaled values below this fit in an int64_t
+ 
+ int output_init(output_stream *out, int fd) {
+     out->fd = fd;
+     out->count = 0;
+     out->used = 0;
+     out->cached_second = UINT64_MAX;
+     out->cached_time[0] = '\0';
+ 
+     out->buffer = malloc(OUTPUT_BUFFER_SIZE);
+     if (!out->buffer) {
+         errno = ENOMEM;
+         return -1;
+     }
+ 
+     return 0;
+ }
+ 
+ void output_destroy(output_stream *out) {
+     output_flush(out);
+     free(out->buffer);
+     out->buffer = NULL;
+ }
+ 
+ int output_record_end(output_stream *out, char *end) {
+     char *begin = output_record_begin(out);
+ 
+     // Nothing to print (an event record without changes)
+     if (end == begin) return 0;
+ 
+     out->iov[out->count].iov_base = begin;
+     out->iov[out->count].iov_len = (size_t)(end - begin);
+     out->count++;
+     out->used += (size_t)(end - begin);
+ 
+     // The next record must always find OUTPUT_RECORD_SIZE bytes free
+     if (out->count == OUTPUT_BATCH || OUTPUT_BUFFER_SIZE - out->used < OUTPUT_RECORD_SIZE) {
+         return output_flush(out);
+     }
+     return 0;
+ }
+ 
+ int output_flush(output_stream *out) {
+     struct iovec *iov = out->iov;
+     int remaining = out->count;
+ 
+     // Drop the batch even on error; the buffer is reused either way
+     out->count = 0;
+     out->used = 0;
+ 
+     while (remaining > 0) {
+         ssize_t written = writev(out->fd, iov, remaining);
+ 
+         if (written < 0) {
+             if (errno == EINTR) continue;
+             return -1;
+         }
+ 
+         // Skip what a short write took and resume inside the next record
+         while (remaining > 0 && (size_t)written >= iov->iov_len) {
+             written -= (ssize_t)iov->iov_len;
+             iov++;
+             remaining--;
+         }
+         if (remaining > 0) {
+             iov->iov_base = (char *)iov->iov_base + written;
+             iov->iov_len -= (size_t)written;
+         }
+     }
+ 
+     return 0;
+ }
+ 
+ const char* output_time(output_stream *out, uint64_t timestamp_ms) {
+     uint64_t second = timestamp_ms / 1000;
+ 
+     if (second != out->cached_second) {
+         time_t seconds = (time_t)second;
+         struct tm tm;
+ 
+         localtime_r(&seconds, &tm);
+         strftime(out->cached_time, sizeof(out->cached_time), "%Y-%m-%d %H:%M:%S", &tm);
+         out->cached_second = second;
+     }
+ 
+     return out->cached_time;
+ }
+ 
+ char* format_uint(char *out, uint64_t value) {
+     char digits[20];
+     int length = 0;
+ 
+     do {
+         digits[length++] = (char)('0' + value % 10);
+         value /= 10;
+     } while (value > 0);
+ 
+     while (length > 0) *out++ = digits[--length];
+     return out;
+ }
+ 
+ char* format_centi(char *out, int32_t centi) {
+     uint32_t magnitude = centi < 0 ? 0u - (uint32_t)centi : (uint32_t)centi;
+ 
+     if (centi < 0) *out++ = '-';
+     out = format_uint(out, magnitude / 100);
+     *out++ = '.';
+     *out++ = (char)('0' + magnitude % 100 / 10);
+     *out++ = (char)('0' + magnitude % 10);
+     return out;
+ }
+ 
+ char* format_fixed(char *out, float value, int decimals) {
+     static const double scale[FORMAT_MAX_DECIMALS + 1] = {
+         1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+     };
+     static const uint64_t divisor[FORMAT_MAX_DECIMALS + 1] = {
+         1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+         10000000ULL, 100000000ULL, 1000000000ULL
+     };
+ 
+     if (decimals < 0 || decimals > FORMAT_MAX_DECIMALS || !isfinite(value) ||
+         fabs((double)value * scale[decimals]) >= FORMAT_FAST_LIMIT) {
+         // Worst case is -FLT_MAX with 9 decimals: 50 characters
+         return out + snprintf(out, 64, "%.*f", decimals, value);
+     }
+ 
+     // printf keeps the sign of values that round to zero ("-0.00")
+     if (signbit(value)) *out++ = '-';
+ 
+     uint64_t scaled = (uint64_t)llrint(fabs((double)value * scale[decimals]));
+     out = format_uint(out, scaled / divisor[decimals]);
+ 
+     if (decimals > 0) {
+         uint64_t fraction = scaled % divisor[decimals];
+ 
+         *out++ = '.';
+         for (int i = decimals - 1; i >= 0; i--) {
+             out[i] = (char)('0' + fraction % 10);
+             fraction /= 10;
+         }
+         out += decimals;
+     }
+ 
+     return out;
+ }
+ 
+ static char* format_alert_message(char *out, int overall_quality) {
+     if (overall_quality == QUALITY_ALERT) {
+         out = format_text(out, "⚠️ ALERT: Water quality requires attention!\n");
+     } else if (overall_quality == QUALITY_CRITICAL) {
+         out = format_text(out, "🚨 CRITICAL: Immediate action required! Water quality is unsafe!\n");
+     }
+     return out;
+ }
+ 
+ char* format_sensor_readings(char *out, const float values[NUM_PARAMS]) {
+     out = format_text(out, "Current Sensor Readings:\n");
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         const char *unit = get_parameter_unit(p);
+ 
+         out = format_text(out, get_parameter_name(p));
+         out = format_text(out, ": ");
+         out = format_fixed(out, values[p], 2);
+         if (*unit) {
+             *out++ = ' ';
+             out = format_text(out, unit);
+         }
+         *out++ = '\n';
+     }
+ 
+     *out++ = '\n';
+     return out;
+ }
+ 
+ char* format_water_quality(char *out, const quality_result *result) {
+     out = format_text(out, "Water Quality Analysis:\n");
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         out = format_text(out, get_parameter_name(p));
+         out = format_text(out, ": ");
+         out = format_text(out, get_quality_category(result->level[p]));
+         *out++ = '\n';
+     }
+ 
+     out = format_text(out, "\nOVERALL WATER QUALITY: ");
+     out = format_text(out, get_quality_category(result->overall));
+     *out++ = '\n';
+ 
+     return format_alert_message(out, result->overall);
+ }
+ 
+ char* format_quality_changes(char *out, const char *when, const quality_result *previous,
+                              const quality_result *current, const float values[NUM_PARAMS],
+                              int *changes) {
+     *changes = 0;
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         if (previous && previous->level[p] == current->level[p]) continue;
+ 
+         const char *unit = get_parameter_unit(p);
+ 
+         out = format_text(out, when);
+         *out++ = ' ';
+         out = format_text(out, get_parameter_name(p));
+         out = format_text(out, ": ");
+         out = format_text(out, previous ? get_quality_category(previous->level[p]) : "-");
+         out = format_text(out, " -> ");
+         out = format_text(out, get_quality_category(current->level[p]));
+         out = format_text(out, " (");
+         out = format_fixed(out, values[p], 2);
+         if (*unit) {
+             *out++ = ' ';
+             out = format_text(out, unit);
+         }
+         out = format_text(out, ")\n");
+         (*changes)++;
+     }
+ 
+     if (!previous || previous->overall != current->overall) {
+         out = format_text(out, when);
+         out = format_text(out, " OVERALL WATER QUALITY: ");
+         out = format_text(out, get_quality_category(current->overall));
+         *out++ = '\n';
+         out = format_alert_message(out, current->overall);
+     }
+ 
+     return out;
+ }
+ 
+ // "about N min" until a predicted crossing
+ static char* format_minutes(char *out, float seconds) {
+     uint64_t minutes = (uint64_t)ceilf(seconds / 60.0f);
+ 
+     out = format_text(out, "about ");
+     out = format_uint(out, minutes > 0 ? minutes : 1);
+     return format_text(out, " min");
+ }
+ 
+ char* format_forecasts(char *out, const station_trends *trends) {
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         if (!(trends->warnings & (1u << p))) continue;
+ 
+         out = format_text(out, "⏳ FORECAST: ");
+         out = format_text(out, get_parameter_name(p));
+         out = format_text(out, " expected to reach ");
+         out = format_text(out, get_quality_category(trends->forecast[p].level));
+         out = format_text(out, " in ");
+         out = format_minutes(out, trends->forecast[p].seconds);
+         *out++ = '\n';
+     }
+     return out;
+ }
+ 
+ char* format_forecast_changes(char *out, const char *when, const station_trends *trends,
+                               uint32_t changed) {
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         if (!(changed & (1u << p))) continue;
+ 
+         out = format_text(out, when);
+         *out++ = ' ';
+         out = format_text(out, get_parameter_name(p));
+         if (trends->warnings & (1u << p)) {
+             out = format_text(out, ": forecast ");
+             out = format_text(out, get_quality_category(trends->forecast[p].level));
+             out = format_text(out, " in ");
+             out = format_minutes(out, trends->forecast[p].seconds);
+             *out++ = '\n';
+         } else {
+             out = format_text(out, ": forecast cleared\n");
+         }
+     }
+     return out;
+ }
+ 
+ // Right-aligns the text between start and end in width columns
+ static char* align_right(char *start, char *end, int width) {
+     int length = (int)(end - start);
+ 
+     if (length >= width) return end;
+ 
+     memmove(start + width - length, start, (size_t)length);
+     memset(start, ' ', (size_t)(width - length));
+     return start + width;
+ }
+ 
+ static char* format_column(char *out, float value, int width) {
+     *out++ = ' ';
+     return align_right(out, format_fixed(out, value, 2), width);
+ }
+ 
+ char* format_window_statistics(char *out, station_windows *windows, uint64_t now_ms) {
+     out = format_text(out, "\nWindow Statistics:\n");
+     out = format_text(out, "Parameter        Window   Count       Min       Max      Mean"
+                            "    StdDev       p50       p90       p99\n");
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         for (int w = 0; w < NUM_WINDOWS; w++) {
+             window_stats stats;
+             sliding_window_stats(&windows->window[p][w], now_ms, &stats);
+ 
+             // Parameter name on its first row only, left-aligned
+             char *start = out;
+             out = format_text(out, w == 0 ? get_parameter_name(p) : "");
+             while (out < start + 17) *out++ = ' ';
+ 
+             out = align_right(out, format_text(out, window_name(w)), 6);
+             *out++ = ' ';
+             out = align_right(out, format_uint(out, stats.count), 7);
+             out = format_column(out, stats.min, 9);
+             out = format_column(out, stats.max, 9);
+             out = format_column(out, stats.mean, 9);
+             out = format_column(out, stats.stddev, 9);
+             out = format_column(out, stats.p50, 9);
+             out = format_column(out, stats.p90, 9);
+             out = format_column(out, stats.p99, 9);
+             *out++ = '\n';
+         }
+     }
+ 
+     return out;
+ }
\ No newline at end of file
@@ -0,0 +1,99 @@
+/**
+ * Buffered Report Output
+ *
+ * Formats whole readings into a preallocated buffer without stdio
+ * (the host counterpart of the firmware's uart_print_* helpers) and hands
+ * a batch of records to the kernel in one writev() call. The text is
+ * byte-for-byte the layout of the printf-based reports in
+ * water_quality_analysis.c.
+ */
+
+ #ifndef WATER_QUALITY_OUTPUT_H
+ #define WATER_QUALITY_OUTPUT_H
+ 
+ #include <stddef.h>
+ #include <stdint.h>
+ #include <string.h>
+ #include <sys/uio.h>
+ #include "water_quality_config.h"
+ #include "water_quality_analysis.h"
+ #include "water_quality_window.h"
+ #include "water_quality_trend.h"
+ 
+ // Largest formatted record: the window statistics table has three rows
+ // of about 110 bytes per channel, the other records less
+ #define OUTPUT_CHANNEL_SIZE 1024
+ #define OUTPUT_RECORD_SIZE (2048 + NUM_PARAMS * OUTPUT_CHANNEL_SIZE)
+ #define OUTPUT_BUFFER_SIZE (8 * OUTPUT_RECORD_SIZE)     // Records are packed back to back
+ #define OUTPUT_BATCH 64             // Most records per writev()
+ 
+ typedef struct {
+     int fd;
+     int count;                      // Records waiting for the next flush
+     size_t used;                    // Bytes of buffer they take
+     char *buffer;                   // OUTPUT_BUFFER_SIZE bytes
+     struct iovec iov[OUTPUT_BATCH];
+     uint64_t cached_second;         // Last second formatted by output_time()
+     char cached_time[20];           // "YYYY-MM-DD HH:MM:SS" of cached_second
+ } output_stream;
+ 
+ // Returns -1 with errno set on failure
+ int output_init(output_stream *out, int fd);
+ 
+ // Flushes pending records and frees the buffer; the fd stays open
+ void output_destroy(output_stream *out);
+ 
+ // Start of the next record, with OUTPUT_RECORD_SIZE bytes of room
+ static inline char* output_record_begin(output_stream *out) {
+     return out->buffer + out->used;
+ }
+ 
+ // Queues the record formatted up to end; flushes when the batch or the
+ // buffer is full.
+ // Returns -1 with errno set if a flush failed.
+ int output_record_end(output_stream *out, char *end);
+ 
+ // Writes every queued record. Returns -1 with errno set on failure.
+ int output_flush(output_stream *out);
+ 
+ // Local time of timestamp_ms as "YYYY-MM-DD HH:MM:SS", only recomputed
+ // when the second changes
+ const char* output_time(output_stream *out, uint64_t timestamp_ms);
+ 
+ // Formatting helpers; each writes at out and returns the new end (no NUL)
+ 
+ static inline char* format_text(char *out, const char *text) {
+     size_t length = strlen(text);
+ 
+     memcpy(out, text, length);
+     return out + length;
+ }
+ 
+ // value with a fixed number of decimals (0-9), identical to printf("%.*f")
+ char* format_fixed(char *out, float value, int decimals);
+ char* format_uint(char *out, uint64_t value);
+ 
+ // Integer hundredths with two decimals ("-12.05"), as the firmware sends them
+ char* format_centi(char *out, int32_t centi);
+ 
+ // Same text as display_sensor_readings() and report_water_quality()
+ char* format_sensor_readings(char *out, const float values[NUM_PARAMS]);
+ char* format_water_quality(char *out, const quality_result *result);
+ 
+ // Same text as report_quality_changes() with when as the time prefix;
+ // *changes receives its return value
+ char* format_quality_changes(char *out, const char *when, const quality_result *previous,
+                              const quality_result *current, const float values[NUM_PARAMS],
+                              int *changes);
+ 
+ // Report lines of the active early warnings
+ char* format_forecasts(char *out, const station_trends *trends);
+ 
+ // Event lines of the early warnings whose bit is set in changed
+ char* format_forecast_changes(char *out, const char *when, const station_trends *trends,
+                               uint32_t changed);
+ 
+ // Table of every window of every parameter as of now_ms (slides the windows)
+ char* format_window_statistics(char *out, station_windows *windows, uint64_t now_ms);
+ 
+ #endif /* WATER_QUALITY_OUTPUT_H */
\ No newline at end of file
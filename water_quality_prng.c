@@ -0,0 +1,148 @@
+/**
+ * Pseudo-Random Number Generators
+ *
+ * The scalar and AVX2 lane kernels run the same recurrence on the same
+ * word-major state, so a buffer fill does not depend on the CPU.
+ */
+
+ #include <pthread.h>
+ #include <string.h>
+ #include "water_quality_prng.h"
+ 
+ #if defined(__x86_64__) || defined(__i386__)
+ #include <immintrin.h>
+ #define PRNG_X86 1
+ #endif
+ 
+ static uint64_t splitmix64(uint64_t *x) {
+     uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+     z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+     z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+     return z ^ (z >> 31);
+ }
+ 
+ void prng_seed(prng_state *rng, uint64_t seed) {
+     uint64_t a = splitmix64(&seed);
+     uint64_t b = splitmix64(&seed);
+ 
+     rng->s[0] = (uint32_t)a;
+     rng->s[1] = (uint32_t)(a >> 32);
+     rng->s[2] = (uint32_t)b;
+     rng->s[3] = (uint32_t)(b >> 32);
+ }
+ 
+ void prng_lanes_seed(prng_lanes *lanes, uint64_t seed) {
+     for (int lane = 0; lane < PRNG_LANES; lane++) {
+         uint64_t a = splitmix64(&seed);
+         uint64_t b = splitmix64(&seed);
+ 
+         lanes->s[0][lane] = (uint32_t)a;
+         lanes->s[1][lane] = (uint32_t)(a >> 32);
+         lanes->s[2][lane] = (uint32_t)b;
+         lanes->s[3][lane] = (uint32_t)(b >> 32);
+     }
+ }
+ 
+ // Advances every lane once
+ static inline void lanes_next_scalar(prng_lanes *lanes, uint32_t out[PRNG_LANES]) {
+     for (int lane = 0; lane < PRNG_LANES; lane++) {
+         prng_state rng = { { lanes->s[0][lane], lanes->s[1][lane],
+                              lanes->s[2][lane], lanes->s[3][lane] } };
+         out[lane] = prng_next(&rng);
+         for (int w = 0; w < 4; w++) lanes->s[w][lane] = rng.s[w];
+     }
+ }
+ 
+ // Eight normals per step: lane i combines its two successive outputs
+ static size_t fill_normal_scalar(prng_lanes *lanes, float *out, size_t n) {
+     size_t i = 0;
+ 
+     for (; i + PRNG_LANES <= n; i += PRNG_LANES) {
+         uint32_t a[PRNG_LANES];
+         uint32_t b[PRNG_LANES];
+         lanes_next_scalar(lanes, a);
+         lanes_next_scalar(lanes, b);
+         for (int lane = 0; lane < PRNG_LANES; lane++) {
+             out[i + lane] = prng_normal_from(a[lane], b[lane]);
+         }
+     }
+ 
+     return i;
+ }
+ 
+ #ifdef PRNG_X86
+ 
+ __attribute__((target("avx2")))
+ static inline __m256i rotl_avx2(__m256i x, int k) {
+     return _mm256_or_si256(_mm256_slli_epi32(x, k), _mm256_srli_epi32(x, 32 - k));
+ }
+ 
+ __attribute__((target("avx2")))
+ static inline __m256i next_avx2(__m256i s[4]) {
+     // rotl(s1 * 5, 7) * 9 with shifts and adds
+     __m256i x = _mm256_add_epi32(s[1], _mm256_slli_epi32(s[1], 2));
+     x = rotl_avx2(x, 7);
+     __m256i result = _mm256_add_epi32(x, _mm256_slli_epi32(x, 3));
+     __m256i t = _mm256_slli_epi32(s[1], 9);
+ 
+     s[2] = _mm256_xor_si256(s[2], s[0]);
+     s[3] = _mm256_xor_si256(s[3], s[1]);
+     s[1] = _mm256_xor_si256(s[1], s[2]);
+     s[0] = _mm256_xor_si256(s[0], s[3]);
+     s[2] = _mm256_xor_si256(s[2], t);
+     s[3] = rotl_avx2(s[3], 11);
+ 
+     return result;
+ }
+ 
+ __attribute__((target("avx2")))
+ static size_t fill_normal_avx2(prng_lanes *lanes, float *out, size_t n) {
+     const __m256i low = _mm256_set1_epi32(0xFFFF);
+     const __m256i mean = _mm256_set1_epi32(131070);
+     const __m256 scale = _mm256_set1_ps(1.7320508f / 65536.0f);
+     __m256i s[4];
+     size_t i = 0;
+ 
+     for (int w = 0; w < 4; w++) s[w] = _mm256_load_si256((const __m256i *)lanes->s[w]);
+ 
+     for (; i + PRNG_LANES <= n; i += PRNG_LANES) {
+         __m256i a = next_avx2(s);
+         __m256i b = next_avx2(s);
+         __m256i sum = _mm256_add_epi32(
+             _mm256_add_epi32(_mm256_and_si256(a, low), _mm256_srli_epi32(a, 16)),
+             _mm256_add_epi32(_mm256_and_si256(b, low), _mm256_srli_epi32(b, 16)));
+         sum = _mm256_sub_epi32(sum, mean);
+         _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(sum), scale));
+     }
+ 
+     for (int w = 0; w < 4; w++) _mm256_store_si256((__m256i *)lanes->s[w], s[w]);
+     return i;
+ }
+ 
+ // Resolved once; the load generator's workers fill concurrently
+ static pthread_once_t use_avx2_once = PTHREAD_ONCE_INIT;
+ static int use_avx2;
+ 
+ static void resolve_use_avx2(void) {
+     use_avx2 = __builtin_cpu_supports("avx2");
+ }
+ 
+ #endif /* PRNG_X86 */
+ 
+ void prng_fill_normal(prng_lanes *lanes, float *out, size_t n) {
+     size_t done;
+ 
+ #ifdef PRNG_X86
+     pthread_once(&use_avx2_once, resolve_use_avx2);
+     done = use_avx2 ? fill_normal_avx2(lanes, out, n) : fill_normal_scalar(lanes, out, n);
+ #else
+     done = fill_normal_scalar(lanes, out, n);
+ #endif
+ 
+     // Partial last step: the unused lanes' values are dropped
+     if (done < n) {
+         float tail[PRNG_LANES];
+         fill_normal_scalar(lanes, tail, PRNG_LANES);
+         memcpy(out + done, tail, (n - done) * sizeof(float));
+     }
+ }
\ No newline at end of file
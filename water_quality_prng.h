@@ -0,0 +1,70 @@
+/**
+ * Pseudo-Random Number Generators
+ *
+ * xoshiro128** (Blackman and Vigna) for per-station streams, plus an
+ * eight-lane variant that fills whole buffers with SIMD. Each generator
+ * is plain caller-owned state, so threads never share a hidden seed and
+ * the same seed always reproduces the same sequence.
+ */
+
+ #ifndef WATER_QUALITY_PRNG_H
+ #define WATER_QUALITY_PRNG_H
+ 
+ #include <stddef.h>
+ #include <stdint.h>
+ 
+ #define PRNG_LANES 8
+ 
+ typedef struct {
+     uint32_t s[4];
+ } prng_state;
+ 
+ // PRNG_LANES independent xoshiro128** streams, stored word-major for SIMD
+ typedef struct {
+     uint32_t s[4][PRNG_LANES];
+ } __attribute__((aligned(32))) prng_lanes;
+ 
+ void prng_seed(prng_state *rng, uint64_t seed);
+ void prng_lanes_seed(prng_lanes *lanes, uint64_t seed);
+ 
+ static inline uint32_t prng_rotl(uint32_t x, int k) {
+     return (x << k) | (x >> (32 - k));
+ }
+ 
+ static inline uint32_t prng_next(prng_state *rng) {
+     uint32_t *s = rng->s;
+     uint32_t result = prng_rotl(s[1] * 5, 7) * 9;
+     uint32_t t = s[1] << 9;
+ 
+     s[2] ^= s[0];
+     s[3] ^= s[1];
+     s[1] ^= s[2];
+     s[0] ^= s[3];
+     s[2] ^= t;
+     s[3] = prng_rotl(s[3], 11);
+ 
+     return result;
+ }
+ 
+ // Uniform in [0, 1)
+ static inline float prng_uniform(prng_state *rng) {
+     return (prng_next(rng) >> 8) * (1.0f / 16777216.0f);
+ }
+ 
+ // Approximately standard normal: sum of four 16-bit uniforms (Irwin-Hall),
+ // bounded at +/-3.46. Matches prng_fill_normal() bit for bit.
+ static inline float prng_normal_from(uint32_t a, uint32_t b) {
+     int32_t sum = (int32_t)((a & 0xFFFF) + (a >> 16) + (b & 0xFFFF) + (b >> 16)) - 131070;
+     return (float)sum * (1.7320508f / 65536.0f);
+ }
+ 
+ static inline float prng_normal(prng_state *rng) {
+     uint32_t a = prng_next(rng);
+     uint32_t b = prng_next(rng);
+     return prng_normal_from(a, b);
+ }
+ 
+ // Fills out[0..n) with approximately standard normal values
+ void prng_fill_normal(prng_lanes *lanes, float *out, size_t n);
+ 
+ #endif /* WATER_QUALITY_PRNG_H */
\ No newline at end of file
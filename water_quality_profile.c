@@ -0,0 +1,170 @@
+/**
+ * Threshold Profiles
+ *
+ * The whole file is checked on every load, not only the selected
+ * profile, so a typo anywhere is reported before a reload is accepted.
+ * Bands are validated the way the classifier relies on them: each band
+ * is non-empty and the good band lies inside the alert band.
+ */
+
+ #define _POSIX_C_SOURCE 200809L
+ 
+ #include <errno.h>
+ #include <math.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include "water_quality_profile.h"
+ #include "water_quality_analysis.h"
+ 
+ #define PROFILE_LINE_MAX 256
+ 
+ static int parameter_index(const char *key) {
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         if (strcmp(key, get_parameter_key(p)) == 0) return p;
+     }
+     return -1;
+ }
+ 
+ // Parses one threshold, "-" meaning the open side (open)
+ static int parse_threshold(const char *token, double open, double *value) {
+     char *end;
+ 
+     if (strcmp(token, "-") == 0) {
+         *value = open;
+         return 0;
+     }
+ 
+     *value = strtod(token, &end);
+     return end != token && *end == '\0' && isfinite(*value) ? 0 : -1;
+ }
+ 
+ // Parses "parameter good_min good_max alert_min alert_max"
+ static int parse_thresholds(char *line, int *param, double band[4]) {
+     static const char *const separators = " \t\r\n";
+     char *save;
+     char *token = strtok_r(line, separators, &save);
+ 
+     *param = parameter_index(token);
+     if (*param < 0) return -1;
+ 
+     for (int i = 0; i < 4; i++) {
+         token = strtok_r(NULL, separators, &save);
+         if (!token || parse_threshold(token, i % 2 ? INFINITY : -INFINITY, &band[i]) < 0) return -1;
+     }
+     if (strtok_r(NULL, separators, &save)) return -1;
+ 
+     // good_min, good_max, alert_min, alert_max
+     if (band[0] > band[1] || band[2] > band[3]) return -1;
+     if (band[0] < band[2] || band[1] > band[3]) return -1;
+     return 0;
+ }
+ 
+ // Section name of a "[name]" line, or NULL when the line is not one
+ static char* section_name(char *line) {
+     char *close = strchr(line, ']');
+ 
+     if (line[0] != '[' || !close || close == line + 1 || close - line - 1 >= PROFILE_NAME_MAX) {
+         return NULL;
+     }
+     if (close[1 + strspn(close + 1, " \t\r\n")] != '\0') return NULL;
+ 
+     *close = '\0';
+     return line + 1;
+ }
+ 
+ int profile_load(const char *path, const char *name, threshold_profile *profile, int *error_line) {
+     char line[PROFILE_LINE_MAX];
+     int line_number = 0;
+     int selected = 0;
+     int found = 0;
+ 
+     *error_line = 0;
+ 
+     FILE *file = fopen(path, "r");
+     if (!file) return -1;
+ 
+     quality_table_init_default(&profile->table);
+ 
+     while (fgets(line, sizeof(line), file)) {
+         char *text = line + strspn(line, " \t");
+ 
+         line_number++;
+ 
+         // Over-long lines are malformed rather than silently split
+         if (!strchr(line, '\n') && !feof(file)) goto malformed;
+ 
+         char *comment = strchr(text, '#');
+         if (comment) *comment = '\0';
+         if (text[strspn(text, " \t\r\n")] == '\0') continue;
+ 
+         if (text[0] == '[') {
+             char *section = section_name(text);
+             if (!section) goto malformed;
+ 
+             // The first matching section wins
+             selected = !found && (!name || strcmp(section, name) == 0);
+             if (selected) {
+                 found = 1;
+                 strcpy(profile->name, section);
+             }
+             continue;
+         }
+ 
+         int param;
+         double band[4];
+         if (parse_thresholds(text, &param, band) < 0) goto malformed;
+ 
+         // Lines outside the selected section are only checked
+         if (selected) {
+             quality_bounds_init(&profile->table.param[param], band[0], band[1], band[2], band[3]);
+         }
+     }
+ 
+     if (ferror(file)) {
+         int saved = errno;
+         fclose(file);
+         errno = saved ? saved : EIO;
+         return -1;
+     }
+     fclose(file);
+ 
+     if (!found) {
+         errno = EINVAL;
+         return -1;
+     }
+     return 0;
+ 
+ malformed:
+     fclose(file);
+     *error_line = line_number;
+     errno = EINVAL;
+     return -1;
+ }
+ 
+ threshold_profile* profile_create(const char *path, const char *name, int *error_line) {
+     void *memory;
+ 
+     *error_line = 0;
+ 
+     if (posix_memalign(&memory, PROFILE_ALIGNMENT, sizeof(threshold_profile)) != 0) {
+         errno = ENOMEM;
+         return NULL;
+     }
+ 
+     threshold_profile *profile = memory;
+ 
+     if (!path) {
+         quality_table_init_default(&profile->table);
+         strcpy(profile->name, "default");
+         return profile;
+     }
+ 
+     if (profile_load(path, name, profile, error_line) < 0) {
+         int saved = errno;
+         free(profile);
+         errno = saved;
+         return NULL;
+     }
+     return profile;
+ }
\ No newline at end of file
@@ -0,0 +1,48 @@
+/**
+ * Threshold Profiles
+ *
+ * Named sets of quality thresholds (drinking water, aquaculture,
+ * wastewater, ...) read from a profile file at startup instead of the
+ * compiled-in *_GOOD / *_ALERT defaults. A profile is compiled into the
+ * same flat quality_table the classifier uses, in its own cache-aligned
+ * allocation, so it can be published to the classification loop through
+ * one pointer and replaced while the loop runs.
+ *
+ * Profile file format ('#' starts a comment):
+ *
+ *     [aquaculture]
+ *     # parameter      good_min good_max alert_min alert_max
+ *     ph               6.5      9.0      6.0       9.5
+ *     turbidity        -        25       -         50
+ *
+ * "-" leaves a side of the band open. Parameters a profile does not list
+ * keep the thresholds from water_quality_config.h.
+ */
+
+ #ifndef WATER_QUALITY_PROFILE_H
+ #define WATER_QUALITY_PROFILE_H
+ 
+ #include "water_quality_config.h"
+ #include "water_quality_classify.h"
+ 
+ #define PROFILE_NAME_MAX 32
+ #define PROFILE_ALIGNMENT 64        // Cache line
+ 
+ typedef struct {
+     quality_table table;            // First, so it starts on a cache line
+     char name[PROFILE_NAME_MAX];
+ } threshold_profile;
+ 
+ // Fills profile with the thresholds of the named profile (the first one in
+ // the file when name is NULL). Returns -1 with errno set on failure:
+ // EINVAL with *error_line set for a malformed line, EINVAL with
+ // *error_line 0 when the file has no such profile, or the error of
+ // opening or reading path.
+ int profile_load(const char *path, const char *name, threshold_profile *profile, int *error_line);
+ 
+ // Allocates a cache-aligned profile: loaded from path when path is not
+ // NULL (see profile_load()), otherwise "default" with the compiled-in
+ // thresholds. Release it with free().
+ threshold_profile* profile_create(const char *path, const char *name, int *error_line);
+ 
+ #endif /* WATER_QUALITY_PROFILE_H */
\ No newline at end of file
@@ -0,0 +1,120 @@
+# Firmware RAM Budget Check
+#
+# Reads, concatenated on stdin, `avr-size -A` of the firmware, the .su
+# files avr-gcc writes with -fstack-usage, and `avr-objdump -d` of the
+# firmware. Prints .data, .bss and the deepest stack: main's call chain
+# plus the deepest interrupt handler (handlers do not nest), each call
+# adding call_bytes for its return address. Exits with status 1 when the
+# total is over budget.
+#
+# Functions without a .su entry (avr-libc, libgcc) count as 0 bytes and
+# are listed; indirect calls cannot be followed and are reported.
+#
+# Usage: { avr-size -A fw.elf; cat *.su; avr-objdump -d fw.elf; } |
+#        awk -v budget=1792 -v call_bytes=2 -f water_quality_ram_check.awk
+
+# Section sizes
+/^\.data[ \t]/   { data = $2 }
+/^\.bss[ \t]/    { bss = $2 }
+/^\.noinit[ \t]/ { noinit = $2 }
+
+# file.c:line:column:function <tab> bytes <tab> static|dynamic[,bounded]
+/\t[0-9]+\t(static|dynamic)/ {
+    split($0, field, "\t")
+    name = field[1]
+    sub(/.*:/, "", name)
+    if (!(name in frame) || field[2] + 0 > frame[name]) frame[name] = field[2] + 0
+    if (field[3] == "dynamic") unbounded[name] = 1
+    next
+}
+
+# Disassembly: "00000a6 <main>:" starts a function
+/^[0-9a-f]+ <[^>]+>:$/ {
+    current = $2
+    gsub(/[<>:]/, "", current)
+    next
+}
+
+# Instruction lines: "  a6:  0e 94 5b 00  call 0xb6 ; 0xb6 <read_sensors>"
+current != "" && /^ +[0-9a-f]+:\t/ {
+    split($0, field, "\t")
+    mnemonic = field[3]
+    sub(/[ \t].*/, "", mnemonic)
+
+    if (mnemonic == "icall" || mnemonic == "eicall" || mnemonic == "ijmp" || mnemonic == "eijmp") {
+        indirect[current] = 1
+        next
+    }
+    if (mnemonic != "call" && mnemonic != "rcall" && mnemonic != "jmp" && mnemonic != "rjmp") next
+    if (!match($0, /<[^>+]+>$/)) next     # Jumps inside a function carry +offset
+
+    target = substr($0, RSTART + 1, RLENGTH - 2)
+    if (target == current) next
+    # A jump to another function is a tail call: no return address
+    edge[current] = edge[current] " " target (mnemonic ~ /call$/ ? ":c" : ":j")
+}
+
+# Deepest stack from f down, in bytes
+function depth(f,    calls, n, i, target, bytes, best) {
+    if (f in memo) return memo[f]
+    if (f in visiting) {
+        recursive = recursive " " f
+        return 0
+    }
+    visiting[f] = 1
+    if (!(f in frame)) uncounted[f] = 1
+    if (f in indirect) indirect_seen = indirect_seen " " f
+
+    best = 0
+    n = split(edge[f], calls, " ")
+    for (i = 1; i <= n; i++) {
+        target = calls[i]
+        sub(/:[cj]$/, "", target)
+        bytes = depth(target) + (calls[i] ~ /:c$/ ? call_bytes : 0)
+        if (bytes > best) best = bytes
+    }
+
+    delete visiting[f]
+    memo[f] = frame[f] + best
+    return memo[f]
+}
+
+END {
+    if (call_bytes == "") call_bytes = 2
+
+    main_stack = depth("main")
+    for (f in frame) {
+        if (f ~ /^__vector_[0-9]+$/ && depth(f) + call_bytes > isr_stack) {
+            isr_stack = depth(f) + call_bytes
+            isr_name = f
+        }
+    }
+    for (f in edge) {
+        if (f ~ /^__vector_[0-9]+$/ && depth(f) + call_bytes > isr_stack) {
+            isr_stack = depth(f) + call_bytes
+            isr_name = f
+        }
+    }
+
+    static_bytes = data + bss + noinit
+    total = static_bytes + main_stack + isr_stack
+
+    printf "RAM: .data %d + .bss %d", data, bss
+    if (noinit) printf " + .noinit %d", noinit
+    printf " + stack %d (main %d, %s %d) = %d bytes", main_stack + isr_stack, main_stack,
+           isr_name ? isr_name : "no interrupts", isr_stack, total
+    if (budget) printf " of %d budget", budget
+    printf "\n"
+
+    list = ""
+    for (f in uncounted) if (f in edge || f in memo) list = list " " f
+    if (list != "") print "  not in the stack usage (counted as 0):" list
+    if (recursive != "") print "  recursion, depth not bounded:" recursive
+    if (indirect_seen != "") print "  indirect calls not followed:" indirect_seen
+    for (f in unbounded) if (f in memo) print "  dynamic stack allocation in " f
+
+    if (budget && total > budget) {
+        printf "RAM budget exceeded by %d bytes\n", total - budget
+        exit 1
+    }
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+/**
+ * Read-Copy-Update
+ *
+ * rcu_synchronize() starts a new epoch and waits until every online
+ * reader has announced it. A reader announcing epoch e has finished
+ * every use that started before the writer's increment to e, so it can
+ * only see pointers published before that. The fences on both sides
+ * (writer: publish, fence, scan; reader: announce, fence, load) make sure
+ * a reader coming online either is seen by the scan or sees the new
+ * pointer.
+ */
+
+ #define _POSIX_C_SOURCE 200809L
+ 
+ #include <time.h>
+ #include "water_quality_rcu.h"
+ 
+ void rcu_init(rcu_domain *domain) {
+     domain->epoch = 0;
+     domain->reader_count = 0;
+     pthread_mutex_init(&domain->lock, NULL);
+     for (int i = 0; i < RCU_MAX_READERS; i++) domain->readers[i].seen = RCU_OFFLINE;
+ }
+ 
+ void rcu_destroy(rcu_domain *domain) {
+     pthread_mutex_destroy(&domain->lock);
+ }
+ 
+ rcu_reader* rcu_register(rcu_domain *domain) {
+     rcu_reader *reader = NULL;
+ 
+     pthread_mutex_lock(&domain->lock);
+     if (domain->reader_count < RCU_MAX_READERS) {
+         reader = &domain->readers[domain->reader_count];
+         __atomic_store_n(&domain->reader_count, domain->reader_count + 1, __ATOMIC_RELEASE);
+     }
+     pthread_mutex_unlock(&domain->lock);
+ 
+     if (reader) rcu_online(domain, reader);
+     return reader;
+ }
+ 
+ void rcu_synchronize(rcu_domain *domain) {
+     struct timespec pause = { 0, 1000000 };
+ 
+     pthread_mutex_lock(&domain->lock);
+ 
+     uint64_t epoch = __atomic_add_fetch(&domain->epoch, 1, __ATOMIC_SEQ_CST);
+     __atomic_thread_fence(__ATOMIC_SEQ_CST);
+ 
+     for (int i = 0; i < domain->reader_count; i++) {
+         for (;;) {
+             uint64_t seen = __atomic_load_n(&domain->readers[i].seen, __ATOMIC_ACQUIRE);
+             if (seen == RCU_OFFLINE || seen >= epoch) break;
+ 
+             // Readers pass a quiescent point once per reading
+             nanosleep(&pause, NULL);
+         }
+     }
+ 
+     pthread_mutex_unlock(&domain->lock);
+ }
\ No newline at end of file
@@ -0,0 +1,60 @@
+/**
+ * Read-Copy-Update
+ *
+ * Quiescent-state-based RCU for data that is read on every sample and
+ * replaced rarely (threshold profiles). Readers load the shared pointer
+ * with __atomic_load_n(..., __ATOMIC_ACQUIRE) and never lock or wait; they
+ * only announce, between uses, that they hold no old pointer any more. A
+ * writer publishes the new version, calls rcu_synchronize() until every
+ * reader has passed such a point, and then frees the old version.
+ */
+
+ #ifndef WATER_QUALITY_RCU_H
+ #define WATER_QUALITY_RCU_H
+ 
+ #include <pthread.h>
+ #include <stdint.h>
+ 
+ #define RCU_MAX_READERS 16
+ #define RCU_OFFLINE UINT64_MAX      // Reader holds no pointer (e.g. blocked waiting for data)
+ 
+ typedef struct {
+     uint64_t seen __attribute__((aligned(64)));    // Last epoch the reader has seen, or RCU_OFFLINE
+ } rcu_reader;
+ 
+ typedef struct {
+     uint64_t epoch;
+     int reader_count;
+     pthread_mutex_t lock;           // Serializes writers and registration, never taken by readers
+     rcu_reader readers[RCU_MAX_READERS];
+ } rcu_domain;
+ 
+ void rcu_init(rcu_domain *domain);
+ void rcu_destroy(rcu_domain *domain);
+ 
+ // Slot of a new reader thread, initially online. NULL when all slots are taken.
+ rcu_reader* rcu_register(rcu_domain *domain);
+ 
+ // Reader: holds no protected pointer at this point (call between uses)
+ static inline void rcu_quiescent(rcu_domain *domain, rcu_reader *reader) {
+     __atomic_store_n(&reader->seen, __atomic_load_n(&domain->epoch, __ATOMIC_ACQUIRE),
+                      __ATOMIC_RELEASE);
+ }
+ 
+ // Reader: about to block; writers no longer wait for this reader
+ static inline void rcu_offline(rcu_reader *reader) {
+     __atomic_store_n(&reader->seen, RCU_OFFLINE, __ATOMIC_RELEASE);
+ }
+ 
+ // Reader: back from blocking; must come before loading protected pointers
+ static inline void rcu_online(rcu_domain *domain, rcu_reader *reader) {
+     __atomic_store_n(&reader->seen, __atomic_load_n(&domain->epoch, __ATOMIC_ACQUIRE),
+                      __ATOMIC_RELAXED);
+     __atomic_thread_fence(__ATOMIC_SEQ_CST);
+ }
+ 
+ // Writer: returns once no reader can still hold a pointer that was
+ // replaced before the call
+ void rcu_synchronize(rcu_domain *domain);
+ 
+ #endif /* WATER_QUALITY_RCU_H */
\ No newline at end of file
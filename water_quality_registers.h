@@ -0,0 +1,104 @@
+/**
+ * AVR Registers
+ *
+ * The firmware's peripheral drivers (ADC sampler, UART queue) include this
+ * instead of <avr/io.h>. On the AVR it is the real register file; on the
+ * host the registers are plain variables and water_quality_registers_host.c
+ * plays the peripheral's side, so the interrupt handlers run unchanged on
+ * Linux for checking and benchmarking.
+ */
+
+ #ifndef WATER_QUALITY_REGISTERS_H
+ #define WATER_QUALITY_REGISTERS_H
+ 
+ #include <stdint.h>
+ 
+ #ifdef __AVR__
+ 
+ #include <avr/io.h>
+ #include <avr/interrupt.h>
+ 
+ // Saves the interrupt flag and disables interrupts
+ static inline uint8_t interrupts_save(void) {
+     uint8_t sreg = SREG;
+     cli();
+     return sreg;
+ }
+ 
+ // Keeps the compiler from moving memory accesses out of the section
+ static inline void interrupts_restore(uint8_t sreg) {
+     __asm__ __volatile__("" ::: "memory");
+     SREG = sreg;
+ }
+ 
+ #else
+ 
+ // ADC (ATmega328P names and bit positions)
+ extern volatile uint8_t ADMUX;
+ extern volatile uint8_t ADCSRA;
+ extern volatile uint8_t ADCSRB;
+ extern volatile uint16_t ADC;
+ 
+ #define REFS0 6
+ #define ADEN  7
+ #define ADSC  6
+ #define ADATE 5
+ #define ADIF  4
+ #define ADIE  3
+ #define ADPS2 2
+ #define ADPS1 1
+ #define ADPS0 0
+ 
+ // USART0. UDR0 is wider on the host so that an empty data register
+ // (HOST_UDR_EMPTY) can be told apart from any byte written to it.
+ extern volatile uint8_t UBRR0H;
+ extern volatile uint8_t UBRR0L;
+ extern volatile uint8_t UCSR0A;
+ extern volatile uint8_t UCSR0B;
+ extern volatile uint8_t UCSR0C;
+ extern volatile uint16_t UDR0;
+ 
+ #define HOST_UDR_EMPTY 0x100
+ 
+ #define UDRE0  5
+ #define UDRIE0 5
+ #define TXEN0  3
+ #define UCSZ01 2
+ #define UCSZ00 1
+ 
+ // The host runs handlers synchronously, so only the compiler needs fencing
+ static inline uint8_t interrupts_save(void) {
+     __asm__ __volatile__("" ::: "memory");
+     return 0;
+ }
+ 
+ static inline void interrupts_restore(uint8_t sreg) {
+     (void)sreg;
+     __asm__ __volatile__("" ::: "memory");
+ }
+ 
+ // Value the emulated converter reads on a mux channel (0..1023)
+ typedef uint16_t (*host_adc_signal)(uint8_t channel, void *context);
+ 
+ // Clears the registers and the emulated converter
+ void host_registers_reset(void);
+ 
+ // Completes one free-running conversion: its result lands in ADC and the
+ // next conversion starts on the channel ADMUX selects now, as the
+ // hardware latches it before the interrupt runs. Returns 1 when the
+ // ADC-complete interrupt is enabled and its handler should be called, 0
+ // when the converter is not running.
+ int host_adc_convert(host_adc_signal signal, void *context);
+ 
+ // 1 when the data-register-empty interrupt is enabled and due, so its
+ // handler should be called
+ int host_uart_udre_pending(void);
+ 
+ // Moves the byte in UDR0 to the (instant) shift register and on to sink,
+ // leaving the data register empty: one character time on the wire.
+ // Returns 0 when there was no byte to send.
+ int host_uart_shift(void (*sink)(uint8_t byte, void *context), void *context);
+ 
+ #endif /* __AVR__ */
+ 
+ #endif /* WATER_QUALITY_REGISTERS_H */
\ No newline at end of file
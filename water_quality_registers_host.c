@@ -0,0 +1,75 @@
+/**
+ * AVR Registers - Host Emulation
+ *
+ * Only the behaviour the drivers depend on is modelled: a conversion
+ * starts when ADSC is set, free-running mode (ADATE with ADTS = 0) starts
+ * the next one as each completes, and the mux is latched at the start of
+ * a conversion, so a write in the handler selects the channel of the
+ * conversion after the one already running. The USART transmitter has
+ * its one-byte data register and sends whatever is written to it.
+ */
+
+ #include "water_quality_registers.h"
+ 
+ volatile uint8_t ADMUX;
+ volatile uint8_t ADCSRA;
+ volatile uint8_t ADCSRB;
+ volatile uint16_t ADC;
+ 
+ volatile uint8_t UBRR0H;
+ volatile uint8_t UBRR0L;
+ volatile uint8_t UCSR0A;
+ volatile uint8_t UCSR0B;
+ volatile uint8_t UCSR0C;
+ volatile uint16_t UDR0;
+ 
+ static int adc_running;
+ static uint8_t adc_channel;         // Latched mux of the conversion in progress
+ 
+ void host_registers_reset(void) {
+     ADMUX = 0;
+     ADCSRA = 0;
+     ADCSRB = 0;
+     ADC = 0;
+     UBRR0H = 0;
+     UBRR0L = 0;
+     UCSR0A = (1 << UDRE0);
+     UCSR0B = 0;
+     UCSR0C = 0;
+     UDR0 = HOST_UDR_EMPTY;
+     adc_running = 0;
+     adc_channel = 0;
+ }
+ 
+ int host_adc_convert(host_adc_signal signal, void *context) {
+     if (!(ADCSRA & (1 << ADEN))) return 0;
+ 
+     if (!adc_running) {
+         if (!(ADCSRA & (1 << ADSC))) return 0;
+         adc_running = 1;
+         adc_channel = ADMUX & 0x0F;
+     }
+ 
+     ADC = signal(adc_channel, context) & 0x3FF;
+ 
+     if (ADCSRA & (1 << ADATE)) {
+         adc_channel = ADMUX & 0x0F;
+     } else {
+         adc_running = 0;
+         ADCSRA &= (uint8_t)~(1 << ADSC);
+     }
+ 
+     return (ADCSRA & (1 << ADIE)) != 0;
+ }
+ 
+ int host_uart_udre_pending(void) {
+     return (UCSR0B & (1 << TXEN0)) && (UCSR0B & (1 << UDRIE0)) && UDR0 == HOST_UDR_EMPTY;
+ }
+ 
+ int host_uart_shift(void (*sink)(uint8_t byte, void *context), void *context) {
+     if (UDR0 == HOST_UDR_EMPTY) return 0;
+ 
+     sink((uint8_t)UDR0, context);
+     UDR0 = HOST_UDR_EMPTY;
+     return 1;
+ }
\ No newline at end of file
@@ -0,0 +1,511 @@
+/**
+ * Water Quality Capture Replay
+ *
+ * The capture is mapped read-only and parsed straight out of the mapping
+ * into struct-of-arrays chunks, which are classified with classify_batch().
+ */
+
+ #define _POSIX_C_SOURCE 200809L
+ #define _DEFAULT_SOURCE
+ 
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <float.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <time.h>
+ #include <unistd.h>
+ #include "water_quality_replay.h"
+ #include "water_quality_analysis.h"
+ #include "water_quality_gorilla.h"
+ 
+ struct capture_writer {
+     FILE *file;
+     int compressed;
+     uint32_t count;                             // Readings in the open frame
+     gorilla_encoder encoders[NUM_PARAMS];
+     uint8_t streams[NUM_PARAMS][GORILLA_BUFFER_SIZE(REPLAY_CHUNK)];
+ };
+ 
+ // Powers of ten that are exact in a double
+ static const double exact_pow10[] = {
+     1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+     1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+ };
+ 
+ // Chunk buffers, reused for the whole replay
+ typedef struct {
+     uint64_t timestamp_ms[REPLAY_CHUNK];
+     float values[NUM_PARAMS][REPLAY_CHUNK];
+     uint8_t levels[NUM_PARAMS][REPLAY_CHUNK];
+     uint8_t overall[REPLAY_CHUNK];
+ } replay_buffers;
+ 
+ typedef struct {
+     const quality_table *thresholds;
+     replay_chunk_fn on_chunk;
+     void *context;
+     replay_stats *stats;
+     replay_buffers *buf;
+     int have_previous;
+     uint8_t previous_overall;
+ } replay_state;
+ 
+ static double elapsed_seconds(const struct timespec *start) {
+     struct timespec now;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+     return (double)(now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+ }
+ 
+ // Classifies the buffered readings and folds them into the statistics
+ static void flush_chunk(replay_state *state, size_t count) {
+     replay_buffers *buf = state->buf;
+     replay_stats *stats = state->stats;
+     replay_chunk chunk;
+ 
+     if (count == 0) return;
+ 
+     chunk.count = count;
+     chunk.timestamp_ms = buf->timestamp_ms;
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         chunk.readings.values[p] = buf->values[p];
+         chunk.quality.level[p] = buf->levels[p];
+     }
+     chunk.quality.overall = buf->overall;
+ 
+     classify_batch(state->thresholds, &chunk.readings, &chunk.quality, count);
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         for (size_t i = 0; i < count; i++) {
+             stats->level_counts[p][buf->levels[p][i]]++;
+         }
+     }
+ 
+     for (size_t i = 0; i < count; i++) {
+         uint8_t overall = buf->overall[i];
+         stats->overall_counts[overall]++;
+         if (state->have_previous && overall != state->previous_overall) stats->transitions++;
+         state->previous_overall = overall;
+         state->have_previous = 1;
+     }
+ 
+     if (stats->readings == 0) stats->first_timestamp_ms = buf->timestamp_ms[0];
+     stats->last_timestamp_ms = buf->timestamp_ms[count - 1];
+     stats->readings += count;
+ 
+     if (state->on_chunk) state->on_chunk(&chunk, state->context);
+ }
+ 
+ static int is_digit(char c) {
+     return (unsigned)(c - '0') < 10;
+ }
+ 
+ // Slow path for tokens the fast path cannot convert exactly (inf, nan,
+ // long mantissas, large exponents, rounding ties): copy and use strtof
+ static int parse_float_slow(const char *start, const char *end, const char **cursor, float *out) {
+     char token[64];
+     size_t len = 0;
+     char *stop;
+ 
+     while (start + len < end && start[len] != ',' && start[len] != '\n' && start[len] != '\r') {
+         if (len + 1 >= sizeof(token)) return -1;
+         token[len] = start[len];
+         len++;
+     }
+     token[len] = '\0';
+ 
+     *out = strtof(token, &stop);
+     if (stop == token || *stop != '\0') return -1;
+ 
+     *cursor = start + len;
+     return 0;
+ }
+ 
+ // Parses a decimal float in place. The result is identical to strtof():
+ // the fast path computes one correctly rounded double operation and only
+ // accepts it when narrowing to float cannot be affected by double rounding.
+ static int parse_float(const char **cursor, const char *end, float *out) {
+     const char *start = *cursor;
+     const char *p = start;
+     uint64_t mantissa = 0;
+     int exponent = 0;
+     int digits = 0;
+     int negative = 0;
+     int slow = 0;
+ 
+     if (p < end && (*p == '-' || *p == '+')) {
+         negative = (*p == '-');
+         p++;
+     }
+ 
+     for (; p < end && is_digit(*p); p++, digits++) {
+         if (mantissa < (1ULL << 53) / 10) mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+         else slow = 1;
+     }
+ 
+     if (p < end && *p == '.') {
+         for (p++; p < end && is_digit(*p); p++, digits++) {
+             if (mantissa < (1ULL << 53) / 10) {
+                 mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                 exponent--;
+             } else {
+                 slow = 1;
+             }
+         }
+     }
+ 
+     if (digits == 0) return parse_float_slow(start, end, cursor, out);
+ 
+     if (p < end && (*p == 'e' || *p == 'E')) {
+         int exp_negative = 0;
+         int exp_value = 0;
+ 
+         p++;
+         if (p < end && (*p == '-' || *p == '+')) {
+             exp_negative = (*p == '-');
+             p++;
+         }
+         if (p >= end || !is_digit(*p)) return -1;
+         for (; p < end && is_digit(*p); p++) {
+             if (exp_value < 10000) exp_value = exp_value * 10 + (*p - '0');
+         }
+         exponent += exp_negative ? -exp_value : exp_value;
+     }
+ 
+     if (slow || exponent < -22 || exponent > 22) return parse_float_slow(start, end, cursor, out);
+ 
+     double value = (double)mantissa;
+     value = exponent < 0 ? value / exact_pow10[-exponent] : value * exact_pow10[exponent];
+ 
+     if (value != 0.0) {
+         uint64_t bits;
+         uint32_t dropped;
+ 
+         if (value < FLT_MIN || value > FLT_MAX) return parse_float_slow(start, end, cursor, out);
+ 
+         // The 29 bits lost when narrowing: near a tie the exact decimal
+         // could round the other way, so let strtof decide
+         memcpy(&bits, &value, sizeof(bits));
+         dropped = (uint32_t)(bits & 0x1FFFFFFF);
+         if (dropped >= 0x0FFFFFFF && dropped <= 0x10000001) {
+             return parse_float_slow(start, end, cursor, out);
+         }
+     }
+ 
+     *out = negative ? -(float)value : (float)value;
+     *cursor = p;
+     return 0;
+ }
+ 
+ static int parse_timestamp(const char **cursor, const char *end, uint64_t *out) {
+     const char *p = *cursor;
+     uint64_t value = 0;
+ 
+     if (p >= end || !is_digit(*p)) return -1;
+     for (; p < end && is_digit(*p); p++) {
+         value = value * 10 + (uint64_t)(*p - '0');
+     }
+ 
+     *out = value;
+     *cursor = p;
+     return 0;
+ }
+ 
+ static const char* skip_blanks(const char *p, const char *end) {
+     while (p < end && (*p == ' ' || *p == '\t')) p++;
+     return p;
+ }
+ 
+ static const char* next_line(const char *p, const char *end) {
+     const char *newline = memchr(p, '\n', (size_t)(end - p));
+     return newline ? newline + 1 : end;
+ }
+ 
+ static void replay_csv(replay_state *state, const char *data, const char *end) {
+     replay_buffers *buf = state->buf;
+     const char *p = data;
+     size_t count = 0;
+ 
+     while (p < end) {
+         const char *cursor = skip_blanks(p, end);
+         int ok;
+ 
+         p = next_line(p, end);
+ 
+         // Blank lines, '#' comments and the header line
+         if (cursor >= p || !is_digit(*cursor)) continue;
+ 
+         ok = parse_timestamp(&cursor, p, &buf->timestamp_ms[count]) == 0;
+         for (int v = 0; ok && v < NUM_PARAMS; v++) {
+             cursor = skip_blanks(cursor, p);
+             if (cursor >= p || *cursor != ',') {
+                 ok = 0;
+                 break;
+             }
+             cursor = skip_blanks(cursor + 1, p);
+             ok = parse_float(&cursor, p, &buf->values[v][count]) == 0;
+         }
+ 
+         // Anything but trailing blanks means a malformed line
+         if (ok) {
+             cursor = skip_blanks(cursor, p);
+             ok = (cursor == p || *cursor == '\n' || *cursor == '\r');
+         }
+ 
+         if (!ok) {
+             state->stats->malformed++;
+             continue;
+         }
+ 
+         if (++count == REPLAY_CHUNK) {
+             flush_chunk(state, count);
+             count = 0;
+         }
+     }
+ 
+     flush_chunk(state, count);
+ }
+ 
+ static void replay_binary(replay_state *state, const char *data, size_t size) {
+     replay_buffers *buf = state->buf;
+     const capture_record *records = (const capture_record *)(data + CAPTURE_MAGIC_SIZE);
+     size_t total = (size - CAPTURE_MAGIC_SIZE) / sizeof(capture_record);
+ 
+     for (size_t base = 0; base < total; base += REPLAY_CHUNK) {
+         size_t count = total - base < REPLAY_CHUNK ? total - base : REPLAY_CHUNK;
+ 
+         // Transpose records into the struct-of-arrays chunk
+         for (size_t i = 0; i < count; i++) {
+             const capture_record *record = &records[base + i];
+             buf->timestamp_ms[i] = record->timestamp_ms;
+             for (int p = 0; p < NUM_PARAMS; p++) {
+                 buf->values[p][i] = record->values[p];
+             }
+         }
+ 
+         flush_chunk(state, count);
+     }
+ }
+ 
+ static void replay_compressed(replay_state *state, const char *data, size_t size) {
+     replay_buffers *buf = state->buf;
+     size_t offset = CAPTURE_MAGIC_SIZE;
+ 
+     while (size - offset >= sizeof(capture_frame_header)) {
+         capture_frame_header header;
+         const uint8_t *stream;
+         size_t frame_bytes = 0;
+ 
+         memcpy(&header, data + offset, sizeof(header));
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             frame_bytes += header.stream_bytes[p];
+         }
+         offset += sizeof(header);
+ 
+         // A truncated or corrupt frame ends the replay
+         if (header.count == 0 || header.count > REPLAY_CHUNK || frame_bytes > size - offset) break;
+ 
+         stream = (const uint8_t *)data + offset;
+         size_t decoded = header.count;
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             gorilla_decoder decoder;
+             uint64_t timestamp;
+             size_t i;
+ 
+             gorilla_decoder_init(&decoder, stream, header.stream_bytes[p], header.count);
+             for (i = 0; i < header.count; i++) {
+                 if (gorilla_decode(&decoder, &timestamp, &buf->values[p][i]) < 0) break;
+                 if (p == 0) buf->timestamp_ms[i] = timestamp;
+             }
+             if (i < decoded) decoded = i;
+             stream += header.stream_bytes[p];
+         }
+ 
+         flush_chunk(state, decoded);
+         if (decoded < header.count) {
+             state->stats->malformed += header.count - decoded;
+             break;
+         }
+         offset += frame_bytes;
+     }
+ }
+ 
+ int replay_capture(const char *path, const quality_table *thresholds,
+                    replay_chunk_fn on_chunk, void *context, replay_stats *stats) {
+     struct timespec start;
+     struct stat st;
+     replay_state state;
+     char *data = NULL;
+     int fd;
+ 
+     memset(stats, 0, sizeof(*stats));
+ 
+     fd = open(path, O_RDONLY);
+     if (fd < 0) return -1;
+ 
+     if (fstat(fd, &st) < 0) {
+         close(fd);
+         return -1;
+     }
+ 
+     if (st.st_size > 0) {
+         data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+         if (data == MAP_FAILED) {
+             close(fd);
+             return -1;
+         }
+         madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+     }
+     close(fd);
+ 
+     state.thresholds = thresholds;
+     state.on_chunk = on_chunk;
+     state.context = context;
+     state.stats = stats;
+     state.have_previous = 0;
+     state.previous_overall = QUALITY_GOOD;
+     state.buf = malloc(sizeof(replay_buffers));
+     if (!state.buf) {
+         if (data) munmap(data, (size_t)st.st_size);
+         errno = ENOMEM;
+         return -1;
+     }
+ 
+     clock_gettime(CLOCK_MONOTONIC, &start);
+ 
+     size_t size = (size_t)st.st_size;
+     if (size >= CAPTURE_MAGIC_SIZE && memcmp(data, CAPTURE_MAGIC, CAPTURE_MAGIC_SIZE) == 0) {
+         replay_binary(&state, data, size);
+     } else if (size >= CAPTURE_MAGIC_SIZE && memcmp(data, CAPTURE_Z_MAGIC, CAPTURE_MAGIC_SIZE) == 0) {
+         replay_compressed(&state, data, size);
+     } else if (size > 0) {
+         replay_csv(&state, data, data + size);
+     }
+ 
+     stats->seconds = elapsed_seconds(&start);
+     stats->bytes = size;
+ 
+     free(state.buf);
+     if (data) munmap(data, size);
+ 
+     return 0;
+ }
+ 
+ void replay_print_stats(const replay_stats *stats) {
+     double rate = stats->seconds > 0 ? stats->readings / stats->seconds : 0.0;
+     double mbps = stats->seconds > 0 ? stats->bytes / stats->seconds / 1e6 : 0.0;
+ 
+     printf("Replay Summary:\n");
+     printf("Readings: %llu (%llu malformed lines skipped)\n",
+            (unsigned long long)stats->readings, (unsigned long long)stats->malformed);
+     if (stats->readings > 0) {
+         printf("Time span: %.1f hours\n",
+                (stats->last_timestamp_ms - stats->first_timestamp_ms) / 3600000.0);
+     }
+     printf("Replay time: %.3f s (%.0f readings/sec, %.1f MB/s)\n", stats->seconds, rate, mbps);
+     printf("\n");
+ 
+     printf("%-18s %12s %12s %12s\n", "Parameter", "Good", "Alert", "Critical");
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         printf("%-18s %12llu %12llu %12llu\n", get_parameter_name(p),
+                (unsigned long long)stats->level_counts[p][QUALITY_GOOD],
+                (unsigned long long)stats->level_counts[p][QUALITY_ALERT],
+                (unsigned long long)stats->level_counts[p][QUALITY_CRITICAL]);
+     }
+     printf("%-18s %12llu %12llu %12llu\n", "OVERALL",
+            (unsigned long long)stats->overall_counts[QUALITY_GOOD],
+            (unsigned long long)stats->overall_counts[QUALITY_ALERT],
+            (unsigned long long)stats->overall_counts[QUALITY_CRITICAL]);
+     printf("\nOverall level changes: %llu\n", (unsigned long long)stats->transitions);
+ }
+ 
+ static void start_frame(capture_writer *capture) {
+     capture->count = 0;
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         gorilla_encoder_init(&capture->encoders[p], capture->streams[p],
+                              sizeof(capture->streams[p]));
+     }
+ }
+ 
+ capture_writer* capture_open(const char *path, int compressed) {
+     capture_writer *capture = malloc(sizeof(capture_writer));
+     const char *magic = compressed ? CAPTURE_Z_MAGIC : CAPTURE_MAGIC;
+ 
+     if (!capture) return NULL;
+ 
+     capture->compressed = compressed;
+     capture->file = fopen(path, "wb");
+     if (!capture->file) {
+         free(capture);
+         return NULL;
+     }
+ 
+     if (fwrite(magic, 1, CAPTURE_MAGIC_SIZE, capture->file) != CAPTURE_MAGIC_SIZE) {
+         fclose(capture->file);
+         free(capture);
+         return NULL;
+     }
+ 
+     start_frame(capture);
+     return capture;
+ }
+ 
+ // Writes the open frame of a compressed capture
+ static int write_frame(capture_writer *capture) {
+     capture_frame_header header;
+     int result = 0;
+ 
+     if (capture->count == 0) return 0;
+ 
+     memset(&header, 0, sizeof(header));
+     header.count = capture->count;
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         header.stream_bytes[p] = (uint32_t)gorilla_encoder_finish(&capture->encoders[p]);
+     }
+ 
+     if (fwrite(&header, sizeof(header), 1, capture->file) != 1) result = -1;
+     for (int p = 0; p < NUM_PARAMS && result == 0; p++) {
+         if (fwrite(capture->streams[p], 1, header.stream_bytes[p], capture->file) !=
+             header.stream_bytes[p]) {
+             result = -1;
+         }
+     }
+ 
+     start_frame(capture);
+     return result;
+ }
+ 
+ int capture_write(capture_writer *capture, uint64_t timestamp_ms, const float values[NUM_PARAMS]) {
+     if (capture->compressed) {
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             gorilla_encode(&capture->encoders[p], timestamp_ms, values[p]);
+         }
+         return ++capture->count == REPLAY_CHUNK ? write_frame(capture) : 0;
+     }
+ 
+     capture_record record;
+ 
+     record.timestamp_ms = timestamp_ms;
+     memcpy(record.values, values, sizeof(record.values));
+     record.reserved = 0;
+ 
+     return fwrite(&record, sizeof(record), 1, capture->file) == 1 ? 0 : -1;
+ }
+ 
+ int capture_flush(capture_writer *capture) {
+     // Compressed frames stay open until full so they compress well
+     return fflush(capture->file);
+ }
+ 
+ int capture_close(capture_writer *capture) {
+     int result = 0;
+ 
+     if (capture->compressed && write_frame(capture) < 0) result = -1;
+     if (fclose(capture->file) != 0) result = -1;
+ 
+     free(capture);
+     return result;
+ }
+ 
\ No newline at end of file
@@ -0,0 +1,82 @@
+/**
+ * Water Quality Capture Replay
+ *
+ * Streams recorded sensor captures through the batch classifier as fast
+ * as the CPU allows, so threshold changes can be backtested against
+ * months of field data. Captures are memory-mapped and parsed in place.
+ *
+ * Capture formats:
+ *   CSV        - "timestamp_ms,ph,temperature,turbidity,tds,dissolved_oxygen"
+ *                per line; '#' comments and a header line are skipped
+ *   Binary     - CAPTURE_MAGIC followed by capture_record entries
+ *   Compressed - CAPTURE_Z_MAGIC followed by frames of up to REPLAY_CHUNK
+ *                readings: a capture_frame_header, then one Gorilla stream
+ *                (timestamps and values) per parameter
+ */
+
+ #ifndef WATER_QUALITY_REPLAY_H
+ #define WATER_QUALITY_REPLAY_H
+ 
+ #include <stddef.h>
+ #include <stdint.h>
+ #include <stdio.h>
+ #include "water_quality_config.h"
+ #include "water_quality_classify.h"
+ 
+ #define CAPTURE_MAGIC      "WQCAP001"
+ #define CAPTURE_Z_MAGIC    "WQCAPZ01"
+ #define CAPTURE_MAGIC_SIZE 8
+ 
+ // Readings classified per batch call
+ #define REPLAY_CHUNK 4096
+ 
+ // On-disk binary capture record (32 bytes, host byte order)
+ typedef struct {
+     uint64_t timestamp_ms;
+     float values[NUM_PARAMS];
+     uint32_t reserved;
+ } capture_record;
+ 
+ typedef struct {
+     uint32_t count;                        // Readings in the frame
+     uint32_t stream_bytes[NUM_PARAMS];     // Size of each parameter's stream
+ } capture_frame_header;
+ 
+ typedef struct capture_writer capture_writer;
+ 
+ // One classified chunk of a replay, in struct-of-arrays form
+ typedef struct {
+     size_t count;
+     const uint64_t *timestamp_ms;
+     sensor_batch readings;
+     quality_batch quality;
+ } replay_chunk;
+ 
+ typedef void (*replay_chunk_fn)(const replay_chunk *chunk, void *context);
+ 
+ typedef struct {
+     uint64_t readings;
+     uint64_t malformed;                     // CSV lines that could not be parsed
+     uint64_t bytes;
+     uint64_t first_timestamp_ms;
+     uint64_t last_timestamp_ms;
+     uint64_t level_counts[NUM_PARAMS][3];   // Readings per parameter and level
+     uint64_t overall_counts[3];             // Readings per overall level
+     uint64_t transitions;                   // Changes of the overall level
+     double seconds;                         // Wall-clock replay time
+ } replay_stats;
+ 
+ // Replays a capture file. on_chunk (optional) sees every classified chunk.
+ // Returns 0 on success, -1 on error (errno is set).
+ int replay_capture(const char *path, const quality_table *thresholds,
+                    replay_chunk_fn on_chunk, void *context, replay_stats *stats);
+ 
+ void replay_print_stats(const replay_stats *stats);
+ 
+ // Binary capture writer; compressed captures are written a frame at a time
+ capture_writer* capture_open(const char *path, int compressed);
+ int capture_write(capture_writer *capture, uint64_t timestamp_ms, const float values[NUM_PARAMS]);
+ int capture_flush(capture_writer *capture);
+ int capture_close(capture_writer *capture);
+ 
+ #endif /* WATER_QUALITY_REPLAY_H */
\ No newline at end of file
@@ -0,0 +1,93 @@
+/**
+ * Reading Ring Buffer
+ *
+ * head and tail grow without wrapping and index the slots modulo the
+ * capacity. Each side keeps a cached copy of the other side's index and
+ * only reloads it (one shared cache line transfer) when the ring looks
+ * full or empty.
+ */
+
+ #define _POSIX_C_SOURCE 200809L
+ 
+ #include <errno.h>
+ #include <stdlib.h>
+ #include "water_quality_ring.h"
+ 
+ int reading_ring_init(reading_ring *ring, size_t capacity) {
+     size_t size = 1;
+ 
+     while (size < capacity) size <<= 1;
+ 
+     ring->head = 0;
+     ring->cached_tail = 0;
+     ring->overflows = 0;
+     ring->tail = 0;
+     ring->cached_head = 0;
+     ring->mask = size - 1;
+ 
+     if (posix_memalign((void **)&ring->slots, 64, size * sizeof(reading_record)) != 0) {
+         errno = ENOMEM;
+         return -1;
+     }
+ 
+     if (sem_init(&ring->available, 0, 0) < 0) {
+         free(ring->slots);
+         return -1;
+     }
+ 
+     return 0;
+ }
+ 
+ void reading_ring_destroy(reading_ring *ring) {
+     sem_destroy(&ring->available);
+     free(ring->slots);
+ }
+ 
+ int reading_ring_push(reading_ring *ring, const reading_record *record) {
+     size_t head = ring->head;
+ 
+     if (head - ring->cached_tail > ring->mask) {
+         ring->cached_tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+         if (head - ring->cached_tail > ring->mask) {
+             __atomic_store_n(&ring->overflows, ring->overflows + 1, __ATOMIC_RELAXED);
+             return -1;
+         }
+     }
+ 
+     ring->slots[head & ring->mask] = *record;
+     __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+     sem_post(&ring->available);
+     return 0;
+ }
+ 
+ int reading_ring_pop(reading_ring *ring, reading_record *record) {
+     size_t tail = ring->tail;
+ 
+     if (tail == ring->cached_head) {
+         ring->cached_head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+         if (tail == ring->cached_head) return 0;
+     }
+ 
+     *record = ring->slots[tail & ring->mask];
+     __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+     return 1;
+ }
+ 
+ int reading_ring_empty(reading_ring *ring) {
+     if (ring->tail != ring->cached_head) return 0;
+ 
+     ring->cached_head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+     return ring->tail == ring->cached_head;
+ }
+ 
+ void reading_ring_pop_wait(reading_ring *ring, reading_record *record) {
+     // The semaphore only wakes the consumer; the indices decide what is there
+     while (!reading_ring_pop(ring, record)) {
+         while (sem_wait(&ring->available) < 0 && errno == EINTR) {
+         }
+     }
+ }
+ 
+ uint64_t reading_ring_overflows(const reading_ring *ring) {
+     return __atomic_load_n(&ring->overflows, __ATOMIC_RELAXED);
+ }
\ No newline at end of file
@@ -0,0 +1,65 @@
+/**
+ * Reading Ring Buffer
+ *
+ * Lock-free single-producer/single-consumer queue of fixed-size reading
+ * records between the acquisition thread and the analysis/output thread.
+ * The producer never blocks: when the ring is full the new record is
+ * dropped and counted, so a slow consumer cannot delay sampling.
+ */
+
+ #ifndef WATER_QUALITY_RING_H
+ #define WATER_QUALITY_RING_H
+ 
+ #include <semaphore.h>
+ #include <stddef.h>
+ #include <stdint.h>
+ #include "water_quality_config.h"
+ 
+ // Record flags
+ #define READING_END 0x1     // Acquisition stopped; no more records follow
+ 
+ typedef struct {
+     uint64_t sequence;              // Counts every record produced, including dropped ones
+     uint64_t timestamp_ms;
+     float values[NUM_PARAMS];
+     uint32_t due;                   // Bit p set when parameter p was sampled for this record
+     uint32_t flags;
+     uint32_t missed[NUM_PARAMS];    // Sampling deadlines missed so far, per parameter
+ } reading_record;
+ 
+ typedef struct {
+     // Producer side
+     size_t head __attribute__((aligned(64)));
+     size_t cached_tail;             // Producer's last view of tail
+     uint64_t overflows;             // Records dropped because the ring was full
+ 
+     // Consumer side
+     size_t tail __attribute__((aligned(64)));
+     size_t cached_head;             // Consumer's last view of head
+ 
+     // Shared, read-only after init
+     reading_record *slots __attribute__((aligned(64)));
+     size_t mask;
+     sem_t available;                // Wakes a consumer blocked in reading_ring_pop_wait()
+ } reading_ring;
+ 
+ // capacity is rounded up to a power of two. Returns -1 with errno set.
+ int reading_ring_init(reading_ring *ring, size_t capacity);
+ void reading_ring_destroy(reading_ring *ring);
+ 
+ // Producer: returns 0, or -1 when the ring is full and the record was dropped
+ int reading_ring_push(reading_ring *ring, const reading_record *record);
+ 
+ // Consumer: returns 1 and the oldest record, or 0 when the ring is empty
+ int reading_ring_pop(reading_ring *ring, reading_record *record);
+ 
+ // Consumer: 1 when no record is waiting
+ int reading_ring_empty(reading_ring *ring);
+ 
+ // Consumer: blocks until a record is available
+ void reading_ring_pop_wait(reading_ring *ring, reading_record *record);
+ 
+ // Safe to call from either thread
+ uint64_t reading_ring_overflows(const reading_ring *ring);
+ 
+ #endif /* WATER_QUALITY_RING_H */
\ No newline at end of file
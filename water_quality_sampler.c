@@ -0,0 +1,105 @@
+/**
+ * Interrupt-Driven ADC Sampler
+ *
+ * In free-running mode the next conversion has already started (on the
+ * mux value latched at its start) when the completion interrupt runs, so
+ * a channel written to ADMUX in the handler is the one converted after
+ * that. The sampler therefore tracks two parameters: the one whose
+ * result is in ADC now and the one already selected for later. The
+ * first two conversions both read the first channel.
+ *
+ * The main loop reads ring slots with interrupts briefly disabled, since
+ * a 16-bit value is read in two instructions on the AVR.
+ */
+
+ #include <string.h>
+ #include "water_quality_registers.h"
+ #include "water_quality_sampler.h"
+ 
+ static void select_channel(uint8_t pin) {
+     ADMUX = (uint8_t)((ADMUX & 0xF0) | (pin & 0x0F));
+ }
+ 
+ void adc_sampler_start(adc_sampler *sampler, const uint8_t pins[NUM_PARAMS]) {
+     memset(sampler, 0, sizeof(*sampler));
+     memcpy(sampler->pins, pins, sizeof(sampler->pins));
+ 
+     // AVCC reference, first channel
+     ADMUX = (1 << REFS0);
+     select_channel(pins[0]);
+ 
+     // Free-running trigger source (ADTS = 0)
+     ADCSRB = 0;
+ 
+     // Enable, start, auto-trigger and interrupt; prescaler 128
+     ADCSRA = (1 << ADEN) | (1 << ADSC) | (1 << ADATE) | (1 << ADIE) |
+              (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0);
+ }
+ 
+ void adc_sampler_stop(void) {
+     ADCSRA = 0;
+ }
+ 
+ void adc_sampler_isr(adc_sampler *sampler) {
+     uint8_t param = sampler->converting;
+     uint16_t result = ADC;
+ 
+     // The conversion now running was selected on the previous interrupt
+     sampler->converting = sampler->selected;
+     sampler->selected = sampler->selected + 1 < NUM_PARAMS ? sampler->selected + 1 : 0;
+     select_channel(sampler->pins[sampler->selected]);
+ 
+     sampler->sum[param] += result;
+     if (++sampler->taken[param] < SAMPLER_OVERSAMPLES) return;
+ 
+     // Decimate: 4^n samples summed, shifted by n with rounding
+     sampler_ring *ring = &sampler->ring[param];
+     ring->value[ring->head] = (sampler->sum[param] + (1 << (ADC_OVERSAMPLE_BITS - 1))) >> ADC_OVERSAMPLE_BITS;
+     ring->head = (ring->head + 1) & (SAMPLER_RING_SIZE - 1);
+     if (ring->filled < SAMPLER_RING_SIZE) ring->filled++;
+ 
+     sampler->sum[param] = 0;
+     sampler->taken[param] = 0;
+ }
+ 
+ int adc_sampler_ready(const adc_sampler *sampler) {
+     for (uint8_t p = 0; p < NUM_PARAMS; p++) {
+         // Single bytes: read atomically
+         if (((volatile const sampler_ring *)&sampler->ring[p])->filled == 0) return 0;
+     }
+     return 1;
+ }
+ 
+ int adc_sampler_full(const adc_sampler *sampler) {
+     for (uint8_t p = 0; p < NUM_PARAMS; p++) {
+         if (((volatile const sampler_ring *)&sampler->ring[p])->filled < SAMPLER_RING_SIZE) return 0;
+     }
+     return 1;
+ }
+ 
+ uint16_t adc_sampler_latest(const adc_sampler *sampler, uint8_t param) {
+     const volatile sampler_ring *ring = &sampler->ring[param];
+ 
+     uint8_t sreg = interrupts_save();
+     uint16_t value = ring->value[(ring->head - 1) & (SAMPLER_RING_SIZE - 1)];
+     interrupts_restore(sreg);
+ 
+     return value;
+ }
+ 
+ uint16_t adc_sampler_mean(const adc_sampler *sampler, uint8_t param) {
+     const volatile sampler_ring *ring = &sampler->ring[param];
+     uint16_t values[SAMPLER_RING_SIZE];
+     uint16_t sum = 0;               // At most 8 * ADC_MAX
+ 
+     uint8_t sreg = interrupts_save();
+     uint8_t filled = ring->filled;
+     for (uint8_t i = 0; i < SAMPLER_RING_SIZE; i++) values[i] = ring->value[i];
+     interrupts_restore(sreg);
+ 
+     if (filled == 0) return 0;
+ 
+     // Slots not filled yet are still zero
+     for (uint8_t i = 0; i < SAMPLER_RING_SIZE; i++) sum += values[i];
+     return (sum + filled / 2) / filled;
+ }
\ No newline at end of file
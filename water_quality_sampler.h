@@ -0,0 +1,63 @@
+/**
+ * Interrupt-Driven ADC Sampler
+ *
+ * Runs the ADC in free-running mode and cycles through the sensor
+ * channels from the conversion-complete interrupt, so sampling never
+ * busy-waits. Each channel accumulates 4^ADC_OVERSAMPLE_BITS conversions
+ * and is decimated to one ADC_MAX-scale value (ADC_OVERSAMPLE_BITS more
+ * bits, with the noise averaged down) that goes into the channel's ring
+ * buffer. The main loop reads the rings at any time without waiting.
+ */
+
+ #ifndef WATER_QUALITY_SAMPLER_H
+ #define WATER_QUALITY_SAMPLER_H
+ 
+ #include <stdint.h>
+ #include "water_quality_config.h"
+ #include "water_quality_adc.h"
+ 
+ #define SAMPLER_RING_SIZE 8         // Decimated values kept per channel (power of two)
+ #define SAMPLER_OVERSAMPLES (1 << (2 * ADC_OVERSAMPLE_BITS))
+ 
+ // Written by the interrupt only
+ typedef struct {
+     uint16_t value[SAMPLER_RING_SIZE];
+     uint8_t head;                   // Slot of the next value
+     uint8_t filled;                 // Values stored so far, up to SAMPLER_RING_SIZE
+ } sampler_ring;
+ 
+ typedef struct {
+     uint8_t pins[NUM_PARAMS];       // ADC mux channel of each parameter
+     uint8_t converting;             // Parameter of the conversion in progress
+     uint8_t selected;               // Parameter ADMUX selects for the one after
+     uint8_t taken[NUM_PARAMS];      // Conversions accumulated towards the next value
+     uint16_t sum[NUM_PARAMS];
+     sampler_ring ring[NUM_PARAMS];
+ } adc_sampler;
+ 
+ // Sets up the sampler for the parameters' mux channels and starts the
+ // ADC (AVCC reference, 125 kHz ADC clock at 16 MHz, free-running with
+ // the completion interrupt). Interrupts must be enabled for it to run.
+ void adc_sampler_start(adc_sampler *sampler, const uint8_t pins[NUM_PARAMS]);
+ 
+ // Turns the ADC off (no current drawn in power-down); adc_sampler_start()
+ // runs it again with empty rings
+ void adc_sampler_stop(void);
+ 
+ // Body of ISR(ADC_vect)
+ void adc_sampler_isr(adc_sampler *sampler);
+ 
+ // 1 once every channel has at least one decimated value
+ int adc_sampler_ready(const adc_sampler *sampler);
+ 
+ // 1 once every channel's ring holds SAMPLER_RING_SIZE values, so
+ // adc_sampler_mean() averages a full ring (about 70 ms after the start)
+ int adc_sampler_full(const adc_sampler *sampler);
+ 
+ // Latest decimated value of a parameter (0 before the first)
+ uint16_t adc_sampler_latest(const adc_sampler *sampler, uint8_t param);
+ 
+ // Mean of the values in a parameter's ring (further low-pass filtering)
+ uint16_t adc_sampler_mean(const adc_sampler *sampler, uint8_t param);
+ 
+ #endif /* WATER_QUALITY_SAMPLER_H */
\ No newline at end of file
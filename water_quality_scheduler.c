@@ -0,0 +1,141 @@
+/**
+ * Sampling Scheduler
+ *
+ * Each channel is a timerfd armed with an absolute first expiration and
+ * an interval; epoll sleeps until any of them fires. Reading a timerfd
+ * returns the number of expirations since the last read, so every
+ * expiration beyond the first is a deadline that was missed.
+ */
+
+ #define _POSIX_C_SOURCE 200809L
+ 
+ #include <errno.h>
+ #include <stdlib.h>
+ #include <sys/epoll.h>
+ #include <sys/timerfd.h>
+ #include <time.h>
+ #include <unistd.h>
+ #include "water_quality_scheduler.h"
+ 
+ typedef struct {
+     int fd;
+     scheduler_channel_stats stats;
+ } timer_channel;
+ 
+ struct scheduler {
+     int epoll_fd;
+     int count;
+     timer_channel channels[SCHEDULER_MAX_CHANNELS];
+ };
+ 
+ scheduler* scheduler_create(const uint32_t period_ms[], int channels) {
+     scheduler *sched;
+     struct timespec start;
+ 
+     if (channels < 1 || channels > SCHEDULER_MAX_CHANNELS) {
+         errno = EINVAL;
+         return NULL;
+     }
+ 
+     sched = calloc(1, sizeof(scheduler));
+     if (!sched) return NULL;
+ 
+     sched->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+     if (sched->epoll_fd < 0) {
+         free(sched);
+         return NULL;
+     }
+ 
+     // Common anchor, so channels with related periods fire together
+     clock_gettime(CLOCK_MONOTONIC, &start);
+ 
+     for (int i = 0; i < channels; i++) {
+         timer_channel *ch = &sched->channels[i];
+         struct itimerspec spec;
+         struct epoll_event event;
+ 
+         if (period_ms[i] == 0) {
+             errno = EINVAL;
+             scheduler_destroy(sched);
+             return NULL;
+         }
+ 
+         ch->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+         if (ch->fd < 0) {
+             scheduler_destroy(sched);
+             return NULL;
+         }
+         sched->count = i + 1;
+         ch->stats.period_ms = period_ms[i];
+ 
+         spec.it_value = start;
+         spec.it_interval.tv_sec = period_ms[i] / 1000;
+         spec.it_interval.tv_nsec = (long)(period_ms[i] % 1000) * 1000000L;
+ 
+         event.events = EPOLLIN;
+         event.data.u32 = (uint32_t)i;
+ 
+         if (timerfd_settime(ch->fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0 ||
+             epoll_ctl(sched->epoll_fd, EPOLL_CTL_ADD, ch->fd, &event) < 0) {
+             scheduler_destroy(sched);
+             return NULL;
+         }
+     }
+ 
+     return sched;
+ }
+ 
+ void scheduler_destroy(scheduler *sched) {
+     for (int i = 0; i < sched->count; i++) {
+         close(sched->channels[i].fd);
+     }
+     close(sched->epoll_fd);
+     free(sched);
+ }
+ 
+ int scheduler_wait(scheduler *sched, uint32_t *due) {
+     struct epoll_event events[SCHEDULER_MAX_CHANNELS];
+ 
+     *due = 0;
+ 
+     while (*due == 0) {
+         if (epoll_wait(sched->epoll_fd, events, SCHEDULER_MAX_CHANNELS, -1) < 0) return -1;
+ 
+         // Collect every expired channel, not only the ones epoll reported,
+         // so channels sharing a deadline are served in one wake-up
+         for (int i = 0; i < sched->count; i++) {
+             timer_channel *ch = &sched->channels[i];
+             uint64_t expirations;
+ 
+             if (read(ch->fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+                 if (errno == EAGAIN) continue;
+                 return -1;
+             }
+ 
+             ch->stats.deadlines += expirations;
+             ch->stats.missed += expirations - 1;
+             *due |= (uint32_t)1 << i;
+         }
+     }
+ 
+     return 0;
+ }
+ 
+ uint32_t scheduler_next_delay_ms(const scheduler *sched) {
+     uint64_t next_ns = UINT64_MAX;
+ 
+     for (int i = 0; i < sched->count; i++) {
+         struct itimerspec spec;
+ 
+         if (timerfd_gettime(sched->channels[i].fd, &spec) < 0) continue;
+ 
+         uint64_t ns = (uint64_t)spec.it_value.tv_sec * 1000000000ULL + (uint64_t)spec.it_value.tv_nsec;
+         if (ns < next_ns) next_ns = ns;
+     }
+ 
+     return next_ns == UINT64_MAX ? 0 : (uint32_t)((next_ns + 999999) / 1000000);
+ }
+ 
+ void scheduler_get_stats(const scheduler *sched, int channel, scheduler_channel_stats *stats) {
+     *stats = sched->channels[channel].stats;
+ }
\ No newline at end of file
@@ -0,0 +1,39 @@
+/**
+ * Sampling Scheduler
+ *
+ * One periodic timer per sensor channel, all anchored to the same start
+ * time. Deadlines are absolute (timerfd with a fixed interval), so time
+ * spent processing a reading never shifts the next one; a consumer that
+ * falls behind is counted as missed deadlines instead.
+ */
+
+ #ifndef WATER_QUALITY_SCHEDULER_H
+ #define WATER_QUALITY_SCHEDULER_H
+ 
+ #include <stdint.h>
+ 
+ #define SCHEDULER_MAX_CHANNELS 32
+ 
+ typedef struct scheduler scheduler;
+ 
+ typedef struct {
+     uint32_t period_ms;
+     uint64_t deadlines;         // Deadlines passed since the start
+     uint64_t missed;            // Deadlines that passed before the previous one was served
+ } scheduler_channel_stats;
+ 
+ // Creates a scheduler whose channels are all due immediately and then every
+ // period_ms[i]. Returns NULL with errno set on failure.
+ scheduler* scheduler_create(const uint32_t period_ms[], int channels);
+ void scheduler_destroy(scheduler *sched);
+ 
+ // Blocks until at least one channel is due and sets bit i of *due for
+ // every due channel. Returns -1 with errno set (EINTR on a signal).
+ int scheduler_wait(scheduler *sched, uint32_t *due);
+ 
+ // Milliseconds until the next deadline of any channel
+ uint32_t scheduler_next_delay_ms(const scheduler *sched);
+ 
+ void scheduler_get_stats(const scheduler *sched, int channel, scheduler_channel_stats *stats);
+ 
+ #endif /* WATER_QUALITY_SCHEDULER_H */
\ No newline at end of file
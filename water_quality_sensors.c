@@ -0,0 +1,226 @@
+/**
+ * Water Quality Sensor Models
+ *
+ * Simulated sensors used by the simulator and the benchmarks in place of
+ * the ADC-backed sensors of the embedded build. Drift follows an
+ * Ornstein-Uhlenbeck process, updated exactly for any gap between
+ * readings: drift = drift * a + sigma * sqrt(1 - a^2) * N(0, 1) with
+ * a = exp(-dt / tau).
+ */
+
+ #include <math.h>
+ #include <string.h>
+ #include "water_quality_sensors.h"
+ 
+ #define DAY_MS 86400000.0
+ #define TWO_PI 6.283185307179586
+ 
+ #define SENSOR_BATCH 256                    // Readings per block of generated noise
+ #define SENSOR_BATCH_MIN 16                 // Smaller batches take the per-reading path
+ 
+ #define DO_SATURATION_FRACTION 0.9f         // Typical dissolved oxygen, relative to solubility
+ 
+ #define FAULT_INTERVAL_S (2.0 * 86400.0)    // Mean time between faults of one station
+ #define FAULT_MIN_S 600.0
+ #define FAULT_MAX_S 7200.0
+ 
+ typedef struct {
+     float tau_s;            // Drift correlation time
+     float sigma;            // Drift standard deviation
+     float noise;            // Measurement noise standard deviation
+     float fault_offset;     // Shift applied by an offset fault
+ } channel_model;
+ 
+ static const channel_model channels[NUM_PARAMS] = {
+     [PARAM_PH]               = { 21600.0f,  0.35f, 0.03f, -2.5f },
+     [PARAM_TEMPERATURE]      = { 172800.0f, 1.5f,  0.05f, 8.0f },
+     [PARAM_TURBIDITY]        = { 10800.0f,  0.6f,  0.05f, 25.0f },     // Drift of log(turbidity)
+     [PARAM_TDS]              = { 86400.0f,  40.0f, 2.0f,  400.0f },
+     [PARAM_DISSOLVED_OXYGEN] = { 43200.0f,  0.08f, 0.05f, -5.0f },     // Drift of the saturation fraction
+ };
+ 
+ // The physics below is written per channel: a new registry row needs its
+ // model here and in model_values()
+ _Static_assert(NUM_PARAMS == 5, "sensor models cover the five registry channels only");
+ 
+ // Oxygen solubility in fresh water at sea level (mg/L), valid for 0-40 °C
+ static inline float oxygen_saturation(float temperature) {
+     float t = temperature;
+     return 14.652f + t * (-0.41022f + t * (0.007991f - 0.000077774f * t));
+ }
+ 
+ // Phase of the diurnal cycle; the sine peaks mid-afternoon
+ static double day_angle(const sensor_station *station, uint64_t timestamp_ms) {
+     double day_fraction = (double)(timestamp_ms % 86400000ULL) / DAY_MS;
+     return TWO_PI * (day_fraction + station->temperature_phase - 0.375);
+ }
+ 
+ static uint64_t exponential_ms(prng_state *rng, double mean_s) {
+     return (uint64_t)(-mean_s * 1000.0 * log(1.0 - prng_uniform(rng)));
+ }
+ 
+ static inline void model_values(const sensor_station *station, const float drift[NUM_PARAMS],
+                                 float day_sine, const float noise[NUM_PARAMS],
+                                 float values[NUM_PARAMS]) {
+     float temperature = station->temperature_mean + drift[PARAM_TEMPERATURE] +
+                         station->temperature_amplitude * day_sine;
+     float saturation = DO_SATURATION_FRACTION + drift[PARAM_DISSOLVED_OXYGEN];
+ 
+     values[PARAM_PH] = station->ph_base + drift[PARAM_PH] +
+                        channels[PARAM_PH].noise * noise[PARAM_PH];
+     values[PARAM_TEMPERATURE] = temperature +
+                                 channels[PARAM_TEMPERATURE].noise * noise[PARAM_TEMPERATURE];
+     values[PARAM_TURBIDITY] = fmaxf(station->turbidity_base * expf(drift[PARAM_TURBIDITY]) +
+                                     channels[PARAM_TURBIDITY].noise * noise[PARAM_TURBIDITY], 0.0f);
+     values[PARAM_TDS] = fmaxf(station->tds_base + drift[PARAM_TDS] +
+                               channels[PARAM_TDS].noise * noise[PARAM_TDS], 0.0f);
+     // Warm water holds less oxygen, so DO falls as the temperature rises
+     values[PARAM_DISSOLVED_OXYGEN] = fmaxf(oxygen_saturation(temperature) * saturation +
+                                            channels[PARAM_DISSOLVED_OXYGEN].noise *
+                                            noise[PARAM_DISSOLVED_OXYGEN], 0.0f);
+ }
+ 
+ // Ends, starts and applies injected faults
+ static void apply_fault(sensor_station *station, uint64_t timestamp_ms, float values[NUM_PARAMS]) {
+     if (station->fault_kind != SENSOR_FAULT_NONE && timestamp_ms >= station->fault_end_ms) {
+         station->fault_kind = SENSOR_FAULT_NONE;
+         station->next_fault_ms = timestamp_ms + exponential_ms(&station->rng, FAULT_INTERVAL_S);
+     }
+ 
+     if (station->fault_kind == SENSOR_FAULT_NONE) {
+         if (timestamp_ms < station->next_fault_ms) return;
+ 
+         int p = (int)(prng_next(&station->rng) % NUM_PARAMS);
+         station->fault_param = (uint8_t)p;
+         station->fault_kind = (prng_next(&station->rng) & 1) ? SENSOR_FAULT_OFFSET : SENSOR_FAULT_STUCK;
+         station->fault_value = station->fault_kind == SENSOR_FAULT_OFFSET ?
+                                channels[p].fault_offset : values[p];
+         station->fault_end_ms = timestamp_ms + (uint64_t)(1000.0 *
+             (FAULT_MIN_S + (FAULT_MAX_S - FAULT_MIN_S) * prng_uniform(&station->rng)));
+     }
+ 
+     int p = station->fault_param;
+     if (station->fault_kind == SENSOR_FAULT_OFFSET) {
+         values[p] += station->fault_value;
+         if (p != PARAM_TEMPERATURE && values[p] < 0.0f) values[p] = 0.0f;
+     } else {
+         values[p] = station->fault_value;
+     }
+ }
+ 
+ void sensor_station_init(sensor_station *station, uint64_t seed) {
+     prng_state *rng = &station->rng;
+ 
+     memset(station, 0, sizeof(*station));
+     prng_seed(rng, seed);
+ 
+     station->ph_base = 7.0f + 0.8f * prng_uniform(rng);
+     station->temperature_mean = 14.0f + 8.0f * prng_uniform(rng);
+     station->temperature_amplitude = 1.5f + 2.5f * prng_uniform(rng);
+     station->temperature_phase = 0.1f * (prng_uniform(rng) - 0.5f);
+     station->turbidity_base = 0.5f + 1.5f * prng_uniform(rng);
+     station->tds_base = 150.0f + 150.0f * prng_uniform(rng);
+ 
+     // Start every drift in its long-run distribution
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         station->drift[p] = channels[p].sigma * prng_normal(rng);
+     }
+ 
+     station->fault_kind = SENSOR_FAULT_NONE;
+ }
+ 
+ void sensor_station_read(sensor_station *station, uint64_t timestamp_ms,
+                          float values[NUM_PARAMS]) {
+     float shocks[NUM_PARAMS];
+     float noise[NUM_PARAMS];
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         shocks[p] = prng_normal(&station->rng);
+         noise[p] = prng_normal(&station->rng);
+     }
+ 
+     if (station->last_ms == 0) {
+         station->next_fault_ms = timestamp_ms + exponential_ms(&station->rng, FAULT_INTERVAL_S);
+     } else if (timestamp_ms > station->last_ms) {
+         float dt_s = (float)(timestamp_ms - station->last_ms) / 1000.0f;
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             float a = expf(-dt_s / channels[p].tau_s);
+             station->drift[p] = station->drift[p] * a +
+                                 channels[p].sigma * sqrtf(1.0f - a * a) * shocks[p];
+         }
+     }
+ 
+     model_values(station, station->drift, (float)sin(day_angle(station, timestamp_ms)),
+                  noise, values);
+     apply_fault(station, timestamp_ms, values);
+     station->last_ms = timestamp_ms;
+ }
+ 
+ void sensor_station_read_batch(sensor_station *station, uint64_t first_ms, uint32_t period_ms,
+                                size_t count, float *values[NUM_PARAMS]) {
+     float reading[NUM_PARAMS];
+     float noise[SENSOR_BATCH * 2 * NUM_PARAMS];
+     float drift[NUM_PARAMS];
+     float decay[NUM_PARAMS];
+     float scale[NUM_PARAMS];
+     prng_lanes lanes;
+ 
+     if (count < SENSOR_BATCH_MIN) {
+         for (size_t i = 0; i < count; i++) {
+             sensor_station_read(station, first_ms + i * period_ms, reading);
+             for (int p = 0; p < NUM_PARAMS; p++) values[p][i] = reading[p];
+         }
+         return;
+     }
+ 
+     // The first reading may follow an arbitrary gap; the rest are period_ms apart
+     sensor_station_read(station, first_ms, reading);
+     for (int p = 0; p < NUM_PARAMS; p++) values[p][0] = reading[p];
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         decay[p] = expf(-(float)period_ms / 1000.0f / channels[p].tau_s);
+         scale[p] = channels[p].sigma * sqrtf(1.0f - decay[p] * decay[p]);
+         drift[p] = station->drift[p];
+     }
+ 
+     // Rotate the diurnal phasor instead of calling sin() per reading
+     double angle = day_angle(station, first_ms + period_ms);
+     double step = TWO_PI * period_ms / DAY_MS;
+     double sine = sin(angle);
+     double cosine = cos(angle);
+     double step_sine = sin(step);
+     double step_cosine = cos(step);
+ 
+     uint64_t lane_seed = ((uint64_t)prng_next(&station->rng) << 32) | prng_next(&station->rng);
+     prng_lanes_seed(&lanes, lane_seed);
+ 
+     for (size_t i = 1; i < count; ) {
+         size_t block = count - i < SENSOR_BATCH ? count - i : SENSOR_BATCH;
+ 
+         prng_fill_normal(&lanes, noise, block * 2 * NUM_PARAMS);
+ 
+         for (size_t j = 0; j < block; j++, i++) {
+             const float *shocks = noise + j * 2 * NUM_PARAMS;
+             uint64_t timestamp_ms = first_ms + i * period_ms;
+ 
+             for (int p = 0; p < NUM_PARAMS; p++) {
+                 drift[p] = drift[p] * decay[p] + scale[p] * shocks[p];
+             }
+ 
+             model_values(station, drift, (float)sine, shocks + NUM_PARAMS, reading);
+             if (station->fault_kind != SENSOR_FAULT_NONE || timestamp_ms >= station->next_fault_ms) {
+                 apply_fault(station, timestamp_ms, reading);
+             }
+ 
+             for (int p = 0; p < NUM_PARAMS; p++) values[p][i] = reading[p];
+ 
+             double next_sine = sine * step_cosine + cosine * step_sine;
+             cosine = cosine * step_cosine - sine * step_sine;
+             sine = next_sine;
+         }
+     }
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) station->drift[p] = drift[p];
+     station->last_ms = first_ms + (count - 1) * period_ms;
+ }
+ 
\ No newline at end of file
@@ -0,0 +1,59 @@
+/**
+ * Water Quality Sensor Models
+ *
+ * Simulated stations with time-correlated readings: slow mean-reverting
+ * drift on every parameter, a diurnal temperature cycle, dissolved oxygen
+ * that follows the oxygen solubility of the current temperature, and
+ * occasional injected sensor faults. Each station owns its generator, so
+ * the same seed always reproduces the same readings.
+ */
+
+ #ifndef WATER_QUALITY_SENSORS_H
+ #define WATER_QUALITY_SENSORS_H
+ 
+ #include <stddef.h>
+ #include <stdint.h>
+ #include "water_quality_config.h"
+ #include "water_quality_prng.h"
+ 
+ // Injected fault kinds
+ #define SENSOR_FAULT_NONE   0
+ #define SENSOR_FAULT_OFFSET 1   // Reading shifted by a fixed amount
+ #define SENSOR_FAULT_STUCK  2   // Reading frozen at its last value
+ 
+ typedef struct {
+     prng_state rng;
+     uint64_t last_ms;               // Time of the previous reading, 0 before the first
+ 
+     // Per-station baselines
+     float ph_base;
+     float temperature_mean;
+     float temperature_amplitude;
+     float temperature_phase;        // Fraction of a day
+     float turbidity_base;
+     float tds_base;
+ 
+     // Slow drift of each parameter, indexed by PARAM_*
+     float drift[NUM_PARAMS];
+ 
+     uint64_t next_fault_ms;
+     uint64_t fault_end_ms;
+     float fault_value;              // Offset, or the frozen reading
+     uint8_t fault_param;
+     uint8_t fault_kind;             // SENSOR_FAULT_*
+ } sensor_station;
+ 
+ void sensor_station_init(sensor_station *station, uint64_t seed);
+ 
+ // Reads every sensor into values[], indexed by PARAM_*. Timestamps must
+ // not go backwards.
+ void sensor_station_read(sensor_station *station, uint64_t timestamp_ms,
+                          float values[NUM_PARAMS]);
+ 
+ // Reads count samples taken every period_ms starting at first_ms into
+ // values[p][0..count). Noise for the whole batch is generated at once.
+ void sensor_station_read_batch(sensor_station *station, uint64_t first_ms, uint32_t period_ms,
+                                size_t count, float *values[NUM_PARAMS]);
+ 
+ #endif /* WATER_QUALITY_SENSORS_H */
+ 
\ No newline at end of file
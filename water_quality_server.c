@@ -0,0 +1,880 @@
+/**
+ * Telemetry Server
+ *
+ * Live lines are appended to a byte ring (the broadcast log) that only
+ * grows at head; every subscriber keeps its own offset into it and is
+ * written from there with sendmsg(), so a line is formatted once however
+ * many clients there are. Offsets always sit at the start of a line: when
+ * a socket takes only part of a line, the rest of that line is copied
+ * into the client and the offset moves past it. Epoll is level-triggered;
+ * EPOLLOUT is only armed while a client's socket is full.
+ *
+ * Clients closed while handling a batch of events are freed after the
+ * batch, since later events of the same batch may still point to them.
+ */
+
+ #define _GNU_SOURCE
+ 
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <netdb.h>
+ #include <netinet/in.h>
+ #include <netinet/tcp.h>
+ #include <pthread.h>
+ #include <signal.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <sys/epoll.h>
+ #include <sys/eventfd.h>
+ #include <sys/sendfile.h>
+ #include <sys/socket.h>
+ #include <sys/stat.h>
+ #include <sys/un.h>
+ #include <unistd.h>
+ #include "water_quality_server.h"
+ #include "water_quality_history.h"
+ #include "water_quality_output.h"
+ 
+ #define SERVER_EVENTS 256           // Events handled per epoll_wait()
+ 
+ // What an epoll event belongs to
+ enum {
+     SOURCE_WAKE,                    // Inbox filled or stop requested
+     SOURCE_UNIX,                    // Listening sockets
+     SOURCE_TCP,
+     SOURCE_CLIENT
+ };
+ 
+ // Connection states
+ enum {
+     CLIENT_COMMAND,                 // Waiting for the command line
+     CLIENT_LIVE,                    // Subscribed to the live log
+     CLIENT_QUERY,                   // Sending a history response, then closing
+     CLIENT_REPLY,                   // Sending an error line, then closing
+     CLIENT_CLOSED                   // Freed after the current batch of events
+ };
+ 
+ typedef struct {
+     int kind;
+     int fd;
+ } server_source;
+ 
+ typedef struct server_client {
+     server_source source;           // First, so events can tell clients apart
+     int state;
+     uint32_t events;                // Epoll events registered for the socket
+     int input_closed;               // The client shut down its side
+     size_t slot;                    // Index in the subscriber list (CLIENT_LIVE)
+     struct server_client *prev;     // Every open client, for server_stop()
+     struct server_client *next;
+     struct server_client *next_closed;
+ 
+     uint64_t offset;                // Next log byte to send, always a line start
+     char rest[SERVER_MESSAGE_MAX];  // Text not yet sent: the end of a cut line,
+     size_t rest_length;             // the header line or an error line
+     size_t rest_sent;
+ 
+     char request[SERVER_REQUEST_MAX];
+     size_t request_length;
+ 
+     // History response: column files sent one after the other
+     int files[NUM_PARAMS + 1];
+     int column;
+     off_t file_offset;
+     size_t file_remaining;
+     size_t rows;
+     size_t first_row;
+ } server_client;
+ 
+ // One reading handed over by server_publish()
+ typedef struct {
+     uint64_t sequence;
+     float values[NUM_PARAMS];
+     quality_result result;
+ } server_update;
+ 
+ struct telemetry_server {
+     int epoll_fd;
+     server_source wake;
+     server_source listeners[SERVER_MAX_LISTENERS];
+     char unix_paths[SERVER_MAX_LISTENERS][sizeof(((struct sockaddr_un *)0)->sun_path)];
+     int listener_count;
+     int accept_paused;              // Out of file descriptors; resumed on the next close
+     char *history_dir;
+     pthread_t thread;
+ 
+     // Inbox, filled by server_publish() and swapped out by the server thread
+     pthread_mutex_t lock;
+     server_update *inbox;
+     server_update *spare;
+     size_t inbox_count;
+     int stopping;
+ 
+     // Owned by the server thread
+     char *log;                      // SERVER_LOG_SIZE bytes
+     uint64_t head;                  // Bytes ever appended to the log
+     server_client *clients;
+     server_client **subscribers;
+     size_t subscriber_count;
+     size_t subscriber_capacity;
+     server_client *closed;
+     quality_result previous;        // Levels of the last published reading
+     int have_previous;
+ 
+     server_stats stats;             // Updated with atomics, read by server_get_stats()
+ };
+ 
+ static inline void stat_add(uint64_t *counter, uint64_t value) {
+     __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+ }
+ 
+ // Listening sockets
+ 
+ static int open_unix_listener(const char *path, char *bound_path, size_t bound_size) {
+     struct sockaddr_un address;
+     struct stat st;
+     int fd;
+ 
+     if (strlen(path) >= sizeof(address.sun_path)) {
+         errno = ENAMETOOLONG;
+         return -1;
+     }
+ 
+     memset(&address, 0, sizeof(address));
+     address.sun_family = AF_UNIX;
+     strcpy(address.sun_path, path);
+ 
+     // A socket file left behind by an earlier run; never remove anything else
+     if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+ 
+     fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+     if (fd < 0) return -1;
+ 
+     if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(fd, SOMAXCONN) < 0) {
+         int saved = errno;
+         close(fd);
+         errno = saved;
+         return -1;
+     }
+ 
+     snprintf(bound_path, bound_size, "%s", path);
+     return fd;
+ }
+ 
+ static int open_tcp_listener(const char *address) {
+     char host[256] = "127.0.0.1";
+     const char *port = address;
+     const char *colon = strrchr(address, ':');
+     struct addrinfo hints;
+     struct addrinfo *info;
+     int one = 1;
+     int fd;
+ 
+     if (colon) {
+         size_t length = (size_t)(colon - address);
+         if (length >= sizeof(host)) {
+             errno = EINVAL;
+             return -1;
+         }
+         memcpy(host, address, length);
+         host[length] = '\0';
+         port = colon + 1;
+     }
+ 
+     memset(&hints, 0, sizeof(hints));
+     hints.ai_family = AF_UNSPEC;
+     hints.ai_socktype = SOCK_STREAM;
+     hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+     if (getaddrinfo(host, port, &hints, &info) != 0) {
+         errno = EINVAL;
+         return -1;
+     }
+ 
+     fd = socket(info->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+     if (fd >= 0) {
+         setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+         if (bind(fd, info->ai_addr, info->ai_addrlen) < 0 || listen(fd, SOMAXCONN) < 0) {
+             int saved = errno;
+             close(fd);
+             errno = saved;
+             fd = -1;
+         }
+     }
+ 
+     freeaddrinfo(info);
+     return fd;
+ }
+ 
+ static void set_listeners_enabled(telemetry_server *server, int enabled) {
+     for (int i = 0; i < server->listener_count; i++) {
+         struct epoll_event event = { .events = enabled ? EPOLLIN : 0,
+                                      .data.ptr = &server->listeners[i] };
+         epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, server->listeners[i].fd, &event);
+     }
+     server->accept_paused = !enabled;
+ }
+ 
+ // Clients
+ 
+ // EPOLLOUT only while the socket is full, EPOLLIN until the client shuts
+ // down its side (level-triggered EOF would fire forever)
+ static void set_client_events(telemetry_server *server, server_client *client, int blocked) {
+     uint32_t events = (client->input_closed ? 0 : EPOLLIN) | (blocked ? EPOLLOUT : 0);
+ 
+     if (client->events == events) return;
+ 
+     struct epoll_event event = { .events = events, .data.ptr = client };
+     epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, client->source.fd, &event);
+     client->events = events;
+ }
+ 
+ static void remove_subscriber(telemetry_server *server, server_client *client) {
+     server_client *last = server->subscribers[--server->subscriber_count];
+ 
+     server->subscribers[client->slot] = last;
+     last->slot = client->slot;
+ }
+ 
+ static void close_client(telemetry_server *server, server_client *client) {
+     if (client->state == CLIENT_CLOSED) return;
+ 
+     if (client->state == CLIENT_LIVE) remove_subscriber(server, client);
+     if (client->prev) client->prev->next = client->next;
+     else server->clients = client->next;
+     if (client->next) client->next->prev = client->prev;
+ 
+     for (int c = 0; c <= NUM_PARAMS; c++) {
+         if (client->files[c] >= 0) close(client->files[c]);
+     }
+ 
+     // Closing the socket also takes it out of the epoll set
+     close(client->source.fd);
+     client->state = CLIENT_CLOSED;
+     client->next_closed = server->closed;
+     server->closed = client;
+     __atomic_fetch_sub(&server->stats.clients, 1, __ATOMIC_RELAXED);
+ 
+     if (server->accept_paused) set_listeners_enabled(server, 1);
+ }
+ 
+ static void free_closed_clients(telemetry_server *server) {
+     while (server->closed) {
+         server_client *client = server->closed;
+         server->closed = client->next_closed;
+         free(client);
+     }
+ }
+ 
+ static void accept_clients(telemetry_server *server, const server_source *listener) {
+     for (;;) {
+         int fd = accept4(listener->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+ 
+         if (fd < 0) {
+             if (errno == EINTR || errno == ECONNABORTED) continue;
+             // Level-triggered listeners would fire again at once; wait for a close
+             if (errno == EMFILE || errno == ENFILE || errno == ENOMEM) {
+                 set_listeners_enabled(server, 0);
+             }
+             return;
+         }
+ 
+         server_client *client = calloc(1, sizeof(*client));
+         struct epoll_event event = { .events = EPOLLIN, .data.ptr = client };
+ 
+         if (!client || epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+             free(client);
+             close(fd);
+             continue;
+         }
+ 
+         // Live lines are small and should leave at once
+         if (listener->kind == SOURCE_TCP) {
+             int one = 1;
+             setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+         }
+ 
+         client->source.kind = SOURCE_CLIENT;
+         client->source.fd = fd;
+         client->state = CLIENT_COMMAND;
+         client->events = EPOLLIN;
+         client->next = server->clients;
+         if (server->clients) server->clients->prev = client;
+         server->clients = client;
+         for (int c = 0; c <= NUM_PARAMS; c++) client->files[c] = -1;
+ 
+         stat_add(&server->stats.accepted, 1);
+         uint64_t clients = __atomic_add_fetch(&server->stats.clients, 1, __ATOMIC_RELAXED);
+         if (clients > server->stats.peak_clients) {
+             __atomic_store_n(&server->stats.peak_clients, clients, __ATOMIC_RELAXED);
+         }
+     }
+ }
+ 
+ // Sending. Each returns 1 when done, 0 when the socket is full and -1 when
+ // the connection failed.
+ 
+ static int send_rest(telemetry_server *server, server_client *client) {
+     while (client->rest_sent < client->rest_length) {
+         ssize_t sent = send(client->source.fd, client->rest + client->rest_sent,
+                             client->rest_length - client->rest_sent, MSG_NOSIGNAL);
+ 
+         if (sent < 0) {
+             if (errno == EINTR) continue;
+             return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+         }
+         client->rest_sent += (size_t)sent;
+         if (client->state == CLIENT_LIVE) stat_add(&server->stats.bytes_sent, (uint64_t)sent);
+     }
+ 
+     client->rest_length = 0;
+     client->rest_sent = 0;
+     return 1;
+ }
+ 
+ // Moves the rest of the line cut at client->offset into client->rest
+ static void keep_rest_of_line(telemetry_server *server, server_client *client) {
+     size_t length = 0;
+     char c;
+ 
+     do {
+         c = server->log[client->offset % SERVER_LOG_SIZE];
+         client->rest[length++] = c;
+         client->offset++;
+     } while (c != '\n');
+ 
+     client->rest_length = length;
+     client->rest_sent = 0;
+ }
+ 
+ static int send_live(telemetry_server *server, server_client *client) {
+     int done = send_rest(server, client);
+     if (done <= 0) return done;
+ 
+     // Overwritten before it could be sent: continue with the oldest whole
+     // line the log still holds
+     if (server->head - client->offset > SERVER_LOG_SIZE) {
+         client->offset = server->head - SERVER_LOG_SIZE;
+         while (server->log[client->offset++ % SERVER_LOG_SIZE] != '\n') {}
+         stat_add(&server->stats.lagged, 1);
+     }
+ 
+     while (client->offset < server->head) {
+         size_t position = client->offset % SERVER_LOG_SIZE;
+         size_t length = server->head - client->offset;
+         size_t first = length < SERVER_LOG_SIZE - position ? length : SERVER_LOG_SIZE - position;
+         struct iovec iov[2] = {
+             { server->log + position, first },
+             { server->log, length - first }
+         };
+         struct msghdr message = { .msg_iov = iov, .msg_iovlen = length > first ? 2 : 1 };
+ 
+         ssize_t sent = sendmsg(client->source.fd, &message, MSG_NOSIGNAL);
+         if (sent < 0) {
+             if (errno == EINTR) continue;
+             return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+         }
+ 
+         client->offset += (uint64_t)sent;
+         stat_add(&server->stats.bytes_sent, (uint64_t)sent);
+ 
+         // The socket is full: keep the cut line, the log may overwrite it
+         if (client->offset < server->head &&
+             server->log[(client->offset - 1) % SERVER_LOG_SIZE] != '\n') {
+             keep_rest_of_line(server, client);
+             done = send_rest(server, client);
+             if (done <= 0) return done;
+         }
+     }
+ 
+     return 1;
+ }
+ 
+ static int send_query(telemetry_server *server, server_client *client) {
+     int done = send_rest(server, client);
+     if (done <= 0) return done;
+ 
+     for (;;) {
+         // Next column: the same rows, as floats
+         if (client->file_remaining == 0) {
+             if (++client->column > NUM_PARAMS) return 1;
+             client->file_offset = (off_t)(client->first_row * sizeof(float));
+             client->file_remaining = client->rows * sizeof(float);
+             continue;
+         }
+ 
+         ssize_t sent = sendfile(client->source.fd, client->files[client->column],
+                                 &client->file_offset, client->file_remaining);
+         if (sent < 0) {
+             if (errno == EINTR) continue;
+             return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+         }
+         // The file is shorter than the index said
+         if (sent == 0) return -1;
+ 
+         client->file_remaining -= (size_t)sent;
+         stat_add(&server->stats.query_bytes, (uint64_t)sent);
+     }
+ }
+ 
+ // Sends what the client has pending and updates its epoll events; closes
+ // it when it is done (queries, errors) or failed
+ static void service_client(telemetry_server *server, server_client *client) {
+     int done;
+ 
+     switch (client->state) {
+         case CLIENT_LIVE:
+             done = send_live(server, client);
+             break;
+         case CLIENT_QUERY:
+             done = send_query(server, client);
+             if (done > 0) done = -1;
+             break;
+         case CLIENT_REPLY:
+             done = send_rest(server, client);
+             if (done > 0) done = -1;
+             break;
+         default:
+             return;
+     }
+ 
+     if (done < 0) close_client(server, client);
+     else set_client_events(server, client, !done);
+ }
+ 
+ // Commands
+ 
+ static void reply_error(server_client *client, const char *message) {
+     char *end = format_text(format_text(client->rest, "E "), message);
+ 
+     *end++ = '\n';
+     client->rest_length = (size_t)(end - client->rest);
+     client->rest_sent = 0;
+     client->state = CLIENT_REPLY;
+ }
+ 
+ static void start_live(telemetry_server *server, server_client *client) {
+     if (server->subscriber_count == server->subscriber_capacity) {
+         size_t capacity = server->subscriber_capacity ? server->subscriber_capacity * 2 : 64;
+         server_client **grown = realloc(server->subscribers, capacity * sizeof(*grown));
+ 
+         if (!grown) {
+             reply_error(client, "out of memory");
+             return;
+         }
+         server->subscribers = grown;
+         server->subscriber_capacity = capacity;
+     }
+ 
+     client->state = CLIENT_LIVE;
+     client->slot = server->subscriber_count;
+     client->offset = server->head;
+     server->subscribers[server->subscriber_count++] = client;
+ 
+     char *out = format_text(client->rest, "# R,sequence,timestamp_ms");
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         *out++ = ',';
+         out = format_text(out, get_parameter_key(p));
+     }
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         *out++ = ',';
+         out = format_text(format_text(out, get_parameter_key(p)), "_level");
+     }
+     out = format_text(out, ",overall\n");
+     client->rest_length = (size_t)(out - client->rest);
+     client->rest_sent = 0;
+ }
+ 
+ static void start_query(telemetry_server *server, server_client *client, const char *arguments) {
+     unsigned long long from_ms;
+     unsigned long long to_ms;
+     history_reader reader;
+ 
+     if (!server->history_dir) {
+         reply_error(client, "no history store");
+         return;
+     }
+     if (sscanf(arguments, "%llu %llu", &from_ms, &to_ms) != 2) {
+         reply_error(client, "expected: history from_ms to_ms");
+         return;
+     }
+     if (history_reader_open(&reader, server->history_dir) < 0) {
+         reply_error(client, "history unavailable");
+         return;
+     }
+ 
+     client->rows = history_query(&reader, from_ms, to_ms, &client->first_row);
+     history_reader_close(&reader);
+ 
+     for (int c = 0; c <= NUM_PARAMS; c++) {
+         client->files[c] = history_column_open(server->history_dir, c);
+         if (client->files[c] < 0) {
+             reply_error(client, "history unavailable");
+             return;
+         }
+     }
+ 
+     // Timestamps first; send_query() moves on to the parameter columns
+     client->state = CLIENT_QUERY;
+     client->column = 0;
+     client->file_offset = (off_t)(client->first_row * sizeof(uint64_t));
+     client->file_remaining = client->rows * sizeof(uint64_t);
+ 
+     char *out = format_uint(format_text(client->rest, "H "), client->rows);
+     out = format_text(out, " timestamp_ms:u64");
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         *out++ = ' ';
+         out = format_text(format_text(out, get_parameter_key(p)), ":f32");
+     }
+     *out++ = '\n';
+     client->rest_length = (size_t)(out - client->rest);
+     client->rest_sent = 0;
+ 
+     stat_add(&server->stats.queries, 1);
+ }
+ 
+ static void handle_command(telemetry_server *server, server_client *client, char *line) {
+     size_t length = strlen(line);
+ 
+     if (length > 0 && line[length - 1] == '\r') line[--length] = '\0';
+ 
+     if (strcmp(line, "live") == 0) {
+         start_live(server, client);
+     } else if (strncmp(line, "history ", 8) == 0) {
+         start_query(server, client, line + 8);
+     } else {
+         reply_error(client, "unknown command (expected: live, history from_ms to_ms)");
+     }
+ 
+     service_client(server, client);
+ }
+ 
+ static void read_client(telemetry_server *server, server_client *client) {
+     char discard[512];
+ 
+     while (client->state != CLIENT_CLOSED) {
+         int waiting = client->state == CLIENT_COMMAND;
+         char *buffer = waiting ? client->request + client->request_length : discard;
+         size_t room = waiting ? sizeof(client->request) - 1 - client->request_length
+                               : sizeof(discard);
+         ssize_t got = recv(client->source.fd, buffer, room, 0);
+ 
+         if (got < 0 && errno == EINTR) continue;
+         if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+         if (got < 0 || (got == 0 && waiting)) {
+             close_client(server, client);
+             return;
+         }
+ 
+         // Shut down after its command: keep sending until done or refused
+         if (got == 0) {
+             client->input_closed = 1;
+             set_client_events(server, client, (client->events & EPOLLOUT) != 0);
+             return;
+         }
+ 
+         // Input after the command is ignored
+         if (!waiting) continue;
+ 
+         client->request_length += (size_t)got;
+         client->request[client->request_length] = '\0';
+ 
+         char *newline = strchr(client->request, '\n');
+         if (newline) {
+             *newline = '\0';
+             handle_command(server, client, client->request);
+         } else if (client->request_length == sizeof(client->request) - 1) {
+             reply_error(client, "command too long");
+             service_client(server, client);
+         }
+     }
+ }
+ 
+ // Live log
+ 
+ static void log_append(telemetry_server *server, const char *text, size_t length) {
+     size_t position = server->head % SERVER_LOG_SIZE;
+     size_t first = length < SERVER_LOG_SIZE - position ? length : SERVER_LOG_SIZE - position;
+ 
+     memcpy(server->log + position, text, first);
+     memcpy(server->log, text + first, length - first);
+     server->head += length;
+ }
+ 
+ static char* format_change(char *out, const server_update *update, const char *name,
+                            uint8_t from, uint8_t to) {
+     out = format_uint(format_text(out, "C,"), update->sequence);
+     *out++ = ',';
+     out = format_uint(out, update->result.timestamp_ms);
+     *out++ = ',';
+     out = format_text(out, name);
+     *out++ = ',';
+     *out++ = (char)('0' + from);
+     *out++ = ',';
+     *out++ = (char)('0' + to);
+     *out++ = '\n';
+     return out;
+ }
+ 
+ static void append_update(telemetry_server *server, const server_update *update) {
+     const quality_result *result = &update->result;
+     char line[SERVER_MESSAGE_MAX];
+     char *out = format_uint(format_text(line, "R,"), update->sequence);
+ 
+     *out++ = ',';
+     out = format_uint(out, result->timestamp_ms);
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         *out++ = ',';
+         out = format_fixed(out, update->values[p], 2);
+     }
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         *out++ = ',';
+         *out++ = (char)('0' + result->level[p]);
+     }
+     *out++ = ',';
+     *out++ = (char)('0' + result->overall);
+     *out++ = '\n';
+     log_append(server, line, (size_t)(out - line));
+ 
+     // Quality changes against the previous published reading
+     if (server->have_previous) {
+         const quality_result *previous = &server->previous;
+ 
+         for (int p = 0; p < NUM_PARAMS; p++) {
+             if (previous->level[p] == result->level[p]) continue;
+             out = format_change(line, update, get_parameter_key(p), previous->level[p],
+                                 result->level[p]);
+             log_append(server, line, (size_t)(out - line));
+         }
+         if (previous->overall != result->overall) {
+             out = format_change(line, update, "overall", previous->overall, result->overall);
+             log_append(server, line, (size_t)(out - line));
+         }
+     }
+ 
+     server->previous = *result;
+     server->have_previous = 1;
+     stat_add(&server->stats.readings, 1);
+ }
+ 
+ // Takes the inbox and sends its readings to every subscriber; returns 1
+ // once a stop was requested
+ static int drain_inbox(telemetry_server *server) {
+     uint64_t signals;
+     server_update *updates;
+     size_t count;
+     int stopping;
+ 
+     if (read(server->wake.fd, &signals, sizeof(signals)) < 0 && errno != EAGAIN) return 0;
+ 
+     pthread_mutex_lock(&server->lock);
+     updates = server->inbox;
+     count = server->inbox_count;
+     server->inbox = server->spare;
+     server->spare = updates;
+     server->inbox_count = 0;
+     stopping = server->stopping;
+     pthread_mutex_unlock(&server->lock);
+ 
+     if (count == 0) return stopping;
+ 
+     for (size_t i = 0; i < count; i++) append_update(server, &updates[i]);
+ 
+     // Clients waiting for EPOLLOUT catch up when their socket drains.
+     // Backwards, since closing one moves the last subscriber into its slot.
+     for (size_t i = server->subscriber_count; i-- > 0;) {
+         server_client *client = server->subscribers[i];
+         if (!(client->events & EPOLLOUT)) service_client(server, client);
+     }
+ 
+     return stopping;
+ }
+ 
+ static void* server_main(void *arg) {
+     telemetry_server *server = arg;
+     struct epoll_event events[SERVER_EVENTS];
+     sigset_t signals;
+     int stopping = 0;
+ 
+     // sendfile() to a closed connection raises SIGPIPE; keep it pending
+     // on this thread instead of killing the process
+     sigemptyset(&signals);
+     sigaddset(&signals, SIGPIPE);
+     pthread_sigmask(SIG_BLOCK, &signals, NULL);
+ 
+     while (!stopping) {
+         int count = epoll_wait(server->epoll_fd, events, SERVER_EVENTS, -1);
+ 
+         if (count < 0) {
+             if (errno == EINTR) continue;
+             perror("telemetry server");
+             break;
+         }
+ 
+         for (int i = 0; i < count; i++) {
+             server_source *source = events[i].data.ptr;
+ 
+             if (source->kind == SOURCE_WAKE) {
+                 stopping = drain_inbox(server);
+             } else if (source->kind != SOURCE_CLIENT) {
+                 accept_clients(server, source);
+             } else {
+                 server_client *client = (server_client *)source;
+                 uint32_t flags = events[i].events;
+ 
+                 if (client->state == CLIENT_CLOSED) continue;
+                 // Both directions are gone: nothing can be sent any more
+                 if (flags & (EPOLLHUP | EPOLLERR)) {
+                     close_client(server, client);
+                     continue;
+                 }
+                 if (flags & EPOLLOUT) service_client(server, client);
+                 if (flags & EPOLLIN) read_client(server, client);
+             }
+         }
+ 
+         free_closed_clients(server);
+     }
+ 
+     return NULL;
+ }
+ 
+ telemetry_server* server_start(const char *const addresses[], int count, const char *history_dir) {
+     telemetry_server *server;
+     int saved;
+ 
+     if (count < 1 || count > SERVER_MAX_LISTENERS) {
+         errno = EINVAL;
+         return NULL;
+     }
+ 
+     server = calloc(1, sizeof(*server));
+     if (!server) return NULL;
+ 
+     server->epoll_fd = -1;
+     server->wake.kind = SOURCE_WAKE;
+     server->wake.fd = -1;
+     pthread_mutex_init(&server->lock, NULL);
+ 
+     server->log = malloc(SERVER_LOG_SIZE);
+     server->inbox = malloc(SERVER_INBOX_CAPACITY * sizeof(server_update));
+     server->spare = malloc(SERVER_INBOX_CAPACITY * sizeof(server_update));
+     server->history_dir = history_dir ? strdup(history_dir) : NULL;
+     if (!server->log || !server->inbox || !server->spare || (history_dir && !server->history_dir)) {
+         errno = ENOMEM;
+         goto fail;
+     }
+ 
+     server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+     server->wake.fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+     if (server->epoll_fd < 0 || server->wake.fd < 0) goto fail;
+ 
+     struct epoll_event wake_event = { .events = EPOLLIN, .data.ptr = &server->wake };
+     if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->wake.fd, &wake_event) < 0) goto fail;
+ 
+     for (int i = 0; i < count; i++) {
+         server_source *listener = &server->listeners[i];
+         int is_unix = strchr(addresses[i], '/') != NULL;
+ 
+         listener->kind = is_unix ? SOURCE_UNIX : SOURCE_TCP;
+         listener->fd = is_unix ? open_unix_listener(addresses[i], server->unix_paths[i],
+                                                     sizeof(server->unix_paths[i]))
+                                : open_tcp_listener(addresses[i]);
+         if (listener->fd < 0) goto fail;
+         server->listener_count++;
+ 
+         struct epoll_event event = { .events = EPOLLIN, .data.ptr = listener };
+         if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, listener->fd, &event) < 0) goto fail;
+     }
+ 
+     if (pthread_create(&server->thread, NULL, server_main, server) != 0) {
+         errno = EAGAIN;
+         goto fail;
+     }
+ 
+     return server;
+ 
+ fail:
+     saved = errno;
+     for (int i = 0; i < server->listener_count; i++) {
+         close(server->listeners[i].fd);
+         if (server->unix_paths[i][0]) unlink(server->unix_paths[i]);
+     }
+     if (server->wake.fd >= 0) close(server->wake.fd);
+     if (server->epoll_fd >= 0) close(server->epoll_fd);
+     pthread_mutex_destroy(&server->lock);
+     free(server->log);
+     free(server->inbox);
+     free(server->spare);
+     free(server->history_dir);
+     free(server);
+     errno = saved;
+     return NULL;
+ }
+ 
+ static void wake_server(telemetry_server *server) {
+     uint64_t one = 1;
+     ssize_t written = write(server->wake.fd, &one, sizeof(one));
+     (void)written;                  // Only fails when the counter is already set
+ }
+ 
+ void server_publish(telemetry_server *server, uint64_t sequence, const float values[NUM_PARAMS],
+                     const quality_result *result) {
+     int wake;
+ 
+     pthread_mutex_lock(&server->lock);
+     if (server->inbox_count == SERVER_INBOX_CAPACITY) {
+         pthread_mutex_unlock(&server->lock);
+         stat_add(&server->stats.dropped, 1);
+         return;
+     }
+ 
+     server_update *update = &server->inbox[server->inbox_count++];
+     update->sequence = sequence;
+     memcpy(update->values, values, sizeof(update->values));
+     update->result = *result;
+     wake = server->inbox_count == 1;
+     pthread_mutex_unlock(&server->lock);
+ 
+     // One wakeup per batch: the server takes the whole inbox at once
+     if (wake) wake_server(server);
+ }
+ 
+ void server_get_stats(telemetry_server *server, server_stats *stats) {
+     const server_stats *s = &server->stats;
+ 
+     stats->clients = __atomic_load_n(&s->clients, __ATOMIC_RELAXED);
+     stats->peak_clients = __atomic_load_n(&s->peak_clients, __ATOMIC_RELAXED);
+     stats->accepted = __atomic_load_n(&s->accepted, __ATOMIC_RELAXED);
+     stats->readings = __atomic_load_n(&s->readings, __ATOMIC_RELAXED);
+     stats->dropped = __atomic_load_n(&s->dropped, __ATOMIC_RELAXED);
+     stats->lagged = __atomic_load_n(&s->lagged, __ATOMIC_RELAXED);
+     stats->bytes_sent = __atomic_load_n(&s->bytes_sent, __ATOMIC_RELAXED);
+     stats->queries = __atomic_load_n(&s->queries, __ATOMIC_RELAXED);
+     stats->query_bytes = __atomic_load_n(&s->query_bytes, __ATOMIC_RELAXED);
+ }
+ 
+ void server_stop(telemetry_server *server) {
+     pthread_mutex_lock(&server->lock);
+     server->stopping = 1;
+     pthread_mutex_unlock(&server->lock);
+     wake_server(server);
+     pthread_join(server->thread, NULL);
+ 
+     while (server->clients) close_client(server, server->clients);
+     free_closed_clients(server);
+ 
+     for (int i = 0; i < server->listener_count; i++) {
+         close(server->listeners[i].fd);
+         if (server->unix_paths[i][0]) unlink(server->unix_paths[i]);
+     }
+     close(server->wake.fd);
+     close(server->epoll_fd);
+     pthread_mutex_destroy(&server->lock);
+     free(server->subscribers);
+     free(server->log);
+     free(server->inbox);
+     free(server->spare);
+     free(server->history_dir);
+     free(server);
+ }
\ No newline at end of file
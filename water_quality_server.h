@@ -0,0 +1,73 @@
+/**
+ * Telemetry Server
+ *
+ * Serves live readings, quality changes and history queries to many local
+ * clients over Unix and TCP sockets. One thread runs a non-blocking epoll
+ * loop; the monitoring loop only hands it a copy of each analyzed reading
+ * (server_publish() never waits for a client).
+ *
+ * Clients send one command line:
+ *
+ *   live               Stream readings and quality changes as CSV lines:
+ *                        R,sequence,timestamp_ms,<values>,<levels>,overall
+ *                        C,sequence,timestamp_ms,<parameter|overall>,from,to
+ *                      after a "# ..." header line naming the columns.
+ *                      Levels are QUALITY_* digits, values have two decimals.
+ *   history from to    Rows with from <= timestamp_ms <= to of the history
+ *                      store: "H rows <key>:<type>...\n" and then each
+ *                      column as raw little-endian values, timestamps first
+ *                      (copied from the column files with sendfile). The
+ *                      connection closes after the last byte.
+ *
+ * Errors are a single "E message" line. Every live line is formatted once
+ * into a shared broadcast log and written to each subscriber from there.
+ * A subscriber whose socket is full just falls behind; one that falls
+ * more than SERVER_LOG_SIZE bytes behind skips ahead to the oldest line
+ * still in the log, which shows as a gap in the sequence numbers.
+ */
+
+ #ifndef WATER_QUALITY_SERVER_H
+ #define WATER_QUALITY_SERVER_H
+ 
+ #include <stdint.h>
+ #include "water_quality_config.h"
+ #include "water_quality_analysis.h"
+ 
+ #define SERVER_MAX_LISTENERS  4
+ #define SERVER_LOG_SIZE       (1 << 20)   // Bytes of live lines kept for slow subscribers
+ #define SERVER_INBOX_CAPACITY 256         // Readings waiting for the server thread
+ #define SERVER_MESSAGE_MAX    (64 + NUM_PARAMS * 48)  // Longest live line
+ #define SERVER_REQUEST_MAX    128         // Longest command line
+ 
+ typedef struct {
+     uint64_t clients;               // Connected now
+     uint64_t peak_clients;
+     uint64_t accepted;
+     uint64_t readings;              // Readings published to the live log
+     uint64_t dropped;               // Readings lost because the inbox was full
+     uint64_t lagged;                // Times a subscriber skipped ahead
+     uint64_t bytes_sent;            // Live lines, all subscribers together
+     uint64_t queries;
+     uint64_t query_bytes;           // History bytes sent with sendfile
+ } server_stats;
+ 
+ typedef struct telemetry_server telemetry_server;
+ 
+ // Listens on every address and starts the server thread. An address with
+ // a '/' is a Unix socket path, anything else "[host:]port" for TCP (host
+ // defaults to 127.0.0.1). history_dir may be NULL, which refuses queries.
+ // Returns NULL with errno set.
+ telemetry_server* server_start(const char *const addresses[], int count, const char *history_dir);
+ 
+ // Queues one analyzed reading for the subscribers. Never blocks on the
+ // server thread or on a client; a full inbox drops the reading.
+ void server_publish(telemetry_server *server, uint64_t sequence, const float values[NUM_PARAMS],
+                     const quality_result *result);
+ 
+ // Safe to call from any thread
+ void server_get_stats(telemetry_server *server, server_stats *stats);
+ 
+ // Closes every connection, stops the thread and removes the Unix socket files
+ void server_stop(telemetry_server *server);
+ 
+ #endif /* WATER_QUALITY_SERVER_H */
\ No newline at end of file
@@ -0,0 +1,60 @@
+/**
+ * Binary Telemetry Frames - Encoder
+ *
+ * Kept free of tables and 64-bit arithmetic for the AVR: the CRC is
+ * computed bit by bit, which is fast enough for one frame per reading.
+ */
+
+ #include "water_quality_telemetry.h"
+ 
+ void telemetry_encoder_init(telemetry_encoder *encoder) {
+     for (uint8_t p = 0; p < NUM_PARAMS; p++) encoder->previous[p] = 0;
+     encoder->sequence = 0;
+ }
+ 
+ uint16_t telemetry_crc16_update(uint16_t crc, uint8_t byte) {
+     crc ^= (uint16_t)byte << 8;
+     for (uint8_t bit = 0; bit < 8; bit++) {
+         crc = crc & 0x8000 ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+     }
+     return crc;
+ }
+ 
+ // Zigzag (small magnitudes of either sign stay small), then 7 bits per byte
+ static uint8_t* put_varint(uint8_t *out, int32_t value) {
+     uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+ 
+     while (zigzag >= 0x80) {
+         *out++ = (uint8_t)(zigzag | 0x80);
+         zigzag >>= 7;
+     }
+     *out++ = (uint8_t)zigzag;
+     return out;
+ }
+ 
+ uint8_t telemetry_encode(telemetry_encoder *encoder, const int32_t values[NUM_PARAMS],
+                          const uint8_t levels[NUM_PARAMS], uint8_t frame[TELEMETRY_MAX_FRAME]) {
+     uint8_t keyframe = encoder->sequence % TELEMETRY_KEYFRAME_INTERVAL == 0;
+     uint8_t *out = frame + 2;
+     uint8_t quality[TELEMETRY_QUALITY_BYTES] = { 0 };
+ 
+     *out++ = encoder->sequence++;
+     *out++ = keyframe ? TELEMETRY_FLAG_KEYFRAME : 0;
+ 
+     for (uint8_t p = 0; p < NUM_PARAMS; p++) {
+         out = put_varint(out, keyframe ? values[p] : values[p] - encoder->previous[p]);
+         encoder->previous[p] = values[p];
+         quality[p / 4] |= (uint8_t)((levels[p] & 0x03) << (2 * (p % 4)));
+     }
+     for (uint8_t b = 0; b < TELEMETRY_QUALITY_BYTES; b++) *out++ = quality[b];
+ 
+     frame[0] = TELEMETRY_SYNC;
+     frame[1] = (uint8_t)(out - frame - 2);
+ 
+     uint16_t crc = 0xFFFF;
+     for (uint8_t *byte = frame + 1; byte < out; byte++) crc = telemetry_crc16_update(crc, *byte);
+     *out++ = (uint8_t)(crc >> 8);
+     *out++ = (uint8_t)crc;
+ 
+     return (uint8_t)(out - frame);
+ }
\ No newline at end of file
@@ -0,0 +1,90 @@
+/**
+ * Binary Telemetry Frames
+ *
+ * A compact alternative to the text reports for slow serial and radio
+ * links. One frame per reading:
+ *
+ *     0xA5  length  sequence  flags  value x NUM_PARAMS
+ *         quality x TELEMETRY_QUALITY_BYTES  CRC (2)
+ *
+ * length counts sequence to quality. Values are hundredths of each
+ * parameter's unit, sent as zigzag varints of the change since the
+ * previous frame; keyframes (flags bit 0, every TELEMETRY_KEYFRAME_INTERVAL
+ * frames) carry them in full so a receiver can join or recover after a
+ * lost frame. quality holds two bits per parameter, PARAM_* order, least
+ * significant bits first. The CRC is CRC-16/CCITT-FALSE over length to
+ * quality, big endian. A typical frame is 13 bytes instead of a ~350
+ * byte report.
+ *
+ * The encoder is plain C99 and runs on the firmware; the decoder is for
+ * the host.
+ */
+
+ #ifndef WATER_QUALITY_TELEMETRY_H
+ #define WATER_QUALITY_TELEMETRY_H
+ 
+ #include <stddef.h>
+ #include <stdint.h>
+ #include "water_quality_config.h"
+ 
+ #define TELEMETRY_SYNC 0xA5
+ #define TELEMETRY_FLAG_KEYFRAME 0x01
+ #define TELEMETRY_KEYFRAME_INTERVAL 16
+ #define TELEMETRY_VARINT_MAX 5
+ #define TELEMETRY_QUALITY_BYTES ((NUM_PARAMS + 3) / 4)
+ #define TELEMETRY_MIN_LENGTH (2 + NUM_PARAMS + TELEMETRY_QUALITY_BYTES)
+ #define TELEMETRY_MAX_LENGTH (2 + NUM_PARAMS * TELEMETRY_VARINT_MAX + TELEMETRY_QUALITY_BYTES)
+ #define TELEMETRY_MAX_FRAME (2 + TELEMETRY_MAX_LENGTH + 2)
+ 
+ typedef struct {
+     int32_t previous[NUM_PARAMS];
+     uint8_t sequence;
+ } telemetry_encoder;
+ 
+ void telemetry_encoder_init(telemetry_encoder *encoder);
+ 
+ // Writes the frame of one reading (values in hundredths, levels as
+ // QUALITY_*) and returns its length in bytes
+ uint8_t telemetry_encode(telemetry_encoder *encoder, const int32_t values[NUM_PARAMS],
+                          const uint8_t levels[NUM_PARAMS], uint8_t frame[TELEMETRY_MAX_FRAME]);
+ 
+ // CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF)
+ uint16_t telemetry_crc16_update(uint16_t crc, uint8_t byte);
+ 
+ // Decoded reading
+ typedef struct {
+     uint8_t sequence;
+     uint8_t keyframe;
+     int32_t values[NUM_PARAMS];     // Hundredths of each parameter's unit
+     uint8_t levels[NUM_PARAMS];
+ } telemetry_reading;
+ 
+ typedef struct {
+     uint64_t frames;                // Frames with a valid CRC
+     uint64_t readings;              // Readings delivered
+     uint64_t crc_errors;
+     uint64_t skipped_bytes;         // Bytes discarded while looking for a frame
+     uint64_t gaps;                  // Sequence gaps (lost frames)
+     uint64_t unsynced;              // Delta frames dropped while waiting for a keyframe
+ } telemetry_stats;
+ 
+ typedef struct {
+     uint16_t crc_table[256];
+     int32_t previous[NUM_PARAMS];
+     int synced;                     // previous is valid
+     uint8_t sequence;               // Of the last frame delivered
+     telemetry_stats stats;
+ } telemetry_decoder;
+ 
+ typedef void (*telemetry_callback)(const telemetry_reading *reading, void *context);
+ 
+ void telemetry_decoder_init(telemetry_decoder *decoder);
+ 
+ // Decodes every complete frame in data[0..size), calling callback for
+ // each reading, and returns the bytes consumed. An incomplete frame at
+ // the end is left unconsumed, to be passed again with more data;
+ // with final set it is counted as skipped instead.
+ size_t telemetry_decode(telemetry_decoder *decoder, const uint8_t *data, size_t size, int final,
+                         telemetry_callback callback, void *context);
+ 
+ #endif /* WATER_QUALITY_TELEMETRY_H */
\ No newline at end of file
@@ -0,0 +1,145 @@
+/**
+ * Binary Telemetry Frames - Decoder
+ *
+ * Sync bytes are found with memchr() and the CRC uses a 256-entry table,
+ * so a clean stream decodes at memory speed. A candidate frame that is
+ * too long or fails its CRC costs only its sync byte: decoding resumes
+ * at the next 0xA5, which may be the real start of a frame.
+ */
+
+ #define _POSIX_C_SOURCE 200809L
+ 
+ #include <string.h>
+ #include "water_quality_telemetry.h"
+ 
+ void telemetry_decoder_init(telemetry_decoder *decoder) {
+     memset(decoder, 0, sizeof(*decoder));
+ 
+     for (int byte = 0; byte < 256; byte++) {
+         uint16_t crc = 0;
+         crc = telemetry_crc16_update(crc, (uint8_t)byte);
+         decoder->crc_table[byte] = crc;
+     }
+ }
+ 
+ static inline uint16_t crc16(const uint16_t table[256], const uint8_t *data, size_t size) {
+     uint16_t crc = 0xFFFF;
+ 
+     for (size_t i = 0; i < size; i++) {
+         crc = (uint16_t)((crc << 8) ^ table[(crc >> 8) ^ data[i]]);
+     }
+     return crc;
+ }
+ 
+ // Reads one varint from [*p, end); -1 when it is truncated or too long
+ static inline int get_varint(const uint8_t **p, const uint8_t *end, int32_t *value) {
+     uint32_t zigzag = 0;
+ 
+     for (int shift = 0; shift < 7 * TELEMETRY_VARINT_MAX; shift += 7) {
+         if (*p == end) return -1;
+ 
+         uint8_t byte = *(*p)++;
+         zigzag |= (uint32_t)(byte & 0x7F) << shift;
+         if (!(byte & 0x80)) {
+             *value = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+             return 0;
+         }
+     }
+     return -1;
+ }
+ 
+ // Parses the payload of a frame whose CRC matched
+ static int parse_payload(const uint8_t *payload, size_t length, telemetry_reading *reading,
+                          int32_t deltas[NUM_PARAMS]) {
+     const uint8_t *p = payload + 2;
+     const uint8_t *end = payload + length;
+ 
+     reading->sequence = payload[0];
+     reading->keyframe = (payload[1] & TELEMETRY_FLAG_KEYFRAME) != 0;
+ 
+     for (int param = 0; param < NUM_PARAMS; param++) {
+         if (get_varint(&p, end, &deltas[param]) < 0) return -1;
+     }
+ 
+     if (end - p != TELEMETRY_QUALITY_BYTES) return -1;
+     for (int param = 0; param < NUM_PARAMS; param++) {
+         reading->levels[param] = (uint8_t)((p[param / 4] >> (2 * (param % 4))) & 0x03);
+     }
+     return 0;
+ }
+ 
+ // Applies a parsed frame to the decoder state; 1 when it yields a reading
+ static int apply_frame(telemetry_decoder *decoder, telemetry_reading *reading,
+                        const int32_t deltas[NUM_PARAMS]) {
+     if (decoder->synced && reading->sequence != (uint8_t)(decoder->sequence + 1)) {
+         decoder->stats.gaps++;
+         decoder->synced = 0;
+     }
+ 
+     if (!reading->keyframe && !decoder->synced) {
+         decoder->stats.unsynced++;
+         return 0;
+     }
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         reading->values[p] = reading->keyframe ? deltas[p] : decoder->previous[p] + deltas[p];
+         decoder->previous[p] = reading->values[p];
+     }
+     decoder->sequence = reading->sequence;
+     decoder->synced = 1;
+     return 1;
+ }
+ 
+ size_t telemetry_decode(telemetry_decoder *decoder, const uint8_t *data, size_t size, int final,
+                         telemetry_callback callback, void *context) {
+     size_t position = 0;
+ 
+     while (position < size) {
+         const uint8_t *sync = memchr(data + position, TELEMETRY_SYNC, size - position);
+ 
+         if (!sync) {
+             decoder->stats.skipped_bytes += size - position;
+             return size;
+         }
+         decoder->stats.skipped_bytes += (size_t)(sync - data) - position;
+         position = (size_t)(sync - data);
+ 
+         if (size - position < 2) break;
+ 
+         size_t length = data[position + 1];
+         if (length < TELEMETRY_MIN_LENGTH || length > TELEMETRY_MAX_LENGTH) {
+             decoder->stats.skipped_bytes++;
+             position++;
+             continue;
+         }
+ 
+         size_t frame_size = 2 + length + 2;
+         if (size - position < frame_size) break;
+ 
+         const uint8_t *frame = data + position;
+         uint16_t crc = (uint16_t)(frame[2 + length] << 8 | frame[3 + length]);
+         telemetry_reading reading;
+         int32_t deltas[NUM_PARAMS];
+ 
+         if (crc16(decoder->crc_table, frame + 1, 1 + length) != crc ||
+             parse_payload(frame + 2, length, &reading, deltas) < 0) {
+             decoder->stats.crc_errors++;
+             decoder->stats.skipped_bytes++;
+             position++;
+             continue;
+         }
+ 
+         decoder->stats.frames++;
+         if (apply_frame(decoder, &reading, deltas)) {
+             decoder->stats.readings++;
+             callback(&reading, context);
+         }
+         position += frame_size;
+     }
+ 
+     if (final && position < size) {
+         decoder->stats.skipped_bytes += size - position;
+         position = size;
+     }
+     return position;
+ }
\ No newline at end of file
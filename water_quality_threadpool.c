@@ -0,0 +1,295 @@
+/**
+ * Work-Stealing Thread Pool
+ *
+ * The deque follows "Correct and Efficient Work-Stealing for Weak Memory
+ * Models" (Le et al., PPoPP 2013), written with the GCC __atomic builtins.
+ */
+
+ #define _POSIX_C_SOURCE 200809L
+ 
+ #include <pthread.h>
+ #include <sched.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <time.h>
+ #include "water_quality_threadpool.h"
+ 
+ #define DEQUE_CAPACITY 256  // Power of two; splitting only needs log2(count) slots
+ 
+ typedef struct {
+     size_t begin;
+     size_t end;
+ } range;
+ 
+ typedef struct {
+     // Owner end and thief end on separate cache lines
+     int64_t top __attribute__((aligned(64)));
+     int64_t bottom __attribute__((aligned(64)));
+     size_t slots[DEQUE_CAPACITY][2];
+ } range_deque;
+ 
+ typedef struct {
+     range_deque deque;
+     threadpool *pool;
+     pthread_t thread;
+     int id;
+     uint32_t random_state;
+     threadpool_worker_stats stats;
+ } __attribute__((aligned(64))) pool_worker;
+ 
+ struct threadpool {
+     int size;
+     pool_worker *workers;
+ 
+     pthread_mutex_t lock;
+     pthread_cond_t job_ready;
+     pthread_cond_t job_done;
+     uint64_t generation;        // Incremented for every job
+     int finished;               // Workers done with the current job
+     int stopping;
+ 
+     // Current job
+     threadpool_range_fn fn;
+     void *context;
+     size_t count;
+     size_t grain;
+     size_t remaining __attribute__((aligned(64)));
+ };
+ 
+ static int deque_push(range_deque *deque, range r) {
+     int64_t b = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+     int64_t t = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+     size_t *slot;
+ 
+     if (b - t >= DEQUE_CAPACITY) return 0;
+ 
+     slot = deque->slots[b & (DEQUE_CAPACITY - 1)];
+     __atomic_store_n(&slot[0], r.begin, __ATOMIC_RELAXED);
+     __atomic_store_n(&slot[1], r.end, __ATOMIC_RELAXED);
+     __atomic_thread_fence(__ATOMIC_RELEASE);
+     __atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+     return 1;
+ }
+ 
+ // Owner side: newest range first
+ static int deque_take(range_deque *deque, range *r) {
+     int64_t b = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+     int64_t t;
+     int found = 1;
+ 
+     __atomic_store_n(&deque->bottom, b, __ATOMIC_RELAXED);
+     __atomic_thread_fence(__ATOMIC_SEQ_CST);
+     t = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+ 
+     if (t > b) {
+         __atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+         return 0;
+     }
+ 
+     size_t *slot = deque->slots[b & (DEQUE_CAPACITY - 1)];
+     r->begin = __atomic_load_n(&slot[0], __ATOMIC_RELAXED);
+     r->end = __atomic_load_n(&slot[1], __ATOMIC_RELAXED);
+ 
+     if (t == b) {
+         // Last range: race thieves for it
+         if (!__atomic_compare_exchange_n(&deque->top, &t, t + 1, 0,
+                                          __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+             found = 0;
+         }
+         __atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+     }
+ 
+     return found;
+ }
+ 
+ // Thief side: oldest (largest) range first
+ static int deque_steal(range_deque *deque, range *r) {
+     int64_t t = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+     __atomic_thread_fence(__ATOMIC_SEQ_CST);
+     int64_t b = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+ 
+     if (t >= b) return 0;
+ 
+     size_t *slot = deque->slots[t & (DEQUE_CAPACITY - 1)];
+     r->begin = __atomic_load_n(&slot[0], __ATOMIC_RELAXED);
+     r->end = __atomic_load_n(&slot[1], __ATOMIC_RELAXED);
+ 
+     return __atomic_compare_exchange_n(&deque->top, &t, t + 1, 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+ }
+ 
+ static double now_seconds(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+ }
+ 
+ static uint32_t next_random(pool_worker *self) {
+     // xorshift32
+     uint32_t x = self->random_state;
+     x ^= x << 13;
+     x ^= x >> 17;
+     x ^= x << 5;
+     self->random_state = x;
+     return x;
+ }
+ 
+ static int steal_range(pool_worker *self, range *r) {
+     threadpool *pool = self->pool;
+     int start = (int)(next_random(self) % (uint32_t)pool->size);
+ 
+     for (int i = 0; i < pool->size; i++) {
+         int victim = (start + i) % pool->size;
+         if (victim != self->id && deque_steal(&pool->workers[victim].deque, r)) {
+             self->stats.steals++;
+             return 1;
+         }
+     }
+ 
+     return 0;
+ }
+ 
+ static void execute_range(pool_worker *self, range r) {
+     threadpool *pool = self->pool;
+ 
+     // Keep the lower half and expose the upper half to thieves
+     while (r.end - r.begin > pool->grain) {
+         range upper = { r.begin + (r.end - r.begin) / 2, r.end };
+         if (!deque_push(&self->deque, upper)) break;
+         r.end = upper.begin;
+     }
+ 
+     double start = now_seconds();
+     pool->fn(pool->context, r.begin, r.end, self->id);
+     self->stats.busy_seconds += now_seconds() - start;
+     self->stats.ranges++;
+ 
+     __atomic_fetch_sub(&pool->remaining, r.end - r.begin, __ATOMIC_ACQ_REL);
+ }
+ 
+ static void run_job(pool_worker *self) {
+     threadpool *pool = self->pool;
+     range r;
+ 
+     // Each worker seeds its own deque with an equal share
+     r.begin = pool->count * (size_t)self->id / (size_t)pool->size;
+     r.end = pool->count * (size_t)(self->id + 1) / (size_t)pool->size;
+     if (r.begin < r.end) deque_push(&self->deque, r);
+ 
+     while (__atomic_load_n(&pool->remaining, __ATOMIC_ACQUIRE) > 0) {
+         if (deque_take(&self->deque, &r) || steal_range(self, &r)) {
+             execute_range(self, r);
+         } else {
+             sched_yield();
+         }
+     }
+ }
+ 
+ static void* worker_main(void *arg) {
+     pool_worker *self = arg;
+     threadpool *pool = self->pool;
+     uint64_t seen = 0;
+ 
+     pthread_mutex_lock(&pool->lock);
+     for (;;) {
+         while (pool->generation == seen && !pool->stopping) {
+             pthread_cond_wait(&pool->job_ready, &pool->lock);
+         }
+         if (pool->stopping) break;
+         seen = pool->generation;
+         pthread_mutex_unlock(&pool->lock);
+ 
+         run_job(self);
+ 
+         pthread_mutex_lock(&pool->lock);
+         if (++pool->finished == pool->size) pthread_cond_signal(&pool->job_done);
+     }
+     pthread_mutex_unlock(&pool->lock);
+ 
+     return NULL;
+ }
+ 
+ threadpool* threadpool_create(int threads) {
+     threadpool *pool;
+ 
+     if (threads < 1) threads = 1;
+     if (threads > THREADPOOL_MAX_THREADS) threads = THREADPOOL_MAX_THREADS;
+ 
+     pool = calloc(1, sizeof(threadpool));
+     if (!pool) return NULL;
+ 
+     if (posix_memalign((void **)&pool->workers, 64, sizeof(pool_worker) * (size_t)threads) != 0) {
+         free(pool);
+         return NULL;
+     }
+     memset(pool->workers, 0, sizeof(pool_worker) * (size_t)threads);
+ 
+     pthread_mutex_init(&pool->lock, NULL);
+     pthread_cond_init(&pool->job_ready, NULL);
+     pthread_cond_init(&pool->job_done, NULL);
+ 
+     for (int i = 0; i < threads; i++) {
+         pool_worker *w = &pool->workers[i];
+         w->pool = pool;
+         w->id = i;
+         w->random_state = 2463534242u + (uint32_t)i * 2654435761u;
+         if (pthread_create(&w->thread, NULL, worker_main, w) != 0) {
+             threadpool_destroy(pool);
+             return NULL;
+         }
+         pool->size = i + 1;
+     }
+ 
+     return pool;
+ }
+ 
+ void threadpool_destroy(threadpool *pool) {
+     pthread_mutex_lock(&pool->lock);
+     pool->stopping = 1;
+     pthread_cond_broadcast(&pool->job_ready);
+     pthread_mutex_unlock(&pool->lock);
+ 
+     for (int i = 0; i < pool->size; i++) {
+         pthread_join(pool->workers[i].thread, NULL);
+     }
+ 
+     pthread_mutex_destroy(&pool->lock);
+     pthread_cond_destroy(&pool->job_ready);
+     pthread_cond_destroy(&pool->job_done);
+     free(pool->workers);
+     free(pool);
+ }
+ 
+ int threadpool_size(const threadpool *pool) {
+     return pool->size;
+ }
+ 
+ void threadpool_for(threadpool *pool, size_t count, size_t grain,
+                     threadpool_range_fn fn, void *context) {
+     if (count == 0) return;
+ 
+     pthread_mutex_lock(&pool->lock);
+     pool->fn = fn;
+     pool->context = context;
+     pool->count = count;
+     pool->grain = grain > 0 ? grain : 1;
+     pool->finished = 0;
+     __atomic_store_n(&pool->remaining, count, __ATOMIC_RELEASE);
+     pool->generation++;
+     pthread_cond_broadcast(&pool->job_ready);
+ 
+     while (pool->finished < pool->size) {
+         pthread_cond_wait(&pool->job_done, &pool->lock);
+     }
+     pthread_mutex_unlock(&pool->lock);
+ }
+ 
+ void threadpool_worker_stats_get(const threadpool *pool, int worker, threadpool_worker_stats *stats) {
+     *stats = pool->workers[worker].stats;
+ }
+ 
+ void threadpool_reset_stats(threadpool *pool) {
+     for (int i = 0; i < pool->size; i++) {
+         memset(&pool->workers[i].stats, 0, sizeof(threadpool_worker_stats));
+     }
+ }
\ No newline at end of file
@@ -0,0 +1,42 @@
+/**
+ * Work-Stealing Thread Pool
+ *
+ * Persistent worker threads that run parallel loops over index ranges.
+ * Every worker owns a Chase-Lev deque of ranges: it splits its own work
+ * from the bottom and idle workers steal the largest pending ranges from
+ * the top, so uneven work balances itself without a shared queue.
+ */
+
+ #ifndef WATER_QUALITY_THREADPOOL_H
+ #define WATER_QUALITY_THREADPOOL_H
+ 
+ #include <stddef.h>
+ #include <stdint.h>
+ 
+ #define THREADPOOL_MAX_THREADS 256
+ 
+ // Processes indices [begin, end) on the given worker (0-based)
+ typedef void (*threadpool_range_fn)(void *context, size_t begin, size_t end, int worker);
+ 
+ typedef struct threadpool threadpool;
+ 
+ typedef struct {
+     uint64_t ranges;        // Ranges executed
+     uint64_t steals;        // Ranges taken from other workers
+     double busy_seconds;    // Time spent inside the range function
+ } threadpool_worker_stats;
+ 
+ threadpool* threadpool_create(int threads);
+ void threadpool_destroy(threadpool *pool);
+ int threadpool_size(const threadpool *pool);
+ 
+ // Runs fn over [0, count) and returns when every index is done. Ranges
+ // are split down to grain indices.
+ void threadpool_for(threadpool *pool, size_t count, size_t grain,
+                     threadpool_range_fn fn, void *context);
+ 
+ // Statistics accumulated since creation or the last reset
+ void threadpool_worker_stats_get(const threadpool *pool, int worker, threadpool_worker_stats *stats);
+ void threadpool_reset_stats(threadpool *pool);
+ 
+ #endif /* WATER_QUALITY_THREADPOOL_H */
\ No newline at end of file
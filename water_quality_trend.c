@@ -0,0 +1,129 @@
+/**
+ * Trend Forecasts
+ *
+ * With a sampling interval dt, Holt's smoothing factors are
+ * alpha = 1 - exp(-dt / level_tau) and beta = 1 - exp(-dt / slope_tau),
+ * which keeps the time constants the same for any sampling rate. Stations
+ * sample on a fixed period, so the factors are cached per interval and
+ * an update is a few multiply-adds.
+ */
+
+ #define _POSIX_C_SOURCE 200809L
+ 
+ #include <math.h>
+ #include <string.h>
+ #include "water_quality_trend.h"
+ 
+ void trend_config_init_default(trend_config *config) {
+     config->level_tau_s = TREND_LEVEL_TAU_S;
+     config->slope_tau_s = TREND_SLOPE_TAU_S;
+     config->horizon_s = TREND_HORIZON_S;
+ }
+ 
+ void trend_init(trend_state *trend) {
+     memset(trend, 0, sizeof(*trend));
+ }
+ 
+ void trend_update(trend_state *trend, const trend_config *config, uint64_t timestamp_ms, float value) {
+     if (isnan(value)) return;
+ 
+     if (trend->samples == 0) {
+         trend->level = value;
+         trend->slope = 0.0f;
+         trend->first_ms = timestamp_ms;
+         trend->last_ms = timestamp_ms;
+         trend->samples = 1;
+         return;
+     }
+ 
+     // Repeated or late samples carry no rate information
+     if (timestamp_ms <= trend->last_ms) return;
+ 
+     uint64_t gap_ms = timestamp_ms - trend->last_ms;
+     uint32_t dt_ms = gap_ms > UINT32_MAX ? UINT32_MAX : (uint32_t)gap_ms;
+     float dt_s = dt_ms / 1000.0f;
+ 
+     if (dt_ms != trend->cached_dt_ms) {
+         trend->alpha = 1.0f - expf(-dt_s / config->level_tau_s);
+         trend->beta = 1.0f - expf(-dt_s / config->slope_tau_s);
+         trend->cached_dt_ms = dt_ms;
+     }
+ 
+     float predicted = trend->level + trend->slope * dt_s;
+     float level = predicted + trend->alpha * (value - predicted);
+ 
+     trend->slope += trend->beta * ((level - trend->level) / dt_s - trend->slope);
+     trend->level = level;
+     trend->last_ms = timestamp_ms;
+     trend->samples++;
+ }
+ 
+ int trend_predict(const trend_state *trend, const trend_config *config,
+                   const quality_bounds *bounds, float horizon_s, trend_forecast *forecast) {
+     if (trend->samples < 2 || trend->slope == 0.0f) return 0;
+     if (trend->last_ms - trend->first_ms < (uint64_t)(config->slope_tau_s * 1000.0f)) return 0;
+ 
+     uint8_t current = classify_value(bounds, trend->level);
+     if (current == QUALITY_CRITICAL) return 0;
+ 
+     // Edges ahead in the direction of the trend; open sides are infinite
+     // and never reached
+     float alert_edge = trend->slope > 0.0f ? bounds->good_max : bounds->good_min;
+     float critical_edge = trend->slope > 0.0f ? bounds->alert_max : bounds->alert_min;
+     float to_critical = (critical_edge - trend->level) / trend->slope;
+     float to_alert = (alert_edge - trend->level) / trend->slope;
+ 
+     if (to_critical <= horizon_s) {
+         forecast->level = QUALITY_CRITICAL;
+         forecast->seconds = to_critical;
+         return 1;
+     }
+ 
+     if (current == QUALITY_GOOD && to_alert <= horizon_s) {
+         forecast->level = QUALITY_ALERT;
+         forecast->seconds = to_alert;
+         return 1;
+     }
+ 
+     return 0;
+ }
+ 
+ void station_trends_init(station_trends *trends) {
+     memset(trends, 0, sizeof(*trends));
+     for (int p = 0; p < NUM_PARAMS; p++) trend_init(&trends->param[p]);
+ }
+ 
+ uint32_t station_trends_update(station_trends *trends, const trend_config *config,
+                                const quality_table *table, uint64_t timestamp_ms,
+                                const float values[NUM_PARAMS], uint32_t mask) {
+     uint32_t changed = 0;
+ 
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         uint32_t bit = 1u << p;
+         trend_forecast forecast;
+ 
+         if (!(mask & bit)) continue;
+ 
+         trend_update(&trends->param[p], config, timestamp_ms, values[p]);
+ 
+         if (trends->warnings & bit) {
+             // Twice the horizon to clear, so a slope hovering around the
+             // horizon does not raise and clear the warning on every sample
+             if (!trend_predict(&trends->param[p], config, &table->param[p],
+                                2.0f * config->horizon_s, &forecast)) {
+                 trends->warnings &= ~bit;
+                 changed |= bit;
+                 continue;
+             }
+             if (forecast.level != trends->forecast[p].level) changed |= bit;
+             trends->forecast[p] = forecast;
+         } else if (trend_predict(&trends->param[p], config, &table->param[p],
+                                  config->horizon_s, &forecast)) {
+             trends->forecast[p] = forecast;
+             trends->warnings |= bit;
+             changed |= bit;
+         }
+     }
+ 
+     return changed;
+ }
\ No newline at end of file
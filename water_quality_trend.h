@@ -0,0 +1,72 @@
+/**
+ * Trend Forecasts
+ *
+ * Holt's linear smoothing (level + slope) per parameter, updated in O(1)
+ * per sample with irregular sampling intervals. The smoothed level and
+ * slope give the time until the value crosses the next *_GOOD or *_ALERT
+ * boundary, so a warning can be raised before the level actually changes.
+ */
+
+ #ifndef WATER_QUALITY_TREND_H
+ #define WATER_QUALITY_TREND_H
+ 
+ #include <stdint.h>
+ #include "water_quality_config.h"
+ #include "water_quality_classify.h"
+ 
+ typedef struct {
+     float level_tau_s;              // Time constant of the level smoothing
+     float slope_tau_s;              // Time constant of the slope smoothing
+     float horizon_s;                // Warn when a worse level is predicted this soon
+ } trend_config;
+ 
+ typedef struct {
+     float level;
+     float slope;                    // Units per second
+     uint32_t samples;
+     uint32_t cached_dt_ms;          // Interval the smoothing factors belong to
+     float alpha;
+     float beta;
+     uint64_t first_ms;
+     uint64_t last_ms;
+ } trend_state;
+ 
+ // Worst level the trend reaches within the horizon, and when
+ typedef struct {
+     uint8_t level;
+     float seconds;
+ } trend_forecast;
+ 
+ // TREND_* defaults from water_quality_config.h
+ void trend_config_init_default(trend_config *config);
+ 
+ void trend_init(trend_state *trend);
+ 
+ // The smoothing factors are cached per sampling interval, so config must
+ // stay the same for the life of the trend
+ void trend_update(trend_state *trend, const trend_config *config, uint64_t timestamp_ms, float value);
+ 
+ // Returns 1 and fills forecast when the trend reaches a worse level than
+ // the smoothed value has now within horizon_s, 0 otherwise (also during
+ // the first slope_tau_s, while the slope is still settling)
+ int trend_predict(const trend_state *trend, const trend_config *config,
+                   const quality_bounds *bounds, float horizon_s, trend_forecast *forecast);
+ 
+ // Trends and early warnings of every parameter of one station. A warning
+ // is raised when a crossing is predicted within the horizon and cleared
+ // once none is predicted within twice the horizon.
+ typedef struct {
+     trend_state param[NUM_PARAMS];
+     trend_forecast forecast[NUM_PARAMS];    // Valid while the warning bit is set
+     uint32_t warnings;                      // Bit p set while parameter p has a warning
+ } station_trends;
+ 
+ void station_trends_init(station_trends *trends);
+ 
+ // Updates the parameters whose bit is set in mask and returns the bits of
+ // the warnings that were raised, cleared or changed level
+ uint32_t station_trends_update(station_trends *trends, const trend_config *config,
+                                const quality_table *table, uint64_t timestamp_ms,
+                                const float values[NUM_PARAMS], uint32_t mask);
+ 
+ #endif /* WATER_QUALITY_TREND_H */
\ No newline at end of file
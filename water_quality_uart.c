@@ -0,0 +1,83 @@
+/**
+ * Interrupt-Driven UART Transmit Queue
+ *
+ * The indices are 16-bit, which the AVR reads and writes one byte at a
+ * time, so the main loop updates and reads them with interrupts disabled
+ * for a few cycles. The handler disables its own interrupt when the
+ * queue runs empty; enqueueing enables it again.
+ */
+
+ #include "water_quality_registers.h"
+ #include "water_quality_uart.h"
+ 
+ #ifndef F_CPU
+ #define F_CPU 16000000UL
+ #endif
+ 
+ #define UART_UBRR (F_CPU / 16 / UART_BAUD - 1)
+ #define UART_TX_MASK (UART_TX_BUFFER_SIZE - 1)
+ 
+ void uart_tx_init(uart_tx_queue *queue, uart_overflow_policy policy) {
+     queue->head = 0;
+     queue->tail = 0;
+     queue->policy = (uint8_t)policy;
+     queue->dropped = 0;
+ 
+     UBRR0H = (uint8_t)(UART_UBRR >> 8);
+     UBRR0L = (uint8_t)UART_UBRR;
+ 
+     // Transmitter only; the data-register-empty interrupt is enabled once
+     // there is something to send
+     UCSR0B = (1 << TXEN0);
+ 
+     // Set frame format: 8 data bits, 1 stop bit, no parity
+     UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);
+ }
+ 
+ uint8_t uart_tx_enqueue(uart_tx_queue *queue, uint8_t byte) {
+     uint8_t queued = 1;
+     uint8_t sreg = interrupts_save();
+     uint16_t next = (queue->head + 1) & UART_TX_MASK;
+ 
+     if (next == queue->tail) {
+         if (queue->dropped < UINT16_MAX) queue->dropped++;
+ 
+         if (queue->policy == UART_DROP_NEWEST) {
+             queued = 0;
+         } else {
+             queue->tail = (queue->tail + 1) & UART_TX_MASK;
+         }
+     }
+ 
+     if (queued) {
+         queue->buffer[queue->head] = byte;
+         queue->head = next;
+         UCSR0B |= (1 << UDRIE0);
+     }
+ 
+     interrupts_restore(sreg);
+     return queued;
+ }
+ 
+ void uart_tx_isr(uart_tx_queue *queue) {
+     if (queue->tail == queue->head) {
+         // Nothing left: stop until the next enqueue
+         UCSR0B &= (uint8_t)~(1 << UDRIE0);
+         return;
+     }
+ 
+     UDR0 = queue->buffer[queue->tail];
+     queue->tail = (queue->tail + 1) & UART_TX_MASK;
+ }
+ 
+ uint16_t uart_tx_pending(uart_tx_queue *queue) {
+     uint8_t sreg = interrupts_save();
+     uint16_t pending = (queue->head - queue->tail) & UART_TX_MASK;
+     interrupts_restore(sreg);
+ 
+     return pending;
+ }
+ 
+ uint16_t uart_tx_dropped(uart_tx_queue *queue) {
+     return queue->dropped;
+ }
\ No newline at end of file
@@ -0,0 +1,49 @@
+/**
+ * Interrupt-Driven UART Transmit Queue
+ *
+ * Output is queued in a ring buffer and sent by the USART
+ * data-register-empty interrupt, one byte per character time, so the
+ * main loop never waits for the 9600 baud line. Enqueueing never blocks:
+ * when the buffer is full a byte is dropped, either the new one or the
+ * oldest one queued, and counted.
+ */
+
+ #ifndef WATER_QUALITY_UART_H
+ #define WATER_QUALITY_UART_H
+ 
+ #include <stdint.h>
+ 
+ #define UART_BAUD 9600
+ #define UART_TX_BUFFER_SIZE 512     // Holds a whole report (power of two)
+ 
+ typedef enum {
+     UART_DROP_NEWEST,               // Keep what is queued; lose the end of the output
+     UART_DROP_OLDEST                // Keep the latest output; lose bytes not sent yet
+ } uart_overflow_policy;
+ 
+ typedef struct {
+     uint8_t buffer[UART_TX_BUFFER_SIZE];
+     uint16_t head;                  // Next free slot (main loop)
+     uint16_t tail;                  // Next byte to send (interrupt, or main loop when dropping oldest)
+     uint8_t policy;
+     uint16_t dropped;               // Bytes lost to overflow, saturating
+ } uart_tx_queue;
+ 
+ // Sets up USART0 for UART_BAUD 8N1 and an empty queue. Interrupts must be
+ // enabled for the queue to drain.
+ void uart_tx_init(uart_tx_queue *queue, uart_overflow_policy policy);
+ 
+ // Queues one byte without waiting. Returns 1 if it was queued, 0 if it
+ // was dropped (UART_DROP_NEWEST with a full buffer).
+ uint8_t uart_tx_enqueue(uart_tx_queue *queue, uint8_t byte);
+ 
+ // Body of ISR(USART_UDRE_vect)
+ void uart_tx_isr(uart_tx_queue *queue);
+ 
+ // Bytes still waiting to be sent
+ uint16_t uart_tx_pending(uart_tx_queue *queue);
+ 
+ // Bytes dropped so far
+ uint16_t uart_tx_dropped(uart_tx_queue *queue);
+ 
+ #endif /* WATER_QUALITY_UART_H */
\ No newline at end of file
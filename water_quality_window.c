@@ -0,0 +1,242 @@
+/**
+ * Sliding Window Statistics
+ *
+ * Buckets are numbered by timestamp_ms / bucket_ms. When a sample arrives
+ * for a later bucket, closed buckets that fell out of the window are
+ * taken out of the totals (Chan's parallel variance formula run
+ * backwards), then the open bucket is merged in and pushed onto the
+ * min/max deques. Queries merge the totals with the open bucket.
+ */
+
+ #define _POSIX_C_SOURCE 200809L
+ 
+ #include <math.h>
+ #include <string.h>
+ #include "water_quality_window.h"
+ 
+ static const uint32_t spans_ms[NUM_WINDOWS] = { 60000, 3600000, 86400000 };
+ static const char *const names[NUM_WINDOWS] = { "1m", "1h", "24h" };
+ 
+ #define CHANNEL_HISTOGRAM(id, key, name, unit, pin, period_ms, good_min, good_max, alert_min, \
+                           alert_max, hysteresis, near, full_scale, histogram_min, histogram_max) \
+     [PARAM_##id] = { histogram_min, histogram_max },
+ 
+ static const float histogram_range[NUM_PARAMS][2] = {
+     WATER_QUALITY_CHANNELS(CHANNEL_HISTOGRAM)
+ };
+ 
+ uint32_t window_span_ms(int window) {
+     return spans_ms[window];
+ }
+ 
+ const char* window_name(int window) {
+     return names[window];
+ }
+ 
+ static void bucket_reset(window_bucket *bucket, uint64_t number) {
+     memset(bucket, 0, sizeof(*bucket));
+     bucket->number = number;
+ }
+ 
+ // Merges count/mean/m2 of another set of samples into *count/*mean/*m2
+ static void merge_moments(uint32_t *count, double *mean, double *m2,
+                           uint32_t other_count, double other_mean, double other_m2) {
+     uint32_t total = *count + other_count;
+     double delta = other_mean - *mean;
+ 
+     if (other_count == 0) return;
+ 
+     *m2 += other_m2 + delta * delta * ((double)*count * other_count / total);
+     *mean += delta * other_count / total;
+     *count = total;
+ }
+ 
+ // Inverse of merge_moments(): removes a subset that was merged in earlier
+ static void remove_moments(uint32_t *count, double *mean, double *m2,
+                            uint32_t other_count, double other_mean, double other_m2) {
+     uint32_t remaining = *count - other_count;
+ 
+     if (remaining == 0) {
+         *count = 0;
+         *mean = 0.0;
+         *m2 = 0.0;
+         return;
+     }
+ 
+     double rest_mean = (*mean * *count - other_mean * other_count) / remaining;
+     double delta = other_mean - rest_mean;
+ 
+     *m2 -= other_m2 + delta * delta * ((double)remaining * other_count / *count);
+     if (*m2 < 0.0) *m2 = 0.0;     // Rounding only
+     *mean = rest_mean;
+     *count = remaining;
+ }
+ 
+ static inline uint8_t deque_back(const window_deque *deque) {
+     return deque->slot[(deque->head + deque->size - 1) % WINDOW_BUCKETS];
+ }
+ 
+ static inline void deque_push(window_deque *deque, uint8_t slot) {
+     deque->slot[(deque->head + deque->size) % WINDOW_BUCKETS] = slot;
+     deque->size++;
+ }
+ 
+ static inline void deque_pop_front(window_deque *deque) {
+     deque->head = (uint8_t)((deque->head + 1) % WINDOW_BUCKETS);
+     deque->size--;
+ }
+ 
+ static void expire_deque(sliding_window *window, window_deque *deque, uint64_t first) {
+     while (deque->size > 0 && window->closed[deque->slot[deque->head]].number < first) {
+         deque_pop_front(deque);
+     }
+ }
+ 
+ static void close_open_bucket(sliding_window *window) {
+     const window_bucket *open = &window->open;
+     uint8_t slot = (uint8_t)(open->number % WINDOW_BUCKETS);
+ 
+     window->closed[slot] = *open;
+ 
+     merge_moments(&window->count, &window->mean, &window->m2, open->count, open->mean, open->m2);
+     for (int b = 0; b < WINDOW_BINS; b++) window->bins[b] += open->bins[b];
+ 
+     // Buckets that can no longer be the window's minimum (or maximum)
+     // before they expire are dropped from the back
+     while (window->minima.size > 0 && window->closed[deque_back(&window->minima)].min >= open->min) {
+         window->minima.size--;
+     }
+     deque_push(&window->minima, slot);
+ 
+     while (window->maxima.size > 0 && window->closed[deque_back(&window->maxima)].max <= open->max) {
+         window->maxima.size--;
+     }
+     deque_push(&window->maxima, slot);
+ }
+ 
+ // Moves the window so that bucket number is the open one
+ static void advance(sliding_window *window, uint64_t number) {
+     // Buckets before first are outside the window once number is open
+     uint64_t first = number >= WINDOW_BUCKETS - 1 ? number - (WINDOW_BUCKETS - 1) : 0;
+ 
+     // Each slot is visited at most once per pass, however long the gap
+     for (uint64_t k = window->oldest; k < first && k < window->oldest + WINDOW_BUCKETS; k++) {
+         window_bucket *bucket = &window->closed[k % WINDOW_BUCKETS];
+ 
+         if (bucket->count == 0 || bucket->number != k) continue;
+ 
+         remove_moments(&window->count, &window->mean, &window->m2,
+                        bucket->count, bucket->mean, bucket->m2);
+         for (int b = 0; b < WINDOW_BINS; b++) window->bins[b] -= bucket->bins[b];
+         bucket->count = 0;
+     }
+     if (first > window->oldest) window->oldest = first;
+ 
+     expire_deque(window, &window->minima, first);
+     expire_deque(window, &window->maxima, first);
+ 
+     if (window->open.count > 0 && window->open.number >= first) close_open_bucket(window);
+     bucket_reset(&window->open, number);
+ }
+ 
+ void sliding_window_init(sliding_window *window, uint32_t span_ms, float low, float high) {
+     memset(window, 0, sizeof(*window));
+     window->bucket_ms = span_ms / WINDOW_BUCKETS;
+     window->bin_low = low;
+     window->bin_scale = WINDOW_BINS / (high - low);
+ }
+ 
+ void sliding_window_add(sliding_window *window, uint64_t timestamp_ms, float value) {
+     uint64_t number = timestamp_ms / window->bucket_ms;
+     window_bucket *open = &window->open;
+ 
+     if (isnan(value)) return;
+ 
+     // Late samples are counted in the open bucket
+     if (number > open->number) advance(window, number);
+     if (open->count == WINDOW_BUCKET_LIMIT) return;
+ 
+     float position = (value - window->bin_low) * window->bin_scale;
+     int bin = position > 0.0f ? (int)fminf(position, WINDOW_BINS - 1) : 0;
+     open->bins[bin]++;
+ 
+     if (open->count == 0 || value < open->min) open->min = value;
+     if (open->count == 0 || value > open->max) open->max = value;
+ 
+     // Welford's update
+     double delta = value - open->mean;
+     open->count++;
+     open->mean += delta / open->count;
+     open->m2 += delta * (value - open->mean);
+ }
+ 
+ // Value at quantile q, interpolated linearly inside its histogram bin
+ static float quantile(const sliding_window *window, const uint32_t bins[WINDOW_BINS],
+                       uint32_t count, float min, float max, double q) {
+     double rank = q * (count - 1);
+     uint32_t seen = 0;
+     int b = 0;
+ 
+     while (b < WINDOW_BINS - 1 && seen + bins[b] <= rank) seen += bins[b++];
+ 
+     double fraction = bins[b] ? (rank - seen + 0.5) / bins[b] : 0.5;
+     float value = window->bin_low + (float)((b + fraction) / window->bin_scale);
+ 
+     return fminf(fmaxf(value, min), max);
+ }
+ 
+ void sliding_window_stats(sliding_window *window, uint64_t now_ms, window_stats *stats) {
+     uint64_t number = now_ms / window->bucket_ms;
+     const window_bucket *open = &window->open;
+ 
+     if (number > open->number) advance(window, number);
+ 
+     uint32_t count = window->count;
+     double mean = window->mean;
+     double m2 = window->m2;
+     merge_moments(&count, &mean, &m2, open->count, open->mean, open->m2);
+ 
+     memset(stats, 0, sizeof(*stats));
+     if (count == 0) return;
+ 
+     float min = INFINITY;
+     float max = -INFINITY;
+     if (window->minima.size > 0) min = window->closed[window->minima.slot[window->minima.head]].min;
+     if (window->maxima.size > 0) max = window->closed[window->maxima.slot[window->maxima.head]].max;
+     if (open->count > 0) {
+         min = fminf(min, open->min);
+         max = fmaxf(max, open->max);
+     }
+ 
+     uint32_t bins[WINDOW_BINS];
+     for (int b = 0; b < WINDOW_BINS; b++) bins[b] = window->bins[b] + open->bins[b];
+ 
+     stats->count = count;
+     stats->min = min;
+     stats->max = max;
+     stats->mean = (float)mean;
+     stats->stddev = count > 1 ? (float)sqrt(m2 / (count - 1)) : 0.0f;
+     stats->p50 = quantile(window, bins, count, min, max, 0.50);
+     stats->p90 = quantile(window, bins, count, min, max, 0.90);
+     stats->p99 = quantile(window, bins, count, min, max, 0.99);
+ }
+ 
+ void station_windows_init(station_windows *windows) {
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         for (int w = 0; w < NUM_WINDOWS; w++) {
+             sliding_window_init(&windows->window[p][w], spans_ms[w],
+                                 histogram_range[p][0], histogram_range[p][1]);
+         }
+     }
+ }
+ 
+ void station_windows_add(station_windows *windows, uint64_t timestamp_ms,
+                          const float values[NUM_PARAMS], uint32_t mask) {
+     for (int p = 0; p < NUM_PARAMS; p++) {
+         if (!(mask & (1u << p))) continue;
+ 
+         for (int w = 0; w < NUM_WINDOWS; w++) {
+             sliding_window_add(&windows->window[p][w], timestamp_ms, values[p]);
+         }
+     }
+ }
\ No newline at end of file
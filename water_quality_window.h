@@ -0,0 +1,99 @@
+/**
+ * Sliding Window Statistics
+ *
+ * Streaming min/max/mean/stddev/percentiles of one parameter over a
+ * sliding time window, in fixed memory. The window is split into
+ * WINDOW_BUCKETS buckets; each bucket keeps Welford mean/variance,
+ * min/max and a small histogram, and the window adds closed buckets in
+ * and takes expired ones out again. Minima and maxima of closed buckets
+ * are tracked with monotonic deques, so every operation is O(1)
+ * amortized. The window slides one bucket at a time (span / 30).
+ */
+
+ #ifndef WATER_QUALITY_WINDOW_H
+ #define WATER_QUALITY_WINDOW_H
+ 
+ #include <stdint.h>
+ #include "water_quality_config.h"
+ 
+ #define WINDOW_BUCKETS 30           // Buckets per window (sliding granularity)
+ #define WINDOW_BINS 32              // Histogram bins per bucket (percentile sketch)
+ #define WINDOW_BUCKET_LIMIT 65535   // Samples per bucket; later ones are ignored
+ 
+ // Windows kept for every parameter of a station
+ #define WINDOW_1MIN  0
+ #define WINDOW_1HOUR 1
+ #define WINDOW_1DAY  2
+ #define NUM_WINDOWS  3
+ 
+ typedef struct {
+     uint64_t number;                // Bucket start time / bucket_ms
+     uint32_t count;
+     float min;
+     float max;
+     double mean;
+     double m2;                      // Sum of squared deviations from mean
+     uint16_t bins[WINDOW_BINS];
+ } window_bucket;
+ 
+ // Slot indices into closed[], oldest first
+ typedef struct {
+     uint8_t slot[WINDOW_BUCKETS];
+     uint8_t head;
+     uint8_t size;
+ } window_deque;
+ 
+ typedef struct {
+     uint32_t bucket_ms;
+     float bin_low;                  // Histogram covers [bin_low, bin_low + WINDOW_BINS / bin_scale)
+     float bin_scale;                // Bins per unit
+     uint64_t oldest;                // Lowest bucket number that may still be in the totals
+ 
+     window_bucket open;             // Bucket receiving samples
+     window_bucket closed[WINDOW_BUCKETS];   // Indexed by number % WINDOW_BUCKETS
+ 
+     // Closed buckets still inside the window, merged
+     uint32_t count;
+     double mean;
+     double m2;
+     uint32_t bins[WINDOW_BINS];
+     window_deque minima;            // Increasing bucket minima
+     window_deque maxima;            // Decreasing bucket maxima
+ } sliding_window;
+ 
+ typedef struct {
+     uint32_t count;
+     float min;
+     float max;
+     float mean;
+     float stddev;                   // Sample standard deviation
+     float p50;
+     float p90;
+     float p99;
+ } window_stats;
+ 
+ // Histogram range [low, high); values outside land in the edge bins (min
+ // and max stay exact)
+ void sliding_window_init(sliding_window *window, uint32_t span_ms, float low, float high);
+ 
+ void sliding_window_add(sliding_window *window, uint64_t timestamp_ms, float value);
+ 
+ // Statistics of the samples from the last span up to now_ms; slides the
+ // window forward first. All zero when the window is empty.
+ void sliding_window_stats(sliding_window *window, uint64_t now_ms, window_stats *stats);
+ 
+ // Every window of every parameter of one station
+ typedef struct {
+     sliding_window window[NUM_PARAMS][NUM_WINDOWS];
+ } station_windows;
+ 
+ void station_windows_init(station_windows *windows);
+ 
+ // Adds the parameters whose bit is set in mask
+ void station_windows_add(station_windows *windows, uint64_t timestamp_ms,
+                          const float values[NUM_PARAMS], uint32_t mask);
+ 
+ uint32_t window_span_ms(int window);
+ const char* window_name(int window);
+ 
+ #endif /* WATER_QUALITY_WINDOW_H */
\ No newline at end of file